@@ -0,0 +1,74 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#ifndef __DFIEFF_H__
+#define __DFIEFF_H__
+
+#include <directfb.h>
+
+typedef struct {
+     u8  magic[5];  /* "DFIEF" magic */
+
+     u8  major;     /* Major version number */
+     u8  minor;     /* Minor version number */
+
+     u8  flags;
+} DFIEFFHeader;
+
+typedef enum {
+     DFIEFF_RECORD_DEVICE = 1, /* DFIEFFDevice follows */
+     DFIEFF_RECORD_EVENT  = 2  /* DFIEFFEvent follows */
+} DFIEFFRecordType;
+
+/*
+ * Records follow each other without padding, so they are not aligned within the file.
+ */
+typedef struct {
+     u32 type;      /* DFIEFFRecordType */
+     u32 device_id; /* input device id at recording time */
+
+     s64 micros;    /* time since the start of the recording */
+} DFIEFFRecord;
+
+typedef struct {
+     DFBInputDeviceDescription desc;
+} DFIEFFDevice;
+
+typedef struct {
+     u32 type;
+     u32 flags;
+
+     s32 key_code;
+     u32 key_id;
+     u32 key_symbol;
+     u32 modifiers;
+     u32 locks;
+
+     u32 button;
+     u32 buttons;
+
+     s32 axis;
+     s32 axisabs;
+     s32 axisrel;
+     s32 min;
+     s32 max;
+
+     s32 slot_id;
+} DFIEFFEvent;
+
+#endif
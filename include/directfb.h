@@ -1166,6 +1166,35 @@ typedef struct {
      DFBSurfaceColorSpace                    colorspace;         /* color space */
 } DFBSurfaceDescription;
 
+/*
+ * Kinds of surfaces for the accounting of surface memory.
+ */
+typedef enum {
+     DSMT_LAYER                            = 0x00000000,         /* Surfaces of display layers. */
+     DSMT_WINDOW                           = 0x00000001,         /* Surfaces of windows. */
+     DSMT_CURSOR                           = 0x00000002,         /* Cursor shapes. */
+     DSMT_FONT                             = 0x00000003,         /* Glyph caches of fonts. */
+     DSMT_OTHER                            = 0x00000004,         /* All other surfaces. */
+
+     DSMT_NUM                              = 0x00000005          /* Number of kinds. */
+} DFBSurfaceMemoryType;
+
+/*
+ * Amount of surface memory.
+ */
+typedef struct {
+     unsigned int                            allocations;        /* Number of buffer allocations. */
+     u64                                     bytes;              /* Size of the allocations. */
+} DFBSurfaceMemoryAmount;
+
+/*
+ * Surface memory usage per kind of surface.
+ */
+typedef struct {
+     DFBSurfaceMemoryAmount                  video[DSMT_NUM];    /* Allocations in video memory. */
+     DFBSurfaceMemoryAmount                  system[DSMT_NUM];   /* Allocations in system memory. */
+} DFBSurfaceMemoryUsage;
+
 /*
  * Flags defining which fields of a DFBPaletteDescription are
  * valid.
@@ -1948,6 +1977,17 @@ D_DEFINE_INTERFACE( IDirectFB,
           IDirectFB                         *thiz,
           DFBSurfacePixelFormat             *ret_fontformat
      );
+
+     /*
+      * Get the surface memory usage of all processes or, if
+      * 'process' is DFB_TRUE, of the surfaces created by the
+      * calling process only.
+      */
+     DFBResult (*GetSurfaceMemoryUsage) (
+          IDirectFB                         *thiz,
+          DFBBoolean                         process,
+          DFBSurfaceMemoryUsage             *ret_usage
+     );
 )
 
 /*******************
@@ -3546,6 +3586,17 @@ typedef enum {
                                              DSTF_RIGHT          /* right aligned, 'y' specifying the bottom */
 } DFBSurfaceTextFlags;
 
+/*
+ * A string to be drawn with IDirectFBSurface::DrawStrings().
+ */
+typedef struct {
+     const char                           *text;              /* text to draw */
+     int                                   bytes;             /* number of bytes or -1 for NULL-terminated text */
+     int                                   x;                 /* position of the string */
+     int                                   y;
+     DFBSurfaceTextFlags                   flags;             /* text layout flags */
+} DFBSurfaceTextItem;
+
 /*
  * Options for drawing and blitting operations.
  */
@@ -4737,6 +4788,24 @@ D_DEFINE_INTERFACE( IDirectFBSurface,
      DFBResult (*Flush) (
           IDirectFBSurface                  *thiz
      );
+
+   /** Text functions **/
+
+     /*
+      * Draw several strings at once with the given color.
+      *
+      * Each item is drawn like with DrawString(), but the
+      * drawing state is set up only once and the glyphs of
+      * all strings are blitted as one batch, which is faster
+      * for large blocks of text.
+      * You need to set a font using the SetFont() method before
+      * calling this function.
+      */
+     DFBResult (*DrawStrings) (
+          IDirectFBSurface                  *thiz,
+          const DFBSurfaceTextItem          *items,
+          unsigned int                       num
+     );
 )
 
 /******************************
@@ -6676,6 +6745,36 @@ D_DEFINE_INTERFACE( IDirectFBFont,
           IDirectFBFont                     *thiz,
           DFBFontDescription                *ret_desc
      );
+
+   /** Resources **/
+
+     /*
+      * Render the glyphs of a string in the background.
+      *
+      * 'bytes' specifies the number of bytes to take from the
+      * string or -1 for the complete NULL-terminated string.
+      * The string is decoded using the encoding set with
+      * SetEncoding(). Glyphs which are not cached yet are
+      * rendered by a separate thread, so that drawing the
+      * string later on does not have to wait for them.
+      */
+     DFBResult (*PrefetchString) (
+          IDirectFBFont                     *thiz,
+          const char                        *text,
+          int                                bytes
+     );
+
+     /*
+      * Render the glyphs of a range of unicode characters in
+      * the background.
+      *
+      * Both 'first' and 'last' are included in the range.
+      */
+     DFBResult (*PrefetchRange) (
+          IDirectFBFont                     *thiz,
+          unsigned int                       first,
+          unsigned int                       last
+     );
 )
 
 /**************************
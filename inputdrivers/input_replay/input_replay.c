@@ -0,0 +1,426 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <core/input_driver.h>
+#include <dfieff.h>
+#include <direct/filesystem.h>
+#include <direct/memcpy.h>
+#include <direct/thread.h>
+
+D_DEBUG_DOMAIN( Input_Replay, "Input/Replay", "Input Event Replay Driver" );
+
+DFB_INPUT_DRIVER( input_replay )
+
+/**********************************************************************************************************************/
+
+/*
+ * Replays input events recorded with the 'input-record=<filename>' option.
+ *
+ * Options:
+ *   input-replay=<filename>     Record file to replay
+ *   input-replay-speed=<n>      Replay speed in percent of the original timing (default = 100),
+ *                               0 to replay all events as fast as possible
+ *   [no-]input-replay-loop      Restart the replay when the end of the record file is reached
+ */
+
+typedef struct {
+     DFBInputDeviceID           id;     /* device id at recording time */
+     DFBInputDeviceDescription  desc;
+
+     CoreInputDevice           *device;
+} ReplayDevice;
+
+#define MAX_REPLAY_DEVICES 32
+
+/* Input devices found in the record file. */
+static ReplayDevice     replay_devices[MAX_REPLAY_DEVICES];
+
+/* Number of entries in the replay_devices array. */
+static int              num_devices = 0;
+
+/* Number of devices opened by the core. */
+static int              num_opened  = 0;
+
+static void            *replay_content;
+static size_t           replay_size;
+static unsigned int     replay_speed;
+static bool             replay_loop;
+
+static DirectThread    *replay_thread;
+static DirectMutex      replay_lock;
+static DirectWaitQueue  replay_cond;
+static bool             replay_quit;
+
+/**********************************************************************************************************************/
+
+static size_t
+record_payload_size( const DFIEFFRecord *record )
+{
+     switch (record->type) {
+          case DFIEFF_RECORD_DEVICE:
+               return sizeof(DFIEFFDevice);
+
+          case DFIEFF_RECORD_EVENT:
+               return sizeof(DFIEFFEvent);
+
+          default:
+               return 0;
+     }
+}
+
+static ReplayDevice *
+lookup_device( DFBInputDeviceID id )
+{
+     int i;
+
+     for (i = 0; i < num_devices; i++) {
+          if (replay_devices[i].id == id)
+               return &replay_devices[i];
+     }
+
+     return NULL;
+}
+
+/*
+ * Wait until the given time or until the replay is stopped, returns false in the latter case.
+ */
+static bool
+replay_wait_until( long long micros )
+{
+     direct_mutex_lock( &replay_lock );
+
+     while (!replay_quit) {
+          long long now = direct_clock_get_micros();
+
+          if (now >= micros)
+               break;
+
+          direct_waitqueue_wait_timeout( &replay_cond, &replay_lock, micros - now );
+     }
+
+     direct_mutex_unlock( &replay_lock );
+
+     return !replay_quit;
+}
+
+static void *
+replay_thread_main( DirectThread *thread,
+                    void         *arg )
+{
+     int i;
+
+     D_DEBUG_AT( Input_Replay, "%s()\n", __FUNCTION__ );
+
+     /* The core finishes device initialization after all devices are opened. */
+     for (i = 0; i < num_devices; i++) {
+          while (!replay_devices[i].device->shared) {
+               if (!replay_wait_until( direct_clock_get_micros() + 10000 ))
+                    return NULL;
+          }
+     }
+
+     do {
+          size_t    offset = sizeof(DFIEFFHeader);
+          long long start  = direct_clock_get_micros();
+
+          D_DEBUG_AT( Input_Replay, "  -> starting replay\n" );
+
+          while (offset + sizeof(DFIEFFRecord) <= replay_size) {
+               DFIEFFRecord       record;
+               DFIEFFEvent        event_record;
+               const DFIEFFEvent *event = &event_record;
+               size_t             size;
+               ReplayDevice      *device;
+               DFBInputEvent      evt;
+
+               /* Records are not aligned within the file. */
+               direct_memcpy( &record, replay_content + offset, sizeof(DFIEFFRecord) );
+
+               size = record_payload_size( &record );
+
+               if (!size || offset + sizeof(DFIEFFRecord) + size > replay_size) {
+                    D_WARN( "truncated or corrupt input record at offset %zu", offset );
+                    break;
+               }
+
+               if (record.type == DFIEFF_RECORD_EVENT)
+                    direct_memcpy( &event_record, replay_content + offset + sizeof(DFIEFFRecord), size );
+
+               offset += sizeof(DFIEFFRecord) + size;
+
+               if (record.type != DFIEFF_RECORD_EVENT)
+                    continue;
+
+               device = lookup_device( record.device_id );
+               if (!device)
+                    continue;
+
+               if (replay_speed) {
+                    if (!replay_wait_until( start + record.micros * 100 / replay_speed ))
+                         return NULL;
+               }
+               else if (replay_quit)
+                    return NULL;
+
+               memset( &evt, 0, sizeof(evt) );
+
+               evt.type       = event->type;
+               evt.flags      = event->flags & ~DIEF_TIMESTAMP;
+               evt.key_code   = event->key_code;
+               evt.key_id     = event->key_id;
+               evt.key_symbol = event->key_symbol;
+               evt.modifiers  = event->modifiers;
+               evt.locks      = event->locks;
+               evt.button     = event->button;
+               evt.buttons    = event->buttons;
+               evt.axis       = event->axis;
+               evt.axisabs    = event->axisabs;
+               evt.axisrel    = event->axisrel;
+               evt.min        = event->min;
+               evt.max        = event->max;
+               evt.slot_id    = event->slot_id;
+
+               dfb_input_dispatch( device->device, &evt );
+          }
+     } while (replay_loop && !replay_quit);
+
+     D_DEBUG_AT( Input_Replay, "Replay thread terminated\n" );
+
+     return NULL;
+}
+
+static DFBResult
+load_record_file( const char *filename )
+{
+     DFBResult           ret;
+     DirectFile          fd;
+     DirectFileInfo      info;
+     void               *ptr;
+     const DFIEFFHeader *header;
+     size_t              offset;
+
+     D_DEBUG_AT( Input_Replay, "%s( '%s' )\n", __FUNCTION__, filename );
+
+     ret = direct_file_open( &fd, filename, O_RDONLY, 0 );
+     if (ret) {
+          D_DERROR( ret, "Input/Replay: Could not open '%s'!\n", filename );
+          return ret;
+     }
+
+     ret = direct_file_get_info( &fd, &info );
+     if (ret) {
+          D_DERROR( ret, "Input/Replay: Could not query info about '%s'!\n", filename );
+          direct_file_close( &fd );
+          return ret;
+     }
+
+     if (info.size < sizeof(DFIEFFHeader)) {
+          D_ERROR( "Input/Replay: File '%s' is too small!\n", filename );
+          direct_file_close( &fd );
+          return DFB_UNSUPPORTED;
+     }
+
+     ret = direct_file_map( &fd, NULL, 0, info.size, DFP_READ, &ptr );
+     if (ret) {
+          D_DERROR( ret, "Input/Replay: Could not mmap '%s'!\n", filename );
+          direct_file_close( &fd );
+          return ret;
+     }
+
+     direct_file_close( &fd );
+
+     header = ptr;
+
+     /* Check the magic. */
+     if (strncmp( (const char*) header->magic, "DFIEF", 5 ) || header->major != 0) {
+          D_ERROR( "Input/Replay: Unsupported file format of '%s'!\n", filename );
+          direct_file_unmap( ptr, info.size );
+          return DFB_UNSUPPORTED;
+     }
+
+     replay_content = ptr;
+     replay_size    = info.size;
+
+     /* Collect the input devices. */
+     for (offset = sizeof(DFIEFFHeader); offset + sizeof(DFIEFFRecord) <= replay_size;) {
+          DFIEFFRecord record;
+          size_t       size;
+
+          /* Records are not aligned within the file. */
+          direct_memcpy( &record, replay_content + offset, sizeof(DFIEFFRecord) );
+
+          size = record_payload_size( &record );
+
+          if (!size || offset + sizeof(DFIEFFRecord) + size > replay_size)
+               break;
+
+          if (record.type == DFIEFF_RECORD_DEVICE && !lookup_device( record.device_id )) {
+               DFIEFFDevice device;
+
+               if (num_devices == MAX_REPLAY_DEVICES) {
+                    D_WARN( "too many input devices in '%s'", filename );
+                    break;
+               }
+
+               direct_memcpy( &device, replay_content + offset + sizeof(DFIEFFRecord), sizeof(DFIEFFDevice) );
+
+               replay_devices[num_devices].id   = record.device_id;
+               replay_devices[num_devices].desc = device.desc;
+
+               num_devices++;
+          }
+
+          offset += sizeof(DFIEFFRecord) + size;
+     }
+
+     return DFB_OK;
+}
+
+/**********************************************************************************************************************/
+
+static int
+driver_get_available()
+{
+     const char *value;
+
+     if (num_devices) {
+          memset( replay_devices, 0, sizeof(replay_devices) );
+
+          num_devices = 0;
+
+          direct_file_unmap( replay_content, replay_size );
+
+          replay_content = NULL;
+          replay_size    = 0;
+
+          return 0;
+     }
+
+     value = direct_config_get_value( "input-replay" );
+     if (!value)
+          return 0;
+
+     if (load_record_file( value ))
+          return 0;
+
+     replay_speed = 100;
+
+     if ((value = direct_config_get_value( "input-replay-speed" ))) {
+          if (sscanf( value, "%u", &replay_speed ) < 1) {
+               D_ERROR( "Input/Replay: Could not parse 'input-replay-speed' value!\n" );
+               replay_speed = 100;
+          }
+     }
+
+     replay_loop = direct_config_has_name( "input-replay-loop" ) && !direct_config_has_name( "no-input-replay-loop" );
+
+     if (!num_devices) {
+          direct_file_unmap( replay_content, replay_size );
+
+          replay_content = NULL;
+          replay_size    = 0;
+     }
+
+     return num_devices;
+}
+
+static void
+driver_get_info( InputDriverInfo *driver_info )
+{
+     driver_info->version.major = 0;
+     driver_info->version.minor = 1;
+
+     snprintf( driver_info->name,   DFB_INPUT_DRIVER_INFO_NAME_LENGTH,   "Input Replay" );
+     snprintf( driver_info->vendor, DFB_INPUT_DRIVER_INFO_VENDOR_LENGTH, "DirectFB" );
+}
+
+static DFBResult
+driver_open_device( CoreInputDevice  *device,
+                    unsigned int      number,
+                    InputDeviceInfo  *device_info,
+                    void            **driver_data )
+{
+     ReplayDevice *replay_device;
+
+     D_DEBUG_AT( Input_Replay, "%s( %u )\n", __FUNCTION__, number );
+
+     D_ASSERT( number < num_devices );
+
+     replay_device = &replay_devices[number];
+
+     replay_device->device = device;
+
+     /* Fill device information, events are recorded with symbols and identifiers resolved, no keymap is needed. */
+     device_info->prefered_id      = replay_device->id;
+     device_info->desc             = replay_device->desc;
+     device_info->desc.min_keycode = -1;
+     device_info->desc.max_keycode = -1;
+
+     /* Start the replay thread once all devices are known. */
+     if (++num_opened == num_devices) {
+          direct_mutex_init( &replay_lock );
+          direct_waitqueue_init( &replay_cond );
+
+          replay_quit = false;
+
+          replay_thread = direct_thread_create( DTT_INPUT, replay_thread_main, NULL, "Input Replay" );
+     }
+
+     *driver_data = replay_device;
+
+     return DFB_OK;
+}
+
+static DFBResult
+driver_get_keymap_entry( CoreInputDevice           *device,
+                         void                      *driver_data,
+                         DFBInputDeviceKeymapEntry *entry )
+{
+     return DFB_UNSUPPORTED;
+}
+
+static void
+driver_close_device( void *driver_data )
+{
+     ReplayDevice *replay_device = driver_data;
+
+     D_DEBUG_AT( Input_Replay, "%s()\n", __FUNCTION__ );
+
+     /* Terminate the replay thread when the first device is closed. */
+     if (replay_thread) {
+          direct_mutex_lock( &replay_lock );
+
+          replay_quit = true;
+
+          direct_waitqueue_broadcast( &replay_cond );
+
+          direct_mutex_unlock( &replay_lock );
+
+          direct_thread_join( replay_thread );
+          direct_thread_destroy( replay_thread );
+
+          replay_thread = NULL;
+
+          direct_waitqueue_deinit( &replay_cond );
+          direct_mutex_deinit( &replay_lock );
+     }
+
+     replay_device->device = NULL;
+
+     num_opened--;
+}
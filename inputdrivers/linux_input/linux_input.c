@@ -76,6 +76,15 @@ static int   device_nums[MAX_LINUX_INPUT_DEVICES] = { 0 };
 /* Number of entries in the device_names and device_nums arrays. */
 static int   num_devices = 0;
 
+typedef struct {
+     int                      fd;       /* opened (and grabbed) device, -1 once taken by driver_open_device() */
+     InputDeviceInfo          info;
+     bool                     touchpad;
+} ProbedDevice;
+
+/* Devices already opened and probed by the hot-plug thread, indexed like device_names. */
+static ProbedDevice *probed_devices[MAX_LINUX_INPUT_DEVICES];
+
 #define MAX_LINUX_INPUT_EVENTS 64
 
 /* Input events filled on read. */
@@ -1221,15 +1230,18 @@ get_device_info( int              fd,
      D_DEBUG_AT( Linux_Input, "  -> ids %d/%d\n", device_info->desc.vendor_id, device_info->desc.product_id );
 }
 
-static bool
-check_device( const char *device )
+/*
+ * Open a device and get its information, keeping the device grabbed if requested. Returns -1 if it is not usable.
+ */
+static int
+probe_device( const char      *device,
+              bool             grab,
+              InputDeviceInfo *device_info,
+              bool            *touchpad )
 {
-     int             err;
-     int             fd;
-     InputDeviceInfo device_info;
-     bool            touchpad;
-     bool            linux_input_grab;
-     bool            linux_input_ir_only;
+     int  err;
+     int  fd;
+     bool linux_input_ir_only;
 
      D_DEBUG_AT( Linux_Input, "%s( '%s' )\n", __FUNCTION__, device );
 
@@ -1237,52 +1249,72 @@ check_device( const char *device )
      fd = open( device, O_RDWR );
      if (fd < 0) {
           D_DEBUG_AT( Linux_Input, "  -> open failed!\n" );
-          return false;
+          return -1;
      }
 
-     /* Grab device. */
-     if (direct_config_has_name( "linux-input-grab" ) && !direct_config_has_name( "no-linux-input-grab" ))
-          linux_input_grab = true;
-     else
-          linux_input_grab = false;
-
      /* Ignore non-IR device. */
      if (direct_config_has_name( "linux-input-ir-only" ) && !direct_config_has_name( "no-linux-input-ir-only" ))
           linux_input_ir_only = true;
      else
           linux_input_ir_only = false;
 
-     if (linux_input_grab) {
+     if (grab) {
           err = ioctl( fd, EVIOCGRAB, 1 );
           if (err) {
                D_PERROR( "Input/Linux: Could not grab device!\n" );
                close( fd );
-               return false;
+               return -1;
           }
      }
 
      /* Get device information. */
-     memset( &device_info, 0, sizeof(InputDeviceInfo) );
+     memset( device_info, 0, sizeof(InputDeviceInfo) );
 
-     device_info.desc.min_keycode = -1;
-     device_info.desc.max_keycode = -1;
+     device_info->desc.min_keycode = -1;
+     device_info->desc.max_keycode = -1;
 
-     get_device_info( fd, &device_info, &touchpad );
+     get_device_info( fd, device_info, touchpad );
 
-     if (linux_input_grab)
+     if (!device_info->desc.caps) {
+         D_DEBUG_AT( Linux_Input, "  -> no caps!\n" );
+     }
+     else if (!linux_input_ir_only || (device_info->desc.type & DIDTF_REMOTE))
+          return fd;
+
+     if (grab)
           ioctl( fd, EVIOCGRAB, 0 );
 
      close( fd );
 
-     if (!device_info.desc.caps) {
-         D_DEBUG_AT( Linux_Input, "  -> no caps!\n" );
-         return false;
-     }
+     return -1;
+}
 
-     if (!linux_input_ir_only || (device_info.desc.type & DIDTF_REMOTE))
-          return true;
+static bool
+check_device( const char *device )
+{
+     int             fd;
+     InputDeviceInfo device_info;
+     bool            touchpad;
+     bool            linux_input_grab;
 
-     return false;
+     D_DEBUG_AT( Linux_Input, "%s( '%s' )\n", __FUNCTION__, device );
+
+     /* Grab device. */
+     if (direct_config_has_name( "linux-input-grab" ) && !direct_config_has_name( "no-linux-input-grab" ))
+          linux_input_grab = true;
+     else
+          linux_input_grab = false;
+
+     fd = probe_device( device, linux_input_grab, &device_info, &touchpad );
+     if (fd < 0)
+          return false;
+
+     if (linux_input_grab)
+          ioctl( fd, EVIOCGRAB, 0 );
+
+     close( fd );
+
+     return true;
 }
 
 /**********************************************************************************************************************/
@@ -1383,30 +1415,40 @@ driver_open_device( CoreInputDevice  *device,
 
      D_DEBUG_AT( Linux_Input, "%s()\n", __FUNCTION__ );
 
-     /* Open device. */
-     fd = open( device_names[number], O_RDWR );
-     if (fd < 0) {
-          D_PERROR( "Input/Linux: Could not open device '%s'!\n", device_names[number] );
-          return DFB_INIT;
-     }
-
      /* Grab device. */
      if (direct_config_has_name( "linux-input-grab" ) && !direct_config_has_name( "no-linux-input-grab" ))
           linux_input_grab = true;
      else
           linux_input_grab = false;
 
-     if (linux_input_grab) {
-          err = ioctl( fd, EVIOCGRAB, 1 );
-          if (err) {
-               D_PERROR( "Input/Linux: Could not grab device!\n" );
-               close( fd );
+     if (probed_devices[number] && probed_devices[number]->fd >= 0) {
+          /* Take over the device opened, grabbed and probed by the hot-plug thread. */
+          fd           = probed_devices[number]->fd;
+          *device_info = probed_devices[number]->info;
+          touchpad     = probed_devices[number]->touchpad;
+
+          probed_devices[number]->fd = -1;
+     }
+     else {
+          /* Open device. */
+          fd = open( device_names[number], O_RDWR );
+          if (fd < 0) {
+               D_PERROR( "Input/Linux: Could not open device '%s'!\n", device_names[number] );
                return DFB_INIT;
           }
-     }
 
-     /* Fill device information. */
-     get_device_info( fd, device_info, &touchpad );
+          if (linux_input_grab) {
+               err = ioctl( fd, EVIOCGRAB, 1 );
+               if (err) {
+                    D_PERROR( "Input/Linux: Could not grab device!\n" );
+                    close( fd );
+                    return DFB_INIT;
+               }
+          }
+
+          /* Fill device information. */
+          get_device_info( fd, device_info, &touchpad );
+     }
 
      /* Allocate and fill private data. */
      data = D_CALLOC( 1, sizeof(LinuxInputData) );
@@ -1689,6 +1731,220 @@ unregister_device_node( int  event_num,
      return DFB_UNSUPPORTED;
 }
 
+/* Time to wait for further udev events after each received one, in milliseconds. */
+#define HOTPLUG_BATCH_TIME 50
+
+/* Maximum time to collect udev events into one batch, in milliseconds. */
+#define HOTPLUG_BATCH_MAX_TIME 500
+
+/* Maximum number of udev events handled in one batch. */
+#define HOTPLUG_BATCH_SIZE (2 * MAX_LINUX_INPUT_DEVICES)
+
+typedef struct {
+     int           device_num;
+     bool          add;         /* device node created or removed */
+
+     DirectThread *thread;      /* thread probing the created device node */
+     ProbedDevice  probed;
+} HotplugEvent;
+
+/*
+ * Parse an udev event, returns false if it is not about a /dev/input/eventX device node.
+ */
+static bool
+parse_udev_event( char *udev_event,
+                  bool *ret_add,
+                  int  *ret_device_num )
+{
+     char *pos;
+     char *event_content;
+
+     pos = strchr( udev_event, '@' );
+     if (pos == NULL)
+          return false;
+
+     /* Replace '@' with '\0' to separate event type and event content. */
+     *pos = '\0';
+
+     event_content = pos + 1;
+
+     pos = strstr( event_content, "/event" );
+     if (pos == NULL)
+          return false;
+
+     if (!strcmp( udev_event, "add" ))
+          *ret_add = true;
+     else if (!strcmp( udev_event, "remove" ))
+          *ret_add = false;
+     else
+          return false;
+
+     /* Get input device number. */
+     *ret_device_num = atoi( pos + 6 );
+
+     return true;
+}
+
+/*
+ * Add an event to the batch, dropping a pending creation followed by the removal of the device node.
+ */
+static void
+batch_udev_event( HotplugEvent *batch,
+                  int          *num,
+                  bool          add,
+                  int           device_num )
+{
+     int i;
+
+     for (i = *num - 1; i >= 0; i--) {
+          if (batch[i].device_num != device_num)
+               continue;
+
+          if (batch[i].add == add)
+               return;
+
+          if (batch[i].add) {
+               memmove( &batch[i], &batch[i+1], (*num - i - 1) * sizeof(HotplugEvent) );
+               (*num)--;
+               return;
+          }
+
+          break;
+     }
+
+     if (*num == HOTPLUG_BATCH_SIZE) {
+          D_DEBUG_AT( Linux_Input, "  -> too many udev events, ignoring /dev/input/event%d\n", device_num );
+          return;
+     }
+
+     memset( &batch[*num], 0, sizeof(HotplugEvent) );
+
+     batch[*num].device_num = device_num;
+     batch[*num].add        = add;
+     batch[*num].probed.fd  = -1;
+
+     (*num)++;
+}
+
+static void *
+hotplug_probe_thread( DirectThread *thread,
+                      void         *arg )
+{
+     HotplugEvent *event = arg;
+     char          buf[32];
+     bool          linux_input_grab;
+
+     /* Grab device. */
+     if (direct_config_has_name( "linux-input-grab" ) && !direct_config_has_name( "no-linux-input-grab" ))
+          linux_input_grab = true;
+     else
+          linux_input_grab = false;
+
+     snprintf( buf, sizeof(buf), "/dev/input/event%d", event->device_num );
+
+     event->probed.fd = probe_device( buf, linux_input_grab, &event->probed.info, &event->probed.touchpad );
+
+     return NULL;
+}
+
+static void
+release_probed_device( HotplugEvent *event )
+{
+     if (event->probed.fd < 0)
+          return;
+
+     if (direct_config_has_name( "linux-input-grab" ) && !direct_config_has_name( "no-linux-input-grab" ))
+          ioctl( event->probed.fd, EVIOCGRAB, 0 );
+
+     close( event->probed.fd );
+
+     event->probed.fd = -1;
+}
+
+/*
+ * Open and probe all created device nodes of the batch in parallel.
+ */
+static void
+probe_udev_batch( HotplugEvent *batch,
+                  int           num )
+{
+     int i;
+
+     for (i = 0; i < num; i++) {
+          if (!batch[i].add)
+               continue;
+
+          batch[i].thread = direct_thread_create( DTT_INPUT, hotplug_probe_thread, &batch[i], "DevInput Probe" );
+          if (!batch[i].thread)
+               hotplug_probe_thread( NULL, &batch[i] );
+     }
+
+     for (i = 0; i < num; i++) {
+          if (!batch[i].thread)
+               continue;
+
+          direct_thread_join( batch[i].thread );
+          direct_thread_destroy( batch[i].thread );
+
+          batch[i].thread = NULL;
+     }
+}
+
+/*
+ * Register the probed devices and remove the devices of removed nodes, in the order of the udev events.
+ */
+static void
+handle_udev_batch( HotplugThreadData *data,
+                   HotplugEvent      *batch,
+                   int                num )
+{
+     DFBResult ret;
+     int       i, index;
+
+     for (i = 0; i < num; i++) {
+          HotplugEvent *event = &batch[i];
+
+          if (event->add) {
+               D_DEBUG_AT( Linux_Input, "Device node /dev/input/event%d is created by udev\n", event->device_num );
+
+               if (event->probed.fd < 0) {
+                    D_DEBUG_AT( Linux_Input, "  -> not usable\n" );
+                    continue;
+               }
+
+               ret = register_device_node( event->device_num, &index );
+               if (ret == DFB_OK) {
+                    probed_devices[index] = &event->probed;
+
+                    /* Handle the input device node creation. */
+                    ret = dfb_input_create_device( index, data->core, data->driver );
+                    if (ret != DFB_OK) {
+                         D_DEBUG_AT( Linux_Input, "Failed to create the device for /dev/input/event%d\n",
+                                     event->device_num );
+                    }
+
+                    probed_devices[index] = NULL;
+               }
+
+               /* Close the device if it has not been taken over. */
+               release_probed_device( event );
+          }
+          else {
+               D_DEBUG_AT( Linux_Input, "Device node /dev/input/event%d is removed by udev\n", event->device_num );
+
+               ret = unregister_device_node( event->device_num, &index );
+               if (ret == DFB_OK) {
+                    /* Handle the input device node removal. */
+                    ret = dfb_input_remove_device( index, data->driver );
+                    if (ret != DFB_OK) {
+                         D_DEBUG_AT( Linux_Input, "Failed to remove the device for /dev/input/event%d\n",
+                                     event->device_num );
+                    }
+               }
+          }
+     }
+}
+
 static void *
 devinput_hotplug_thread( DirectThread *thread,
                          void         *arg )
@@ -1697,6 +1953,8 @@ devinput_hotplug_thread( DirectThread *thread,
      int                 status;
      int                 fdmax;
      struct sockaddr_un  sock_addr;
+     HotplugEvent       *batch;
+     bool                quit = false;
 
      D_DEBUG_AT( Linux_Input, "%s()\n", __FUNCTION__ );
 
@@ -1718,93 +1976,107 @@ devinput_hotplug_thread( DirectThread *thread,
      if (status < 0)
           goto error;
 
+     batch = D_CALLOC( HOTPLUG_BATCH_SIZE, sizeof(HotplugEvent) );
+     if (!batch) {
+          D_OOM();
+          goto error;
+     }
+
      fdmax = MAX( socket_fd, hotplug_quitpipe[0] );
 
-     while (1) {
-          DFBResult  ret;
-          fd_set     set;
-          char       udev_event[1024];
-          ssize_t    len;
-          char      *pos;
-          char      *event_content;
-          int        device_num, index;
-
-          /* Get udev event. */
-          FD_ZERO( &set );
-          FD_SET( socket_fd, &set );
-          FD_SET( hotplug_quitpipe[0], &set );
+     while (!quit) {
+          struct timeval  timeout;
+          struct timeval *wait  = NULL;
+          int             num   = 0;
+          long long       start = 0;
+
+          /* Collect udev events until none arrive within the batch time, up to the maximum batch time. */
+          while (1) {
+               fd_set  set;
+               char    udev_event[1024];
+               ssize_t len;
+               bool    add;
+               int     device_num;
+
+               FD_ZERO( &set );
+               FD_SET( socket_fd, &set );
+               FD_SET( hotplug_quitpipe[0], &set );
+
+               status = select( fdmax + 1, &set, NULL, NULL, wait );
+               if (status < 0 && errno != EINTR) {
+                    quit = true;
+                    break;
+               }
 
-          status = select( fdmax + 1, &set, NULL, NULL, NULL );
-          if (status < 0 && errno != EINTR)
-               break;
+               if (status == 0)
+                    break;
 
-          if (FD_ISSET( hotplug_quitpipe[0], &set ))
-               break;
+               if (status < 0)
+                    continue;
+
+               if (FD_ISSET( hotplug_quitpipe[0], &set )) {
+                    quit = true;
+                    break;
+               }
+
+               if (!FD_ISSET( socket_fd, &set ))
+                    continue;
 
-          if (FD_ISSET( socket_fd, &set )) {
-               len = recv( socket_fd, udev_event, sizeof(udev_event), 0 );
+               len = recv( socket_fd, udev_event, sizeof(udev_event) - 1, 0 );
                if (len <= 0) {
                     D_DEBUG_AT( Linux_Input, "Error receiving uevent message\n" );
                     continue;
                }
-          }
 
-          /* Analyze udev event. */
-          pos = strchr( udev_event, '@' );
-          if (pos == NULL)
-               continue;
+               udev_event[len] = '\0';
+
+               /* Analyze udev event. */
+               if (!parse_udev_event( udev_event, &add, &device_num ))
+                    continue;
 
-          /* Replace '@' with '\0' to separate event type and event content. */
-          *pos = '\0';
+               batch_udev_event( batch, &num, add, device_num );
 
-          event_content = pos + 1;
+               /* Restart the batch time with each event. */
+               if (!wait) {
+                    start = direct_clock_get_millis();
+                    wait  = &timeout;
+               }
+               else if (direct_clock_get_millis() - start >= HOTPLUG_BATCH_MAX_TIME)
+                    break;
 
-          pos = strstr( event_content, "/event" );
-          if (pos == NULL)
+               timeout.tv_sec  = 0;
+               timeout.tv_usec = HOTPLUG_BATCH_TIME * 1000;
+          }
+
+          if (quit)
+               break;
+
+          if (!num)
                continue;
 
-          /* Get input device number. */
-          device_num = atoi( pos + 6 );
+          /* Probe the created device nodes without holding the lock. */
+          probe_udev_batch( batch, num );
 
           /* Attempt to lock the driver suspended mutex. */
           pthread_mutex_lock( &driver_suspended_lock );
+
           if (driver_suspended) {
                /* Release the lock and stop udev event handling. */
                D_DEBUG_AT( Linux_Input, "Driver is suspended, no udev processing\n" );
-               pthread_mutex_unlock( &driver_suspended_lock );
-               continue;
-          }
-
-          /* Handle udev event since the driver is not suspended. */
-          if (!strcmp( udev_event, "add" )) {
-               D_DEBUG_AT( Linux_Input, "Device node /dev/input/event%d is created by udev\n", device_num );
 
-               ret = register_device_node( device_num, &index );
-               if (ret == DFB_OK) {
-                    /* Handle the input device node creation. */
-                    ret = dfb_input_create_device( index, data->core, data->driver );
-                    if (ret != DFB_OK) {
-                         D_DEBUG_AT( Linux_Input, "Failed to create the device for /dev/input/event%d\n", device_num );
-                    }
-               }
+               while (num--)
+                    release_probed_device( &batch[num] );
           }
-          else if (!strcmp( udev_event, "remove" )) {
-               D_DEBUG_AT( Linux_Input, "Device node /dev/input/event%d is removed by udev\n", device_num );
-
-               ret = unregister_device_node( device_num, &index );
-               if (ret == DFB_OK) {
-                    /* Handle the input device node removal. */
-                    ret = dfb_input_remove_device( index, data->driver );
-                    if (ret != DFB_OK) {
-                         D_DEBUG_AT( Linux_Input, "Failed to remove the device for /dev/input/event%d\n", device_num );
-                    }
-               }
+          else {
+               /* Handle the whole batch of udev events since the driver is not suspended. */
+               handle_udev_batch( data, batch, num );
           }
 
           /* udev event handling is complete so release the lock. */
           pthread_mutex_unlock( &driver_suspended_lock );
      }
 
+     D_FREE( batch );
      D_FREE( data );
 
      D_DEBUG_AT( Linux_Input, "DevInput Hotplug thread terminated\n" );
@@ -16,9 +16,13 @@
    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 */
 
+#include <core/CoreDFB.h>
 #include <core/fonts.h>
+#include <core/gfxcard.h>
 #include <core/surface.h>
+#include <core/surface_pool.h>
 #include <dgiff.h>
+#include <direct/filesystem.h>
 #include <direct/hash.h>
 #include <directfb_util.h>
 #include <media/idirectfbfont.h>
@@ -39,31 +43,134 @@ DIRECT_INTERFACE_IMPLEMENTATION( IDirectFBFont, DGIFF )
 /**********************************************************************************************************************/
 
 typedef struct {
-     CoreSurface **rows;     /* bitmaps of loaded glyphs */
-     int           num_rows;
+     DirectMutex                            lock;
+     int                                    refs;         /* font and preallocated rows not destroyed yet */
+
+     CoreSurface                          **rows;         /* bitmaps of loaded glyphs */
+     int                                    num_rows;
+     bool                                   prealloc;     /* some rows use the content in place */
+
+     unsigned char                         *content;      /* content owned by the implementation */
+     unsigned int                           content_size;
+     IDirectFBFont_ProbeContextContentType  content_type;
 } DGIFFImplData;
 
+typedef struct {
+     Reaction                               reaction;     /* destruction listener of a preallocated row */
+     DGIFFImplData                         *data;
+} DGIFFRowLink;
+
+/* The dispatcher may still access a reaction after its removal, the link is freed with the next one. */
+static DirectMutex   removed_lock = DIRECT_MUTEX_INITIALIZER();
+static DGIFFRowLink *removed_link = NULL;
+
 /**********************************************************************************************************************/
 
 static void
-IDirectFBFont_DGIFF_Destruct( IDirectFBFont *thiz )
+release_content( unsigned char                         *content,
+                 unsigned int                           content_size,
+                 IDirectFBFont_ProbeContextContentType  content_type )
 {
-     DGIFFImplData *data = ((IDirectFBFont_data*) thiz->priv)->font->impl_data;
+     switch (content_type) {
+          case IDFBFONT_CONTEXT_CONTENT_TYPE_MALLOCED:
+               D_FREE( content );
+               break;
 
-     D_DEBUG_AT( Font_DGIFF, "%s( %p )\n", __FUNCTION__, thiz );
+          case IDFBFONT_CONTEXT_CONTENT_TYPE_MAPPED:
+               direct_file_unmap( content, content_size );
+               break;
 
-     if (data->rows) {
-          int i;
+          default:
+               D_BUG( "unexpected content type %u", content_type );
+     }
+}
 
-          for (i = 0; i < data->num_rows; i++) {
-               if (data->rows[i])
-                    dfb_surface_unref( data->rows[i] );
-          }
+static void
+unref_data( DGIFFImplData *data )
+{
+     int refs;
+
+     direct_mutex_lock( &data->lock );
+
+     refs = --data->refs;
+
+     direct_mutex_unlock( &data->lock );
+
+     if (refs)
+          return;
+
+     D_DEBUG_AT( Font_DGIFF, "%s( %p ) <- releasing\n", __FUNCTION__, data );
+
+     if (data->content) {
+          /* Pending operations may still read from the rows. */
+          if (data->prealloc)
+               dfb_gfxcard_sync();
 
-          D_FREE( data->rows );
+          release_content( data->content, data->content_size, data->content_type );
      }
 
+     direct_mutex_deinit( &data->lock );
+
      D_FREE( data );
+}
+
+static ReactionResult
+row_listener( const void *msg_data,
+              void       *ctx )
+{
+     const CoreSurfaceNotification *notification = msg_data;
+     DGIFFRowLink                  *link         = ctx;
+
+     if (!(notification->flags & CSNF_DESTROY))
+          return RS_OK;
+
+     D_DEBUG_AT( Font_DGIFF, "%s( %p ) <- row %p destroyed\n", __FUNCTION__, link->data, notification->surface );
+
+     unref_data( link->data );
+
+     direct_mutex_lock( &removed_lock );
+
+     if (removed_link)
+          D_FREE( removed_link );
+
+     removed_link = link;
+
+     direct_mutex_unlock( &removed_lock );
+
+     return RS_REMOVE;
+}
+
+static void
+release_rows( DGIFFImplData *data )
+{
+     int i;
+
+     if (!data->rows)
+          return;
+
+     for (i = 0; i < data->num_rows; i++) {
+          if (data->rows[i])
+               dfb_surface_unref( data->rows[i] );
+     }
+
+     D_FREE( data->rows );
+
+     data->rows = NULL;
+}
+
+static void
+IDirectFBFont_DGIFF_Destruct( IDirectFBFont *thiz )
+{
+     IDirectFBFont_data *idata = thiz->priv;
+     DGIFFImplData      *data  = idata->font->impl_data;
+
+     D_DEBUG_AT( Font_DGIFF, "%s( %p )\n", __FUNCTION__, thiz );
+
+     /* Preallocated rows may still be referenced elsewhere, e.g. as the source of a state, the content is released
+        when the last one is destroyed. */
+     release_rows( data );
+
+     unref_data( data );
 
      IDirectFBFont_Destruct( thiz );
 }
@@ -83,6 +190,88 @@ IDirectFBFont_DGIFF_Release( IDirectFBFont *thiz )
 
 /**********************************************************************************************************************/
 
+/*
+ * Create a surface using the pixel data of the row in place, the content is kept until the surface is destroyed.
+ */
+static DFBResult
+create_preallocated_row( CoreDFB               *core,
+                         const DGIFFGlyphRow   *row,
+                         DFBSurfacePixelFormat  format,
+                         CoreSurface          **ret_surface )
+{
+     DFBResult             ret;
+     DFBSurfaceDescription desc;
+     CoreSurfaceConfig     config;
+
+     if (row->pitch < DFB_BYTES_PER_LINE( format, row->width ))
+          return DFB_UNSUPPORTED;
+
+     desc.flags                 = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_PREALLOCATED;
+     desc.width                 = row->width;
+     desc.height                = row->height;
+     desc.pixelformat           = format;
+     desc.preallocated[0].data  = (void*) (row + 1);
+     desc.preallocated[0].pitch = row->pitch;
+
+     config.flags      = CSCONF_SIZE | CSCONF_FORMAT | CSCONF_COLORSPACE | CSCONF_CAPS | CSCONF_PREALLOCATED;
+     config.size.w     = row->width;
+     config.size.h     = row->height;
+     config.format     = format;
+     config.colorspace = DFB_COLORSPACE_DEFAULT( format );
+     config.caps       = DSCAPS_NONE;
+
+     ret = dfb_surface_pools_prealloc( &desc, &config );
+     if (ret)
+          return ret;
+
+     return CoreDFB_CreateSurface( core, &config, CSTF_PREALLOCATED, 0, NULL, ret_surface );
+}
+
+/*
+ * Map the font file again, private and writable, so that the rows can be used in place as surfaces.
+ */
+static DFBResult
+map_private( const char     *filename,
+             unsigned int    size,
+             unsigned char **ret_content )
+{
+     DFBResult       ret;
+     DirectFile      fd;
+     DirectFileInfo  info;
+     void           *ptr;
+
+     ret = direct_file_open( &fd, filename, O_RDONLY, 0 );
+     if (ret)
+          return ret;
+
+     ret = direct_file_get_info( &fd, &info );
+     if (ret)
+          goto out;
+
+     /* The file may have been replaced since it was probed. */
+     if (info.size != size) {
+          ret = DFB_UNSUPPORTED;
+          goto out;
+     }
+
+     ret = direct_file_map( &fd, NULL, 0, size, DFP_READ | DFP_WRITE | DFP_PRIVATE, &ptr );
+     if (ret)
+          goto out;
+
+     if (strncmp( ptr, "DGIFF", 5 )) {
+          direct_file_unmap( ptr, size );
+          ret = DFB_UNSUPPORTED;
+          goto out;
+     }
+
+     *ret_content = ptr;
+
+out:
+     direct_file_close( &fd );
+
+     return ret;
+}
+
 static DFBResult
 Probe( IDirectFBFont_ProbeContext *ctx )
 {
@@ -105,8 +294,11 @@ Construct( IDirectFBFont              *thiz,
      const DGIFFFaceHeader *faceheader;
      DGIFFGlyphInfo        *glyphs;
      DGIFFGlyphRow         *row;
-     CoreFont              *font = NULL;
-     DGIFFImplData         *data = NULL;
+     CoreFont              *font         = NULL;
+     DGIFFImplData         *data         = NULL;
+     unsigned char         *content      = ctx->content;
+     unsigned int           content_size = ctx->content_size;
+     bool                   prealloc     = false;
 
      D_DEBUG_AT( Font_DGIFF, "%s( %p )\n", __FUNCTION__, thiz );
 
@@ -119,8 +311,25 @@ Construct( IDirectFBFont              *thiz,
 
      D_DEBUG_AT( Font_DGIFF, "  -> font at pixel height %d\n", desc->height );
 
-     header     = (void*) ctx->content;
-     faceheader = (void*) ctx->content + sizeof(DGIFFHeader);
+     /* Use the rows in place if the content can be owned by the font, i.e. not provided by the application. A file is
+        mapped again as a private copy, as the content of the interface is mapped read-only. */
+     switch (ctx->content_type) {
+          case IDFBFONT_CONTEXT_CONTENT_TYPE_MAPPED:
+               if (ctx->filename && map_private( ctx->filename, content_size, &content ) == DFB_OK)
+                    prealloc = true;
+               break;
+
+          case IDFBFONT_CONTEXT_CONTENT_TYPE_MALLOCED:
+               ctx->content = NULL;
+               prealloc     = true;
+               break;
+
+          default:
+               break;
+     }
+
+     header     = (void*) content;
+     faceheader = (void*) content + sizeof(DGIFFHeader);
 
      /* Lookup requested face. */
      for (i = 0; i < header->num_faces; i++) {
@@ -167,6 +376,17 @@ Construct( IDirectFBFont              *thiz,
           goto error;
      }
 
+     direct_mutex_init( &data->lock );
+
+     data->refs = 1;
+
+     /* The font owns the content now. */
+     if (prealloc) {
+          data->content      = content;
+          data->content_size = content_size;
+          data->content_type = ctx->content_type;
+     }
+
      data->num_rows = faceheader->num_rows;
 
      /* Allocate array for glyph cache rows. */
@@ -178,16 +398,41 @@ Construct( IDirectFBFont              *thiz,
 
      /* Build glyph cache rows. */
      for (i = 0; i < data->num_rows; i++) {
-          ret = dfb_surface_create_simple( core, row->width, row->height, faceheader->pixelformat,
-                                           DFB_COLORSPACE_DEFAULT( faceheader->pixelformat ), DSCAPS_NONE, CSTF_NONE, 0,
-                                           NULL, &data->rows[i] );
-          if (ret) {
-               D_DERROR( ret, "DGIFF/Font: Could not create %s %dx%d glyph row surface!\n",
-                         dfb_pixelformat_name( faceheader->pixelformat ), row->width, row->height );
-               goto error;
+          if (prealloc &&
+              create_preallocated_row( core, row, faceheader->pixelformat, &data->rows[i] ) == DFB_OK) {
+               DGIFFRowLink *link = D_CALLOC( 1, sizeof(DGIFFRowLink) );
+
+               if (link)
+                    link->data = data;
+
+               /* Keep the content until the row is destroyed. */
+               if (!link || dfb_surface_attach( data->rows[i], row_listener, link, &link->reaction )) {
+                    if (link)
+                         D_FREE( link );
+
+                    dfb_surface_unref( data->rows[i] );
+                    data->rows[i] = NULL;
+               }
+               else {
+                    D_DEBUG_AT( Font_DGIFF, "  -> row %d preallocated\n", i );
+
+                    data->refs++;
+                    data->prealloc = true;
+               }
           }
 
-          dfb_surface_write_buffer( data->rows[i], DSBR_BACK, row + 1, row->pitch, NULL );
+          if (!data->rows[i]) {
+               ret = dfb_surface_create_simple( core, row->width, row->height, faceheader->pixelformat,
+                                                DFB_COLORSPACE_DEFAULT( faceheader->pixelformat ), DSCAPS_NONE,
+                                                CSTF_NONE, 0, NULL, &data->rows[i] );
+               if (ret) {
+                    D_DERROR( ret, "DGIFF/Font: Could not create %s %dx%d glyph row surface!\n",
+                              dfb_pixelformat_name( faceheader->pixelformat ), row->width, row->height );
+                    goto error;
+               }
+
+               dfb_surface_write_buffer( data->rows[i], DSBR_BACK, row + 1, row->pitch, NULL );
+          }
 
           /* Jump to next row. */
           row = (void*) (row + 1) + row->pitch * row->height;
@@ -230,22 +475,16 @@ Construct( IDirectFBFont              *thiz,
      return DFB_OK;
 
 error:
-     if (font) {
-          if (data) {
-               if (data->rows) {
-                    for (i = 0; i < data->num_rows; i++) {
-                         if (data->rows[i])
-                              dfb_surface_unref( data->rows[i] );
-                    }
-
-                    D_FREE( data->rows );
-               }
+     if (data) {
+          release_rows( data );
 
-               D_FREE( data );
-          }
+          unref_data( data );
+     }
+     else if (prealloc)
+          release_content( content, content_size, ctx->content_type );
 
+     if (font)
           dfb_font_destroy( font );
-     }
 
      return ret;
 }
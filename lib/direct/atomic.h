@@ -24,4 +24,10 @@
 #define D_SYNC_ADD_AND_FETCH(ptr,value) \
      __sync_add_and_fetch( ptr, value )
 
+#define D_SYNC_BOOL_COMPARE_AND_SWAP(ptr,old_value,new_value) \
+     __sync_bool_compare_and_swap( ptr, old_value, new_value )
+
+#define D_SYNC_SYNCHRONIZE() \
+     __sync_synchronize()
+
 #endif
@@ -28,26 +28,32 @@ typedef struct {
 } DirectEntry;
 
 typedef enum {
-     DFP_NONE  = 0x00000000,
+     DFP_NONE    = 0x00000000,
 
-     DFP_READ  = 0x00000001,
-     DFP_WRITE = 0x00000002,
+     DFP_READ    = 0x00000001,
+     DFP_WRITE   = 0x00000002,
+     DFP_PRIVATE = 0x00000004, /* copy-on-write mapping, changes are not written back to the file */
 
-     DFP_ALL   = 0x00000003
+     DFP_ALL     = 0x00000007
 } DirectFilePermission;
 
 typedef enum {
-     DFIF_NONE = 0x00000000,
+     DFIF_NONE  = 0x00000000,
 
-     DFIF_SIZE = 0x00000001,
+     DFIF_SIZE  = 0x00000001,
+     DFIF_ID    = 0x00000002,
+     DFIF_MTIME = 0x00000004,
 
-     DFIF_ALL  = 0x00000001
+     DFIF_ALL   = 0x00000007
 } DirectFileInfoFlags;
 
 typedef struct {
      DirectFileInfoFlags flags;
 
      size_t              size;
+     u64                 device;  /* device and inode identify the file */
+     u64                 inode;
+     long long           mtime;   /* time of last modification in microseconds */
 } DirectFileInfo;
 
 #define R_OK 4
@@ -249,7 +249,7 @@ direct_file_map( DirectFile            *file,
 {
      void *map;
      int   prot = 0;
-     int   flags = MAP_SHARED;
+     int   flags = (perms & DFP_PRIVATE) ? MAP_PRIVATE : MAP_SHARED;
 
      D_ASSERT( file != NULL );
      D_ASSERT( ret_addr != NULL );
@@ -294,8 +294,11 @@ direct_file_get_info( DirectFile     *file,
      if (fstat( file->fd, &st ) < 0)
           return errno2result( errno );
 
-     ret_info->flags = DFIF_SIZE;
-     ret_info->size  = st.st_size;
+     ret_info->flags  = DFIF_SIZE | DFIF_ID | DFIF_MTIME;
+     ret_info->size   = st.st_size;
+     ret_info->device = st.st_dev;
+     ret_info->inode  = st.st_ino;
+     ret_info->mtime  = st.st_mtim.tv_sec * 1000000LL + st.st_mtim.tv_nsec / 1000;
 
      return DR_OK;
 }
@@ -41,6 +41,8 @@ const char   *fusion_config_usage =
      "  call-bin-max-num=<n>           Set maximum call number for async call buffer (default = 512, 0 = disable)\n"
      "  call-bin-max-data=<n>          Set maximum call data size for async call buffer (default = 65536)\n"
      "  [no-]shutdown-info             Dump objects from all pools if some objects remain alive\n"
+     "  [no-]shm-hugepages             Advise transparent huge pages for shared memory pools (needs shmem THP enabled\n"
+     "                                 in 'advise' mode or a tmpfs mounted with 'huge=advise')\n"
      "\n";
 
 /**********************************************************************************************************************/
@@ -201,6 +203,12 @@ fusion_config_set( const char *name,
      } else
      if (strcmp( name, "no-shutdown-info" ) == 0) {
           fusion_config->shutdown_info = false;
+     } else
+     if (strcmp( name, "shm-hugepages" ) == 0) {
+          fusion_config->shm_hugepages = true;
+     } else
+     if (strcmp( name, "no-shm-hugepages" ) == 0) {
+          fusion_config->shm_hugepages = false;
      }
      else
           return DR_INVARG;
@@ -37,6 +37,7 @@ typedef struct {
      unsigned int  call_bin_max_num;
      unsigned int  call_bin_max_data;
      bool          shutdown_info;
+     bool          shm_hugepages;
 } FusionConfig;
 
 /**********************************************************************************************************************/
@@ -494,6 +494,19 @@ _fusion_shfree( shmalloc_heap *heap,
 
 /**********************************************************************************************************************/
 
+/*
+ * Ask for transparent huge pages backing the mapping of the shared memory file, which is only a hint to the kernel.
+ */
+static void
+advise_hugepages( void *addr,
+                  int   size )
+{
+#ifdef MADV_HUGEPAGE
+     if (fusion_config->shm_hugepages && madvise( addr, size, MADV_HUGEPAGE ))
+          D_DEBUG_AT( Fusion_SHMHeap, "  -> no transparent huge pages (%s)\n", strerror( errno ) );
+#endif
+}
+
 DirectResult
 __shmalloc_init_heap( FusionSHM  *shm,
                       const char *filename,
@@ -562,6 +575,8 @@ __shmalloc_init_heap( FusionSHM  *shm,
 
      direct_file_close( &fd );
 
+     advise_hugepages( heap, size + space );
+
      D_DEBUG_AT( Fusion_SHMHeap, "  -> done\n" );
 
      heap->size     = size;
@@ -640,6 +655,8 @@ __shmalloc_join_heap( FusionSHM  *shm,
 
      direct_file_close( &fd );
 
+     advise_hugepages( heap, size );
+
      D_MAGIC_ASSERT( heap, shmalloc_heap );
 
      D_DEBUG_AT( Fusion_SHMHeap, "  -> done\n" );
@@ -255,7 +255,7 @@ ISurface_Real__PreLockBuffer2( CoreSurface             *obj,
      D_DEBUG_AT( DirectFB_CoreSurface, "  -> buffer %p\n", buffer );
 
      if (!lock && access & CSAF_READ) {
-          if (fusion_vector_is_empty( &buffer->allocs )) {
+          if (fusion_vector_is_empty( &buffer->allocs ) && !(buffer->flags & CSBF_CLEAR)) {
                dfb_surface_unlock( obj );
                return DFB_NOALLOCATION;
           }
@@ -354,7 +354,7 @@ ISurface_Real__PreLockBuffer3( CoreSurface             *obj,
      D_DEBUG_AT( DirectFB_CoreSurface, "  -> buffer %p\n", buffer );
 
      if (!lock && access & CSAF_READ) {
-          if (fusion_vector_is_empty( &buffer->allocs )) {
+          if (fusion_vector_is_empty( &buffer->allocs ) && !(buffer->flags & CSBF_CLEAR)) {
                dfb_surface_unlock( obj );
                return DFB_NOALLOCATION;
           }
@@ -22,17 +22,26 @@
 #include <core/surface.h>
 #include <direct/hash.h>
 #include <direct/map.h>
+#include <direct/thread.h>
 #include <direct/utf8.h>
 #include <directfb_util.h>
+#include <fusion/conf.h>
+#include <fusion/hash.h>
+#include <fusion/shmalloc.h>
 
 D_DEBUG_DOMAIN( Core_Font,         "Core/Font",          "DirectFB Core Font" );
 D_DEBUG_DOMAIN( Font_Cache,        "Core/Font/Cache",    "DirectFB Core Font Cache" );
 D_DEBUG_DOMAIN( Font_CacheRow,     "Core/Font/CacheRow", "DirectFB Core Font Cache Row" );
 D_DEBUG_DOMAIN( Core_FontSurfaces, "Core/Font/Surf",     "DirectFB Core Font Surfaces" );
 D_DEBUG_DOMAIN( Font_Manager,      "Core/Font/Manager",  "DirectFB Core Font Manager" );
+D_DEBUG_DOMAIN( Font_Share,        "Core/Font/Share",    "DirectFB Core Font Share" );
+D_DEBUG_DOMAIN( Font_Prefetch,     "Core/Font/Prefetch", "DirectFB Core Font Prefetch" );
 
 /**********************************************************************************************************************/
 
+/* Number of rows an atlas page is made of (and accounted for). */
+#define FONT_ATLAS_PAGE_ROWS 8
+
 struct __DFB_CoreFontCache {
      int                magic;
 
@@ -42,9 +51,23 @@ struct __DFB_CoreFontCache {
 
      unsigned int       row_width;
 
+     bool               atlas;        /* glyphs are packed into 2D pages instead of rows */
+     unsigned int       page_rows;    /* number of rows accounted for a page */
+     unsigned int       page_height;  /* height of a page */
+     CoreSurface       *staging;      /* glyphs are rendered here before being copied into a page */
+
      DirectLink        *rows;
+
+     CoreFontCacheRow **free_rows;    /* rows by trailing space in steps of 8 pixels, last for any glyph width */
+     unsigned int       num_free;     /* number of entries in free_rows */
 };
 
+typedef struct {
+     int x;
+     int y;
+     int width;
+} FontAtlasNode;
+
 struct __DFB_CoreFontCacheRow {
      DirectLink           link;
 
@@ -54,12 +77,74 @@ struct __DFB_CoreFontCacheRow {
 
      unsigned long long   stamp;
 
+     CoreFontCacheRow    *lru_prev;    /* manager wide list, least recently used first */
+     CoreFontCacheRow    *lru_next;
+
+     CoreFontCacheRow    *free_prev;   /* cache's list of rows with similar trailing space */
+     CoreFontCacheRow    *free_next;
+     int                  free_index;  /* entry in the cache's free_rows, -1 if not listed */
+
+     unsigned int         rows;        /* number of rows accounted in the manager */
+     unsigned int         bytes;       /* memory of the surface accounted in the manager, 0 for imported rows */
+
      CoreSurface         *surface;
      unsigned int         next_x;
 
+     FontAtlasNode       *skyline;     /* top of the used area of a page, ordered by x */
+     int                  num_nodes;
+     int                  max_nodes;
+
      DirectLink          *glyphs;
 };
 
+/* Faces with shared glyphs, in the main shared memory pool. */
+typedef struct {
+     int                 magic;
+
+     FusionSkirmish      lock;
+
+     FusionHash         *faces;       /* CoreFontShare by key */
+} FontShareRegistry;
+
+struct __DFB_CoreFontShare {
+     int                 magic;
+
+     char               *key;         /* identity of the font file, description and render attributes */
+     int                 refs;        /* number of fonts attached in all processes */
+
+     FusionHash         *glyphs;      /* FontShareGlyph by index and layer */
+};
+
+typedef struct {
+     u32                 surface_id;  /* font surface containing the glyph bitmap, 0 if the glyph has none */
+     FusionID            owner;       /* process the glyph has been rendered by */
+
+     int                 start;
+     int                 y;
+     int                 width;
+     int                 height;
+     int                 left;
+     int                 top;
+     int                 xadvance;
+     int                 yadvance;
+} FontShareGlyph;
+
+#define FONT_SHARE_KEY(index,layer) ((void*)(long) ((index) << 1 | (layer)))
+
+#define FONT_PHASE_KEY(index,phase) ((unsigned long) (index) << 2 | (phase))
+
+/* Glyphs to be rendered in the background. */
+typedef struct {
+     DirectLink            link;
+
+     int                   magic;
+
+     CoreFont             *font;
+
+     unsigned int         *indices;
+     int                   num;
+} FontPrefetch;
+
 struct __DFB_CoreFontManager {
      int                 magic;
 
@@ -72,10 +157,213 @@ struct __DFB_CoreFontManager {
      unsigned int        max_rows;
      unsigned int        num_rows;
      unsigned long long  row_stamp;
+
+     int                 lock_depth;  /* number of times the lock is held by its owner */
+
+     unsigned long long  bytes;       /* memory of the cache row surfaces */
+
+     struct {
+          unsigned long long  hits;
+          unsigned long long  misses;
+          unsigned int        evictions;
+          unsigned int        trims;
+     } stats;
+
+     CoreFontCacheRow   *lru_first;
+     CoreFontCacheRow   *lru_last;
+
+     FontShareRegistry  *share;
+
+     struct {
+          DirectMutex      lock;
+          DirectWaitQueue  cond;
+          DirectThread    *thread;
+
+          DirectLink      *jobs;       /* FontPrefetch in order of submission */
+          FontPrefetch    *current;    /* job being processed by the thread */
+          bool             cancel;     /* stop processing the current job */
+          bool             quit;
+     } prefetch;
 };
 
 /**********************************************************************************************************************/
 
+static void
+font_manager_lru_remove( CoreFontManager  *manager,
+                         CoreFontCacheRow *row )
+{
+     if (row->lru_prev)
+          row->lru_prev->lru_next = row->lru_next;
+     else
+          manager->lru_first = row->lru_next;
+
+     if (row->lru_next)
+          row->lru_next->lru_prev = row->lru_prev;
+     else
+          manager->lru_last = row->lru_prev;
+
+     row->lru_prev = NULL;
+     row->lru_next = NULL;
+}
+
+static void
+font_manager_lru_append( CoreFontManager  *manager,
+                         CoreFontCacheRow *row )
+{
+     row->lru_prev = manager->lru_last;
+     row->lru_next = NULL;
+
+     if (manager->lru_last)
+          manager->lru_last->lru_next = row;
+     else
+          manager->lru_first = row;
+
+     manager->lru_last = row;
+}
+
+/*
+ * Mark the row as most recently used.
+ */
+static void
+font_manager_touch_row( CoreFontManager  *manager,
+                        CoreFontCacheRow *row )
+{
+     row->stamp = manager->row_stamp++;
+
+     if (manager->lru_last != row) {
+          font_manager_lru_remove( manager, row );
+          font_manager_lru_append( manager, row );
+     }
+}
+
+static void
+font_cache_free_remove( CoreFontCache    *cache,
+                        CoreFontCacheRow *row )
+{
+     if (row->free_index < 0)
+          return;
+
+     if (row->free_prev)
+          row->free_prev->free_next = row->free_next;
+     else
+          cache->free_rows[row->free_index] = row->free_next;
+
+     if (row->free_next)
+          row->free_next->free_prev = row->free_prev;
+
+     row->free_prev  = NULL;
+     row->free_next  = NULL;
+     row->free_index = -1;
+}
+
+/*
+ * (Re)insert the row into the free space index according to its trailing space.
+ */
+static void
+font_cache_free_update( CoreFontCache    *cache,
+                        CoreFontCacheRow *row )
+{
+     unsigned int space = cache->row_width - row->next_x;
+     int          index;
+
+     font_cache_free_remove( cache, row );
+
+     if (space >= cache->type.height)
+          index = cache->num_free - 1;
+     else
+          index = space / 8;
+
+     /* Not enough space for any glyph. */
+     if (!index)
+          return;
+
+     row->free_index = index;
+     row->free_next  = cache->free_rows[index];
+
+     if (row->free_next)
+          row->free_next->free_prev = row;
+
+     cache->free_rows[index] = row;
+}
+
+/*
+ * Make the glyph available to fonts sharing the glyphs of this font.
+ */
+static void
+font_share_publish( CoreFont      *font,
+                    CoreGlyphData *data )
+{
+     DFBResult            ret;
+     FontShareGlyph      *glyph;
+     CoreFontManager     *manager  = font->manager;
+     FontShareRegistry   *registry = manager->share;
+     CoreFontShare       *share    = font->share;
+     FusionSHMPoolShared *pool     = dfb_core_shmpool( manager->core );
+
+     D_MAGIC_ASSERT( registry, FontShareRegistry );
+     D_MAGIC_ASSERT( share, CoreFontShare );
+
+     glyph = SHMALLOC( pool, sizeof(FontShareGlyph) );
+     if (!glyph) {
+          D_OOSHM();
+          return;
+     }
+
+     glyph->surface_id = data->row ? data->row->surface->object.id : 0;
+     glyph->owner      = manager->core->fusion_id;
+     glyph->start      = data->start;
+     glyph->y          = data->y;
+     glyph->width      = data->width;
+     glyph->height     = data->height;
+     glyph->left       = data->left;
+     glyph->top        = data->top;
+     glyph->xadvance   = data->xadvance;
+     glyph->yadvance   = data->yadvance;
+
+     fusion_skirmish_prevail( &registry->lock );
+
+     ret = fusion_hash_replace( share->glyphs, FONT_SHARE_KEY( data->index, data->layer ), glyph, NULL, NULL );
+
+     fusion_skirmish_dismiss( &registry->lock );
+
+     if (ret) {
+          SHFREE( pool, glyph );
+          return;
+     }
+
+     data->published = true;
+}
+
+/*
+ * Withdraw the glyph before its bitmap is released, unless it has been published again in the meantime.
+ */
+static void
+font_share_withdraw( CoreFont      *font,
+                     CoreGlyphData *data )
+{
+     FontShareGlyph    *glyph;
+     void              *key      = FONT_SHARE_KEY( data->index, data->layer );
+     CoreFontManager   *manager  = font->manager;
+     FontShareRegistry *registry = manager->share;
+     CoreFontShare     *share    = font->share;
+
+     D_MAGIC_ASSERT( registry, FontShareRegistry );
+     D_MAGIC_ASSERT( share, CoreFontShare );
+
+     fusion_skirmish_prevail( &registry->lock );
+
+     glyph = fusion_hash_lookup( share->glyphs, key );
+     if (glyph && glyph->owner == manager->core->fusion_id &&
+         glyph->surface_id == (data->row ? data->row->surface->object.id : 0))
+          fusion_hash_remove( share->glyphs, key, NULL, NULL );
+
+     fusion_skirmish_dismiss( &registry->lock );
+
+     data->published = false;
+}
+
+/**********************************************************************************************************************/
+
 DFBResult
 dfb_font_manager_create( CoreDFB          *core,
                          CoreFontManager **ret_manager )
@@ -141,6 +429,232 @@ font_cache_map_hash( DirectMap  *map,
      return (type->height * 131 + type->pixel_format) * 131 + type->surface_caps;
 }
 
+/*
+ * Create the registry of shared faces in the master, lookup the one of the master in slaves.
+ */
+static void
+font_manager_share_init( CoreFontManager *manager )
+{
+     DFBResult            ret;
+     FontShareRegistry   *registry;
+     FusionSHMPoolShared *pool = dfb_core_shmpool( manager->core );
+
+     if (!dfb_core_is_master( manager->core )) {
+          if (core_arena_get_shared_field( manager->core, "Core/Font/Share", (void**) &registry ) == DR_OK) {
+               D_MAGIC_ASSERT( registry, FontShareRegistry );
+
+               manager->share = registry;
+          }
+
+          return;
+     }
+
+     registry = SHCALLOC( pool, 1, sizeof(FontShareRegistry) );
+     if (!registry) {
+          D_OOSHM();
+          return;
+     }
+
+     ret = fusion_hash_create( pool, HASH_STRING, HASH_PTR, 17, &registry->faces );
+     if (ret) {
+          SHFREE( pool, registry );
+          return;
+     }
+
+     fusion_skirmish_init( &registry->lock, "Font Share", dfb_core_world( manager->core ) );
+
+     D_MAGIC_SET( registry, FontShareRegistry );
+
+     ret = core_arena_add_shared_field( manager->core, "Core/Font/Share", registry );
+     if (ret) {
+          D_DERROR( ret, "Core/Font: Could not register font share!\n" );
+          fusion_skirmish_destroy( &registry->lock );
+          fusion_hash_destroy( registry->faces );
+          D_MAGIC_CLEAR( registry );
+          SHFREE( pool, registry );
+          return;
+     }
+
+     manager->share = registry;
+}
+
+static bool
+destroy_share( FusionHash *hash,
+               void       *key,
+               void       *value,
+               void       *ctx )
+{
+     CoreFontShare       *share = value;
+     FusionSHMPoolShared *pool  = ctx;
+
+     D_MAGIC_ASSERT( share, CoreFontShare );
+
+     D_DEBUG_AT( Font_Share, "  -> '%s' still used by %d fonts\n", share->key, share->refs );
+
+     fusion_hash_destroy( share->glyphs );
+
+     D_MAGIC_CLEAR( share );
+
+     SHFREE( pool, share->key );
+     SHFREE( pool, share );
+
+     return false;
+}
+
+static void
+font_manager_share_deinit( CoreFontManager *manager )
+{
+     FontShareRegistry   *registry = manager->share;
+     FusionSHMPoolShared *pool     = dfb_core_shmpool( manager->core );
+
+     D_MAGIC_ASSERT( registry, FontShareRegistry );
+
+     manager->share = NULL;
+
+     if (!dfb_core_is_master( manager->core ))
+          return;
+
+     fusion_hash_iterate( registry->faces, destroy_share, pool );
+     fusion_hash_destroy( registry->faces );
+
+     fusion_skirmish_destroy( &registry->lock );
+
+     D_MAGIC_CLEAR( registry );
+
+     SHFREE( pool, registry );
+}
+
+static void
+font_prefetch_free( FontPrefetch *job )
+{
+     D_MAGIC_CLEAR( job );
+
+     D_FREE( job->indices );
+     D_FREE( job );
+}
+
+static void *
+font_prefetch_thread( DirectThread *thread,
+                      void         *arg )
+{
+     CoreFontManager *manager = arg;
+
+     D_DEBUG_AT( Font_Prefetch, "%s()\n", __FUNCTION__ );
+
+     direct_mutex_lock( &manager->prefetch.lock );
+
+     while (!manager->prefetch.quit) {
+          int           i;
+          FontPrefetch *job = (FontPrefetch*) manager->prefetch.jobs;
+
+          if (!job) {
+               direct_waitqueue_wait( &manager->prefetch.cond, &manager->prefetch.lock );
+               continue;
+          }
+
+          D_MAGIC_ASSERT( job, FontPrefetch );
+
+          direct_list_remove( &manager->prefetch.jobs, &job->link );
+
+          manager->prefetch.current = job;
+          manager->prefetch.cancel  = false;
+
+          D_DEBUG_AT( Font_Prefetch, "  -> rendering %d glyphs of font %p\n", job->num, job->font );
+
+          /* Lock the font per glyph, so that drawing is only delayed by a single glyph. */
+          for (i = 0; i < job->num && !manager->prefetch.cancel && !manager->prefetch.quit; i++) {
+               CoreFont      *font   = job->font;
+               unsigned int   layers = (font->attributes & DFFA_OUTLINED) ? 2 : 1;
+               unsigned int   layer;
+               CoreGlyphData *glyph;
+
+               direct_mutex_unlock( &manager->prefetch.lock );
+
+               dfb_font_lock( font );
+
+               for (layer = 0; layer < layers; layer++)
+                    dfb_font_get_glyph_data( font, job->indices[i], layer, &glyph );
+
+               dfb_font_unlock( font );
+
+               direct_mutex_lock( &manager->prefetch.lock );
+          }
+
+          manager->prefetch.current = NULL;
+
+          direct_waitqueue_broadcast( &manager->prefetch.cond );
+
+          font_prefetch_free( job );
+     }
+
+     direct_mutex_unlock( &manager->prefetch.lock );
+
+     return NULL;
+}
+
+/*
+ * Drop pending jobs of the font, waiting for the thread if it is processing one of them.
+ */
+static void
+font_prefetch_cancel( CoreFontManager *manager,
+                      CoreFont        *font )
+{
+     DirectLink *link, *next;
+
+     direct_mutex_lock( &manager->prefetch.lock );
+
+     direct_list_foreach_safe (link, next, manager->prefetch.jobs) {
+          FontPrefetch *job = (FontPrefetch*) link;
+
+          D_MAGIC_ASSERT( job, FontPrefetch );
+
+          if (job->font == font) {
+               D_DEBUG_AT( Font_Prefetch, "  -> dropping %d glyphs of font %p\n", job->num, font );
+
+               direct_list_remove( &manager->prefetch.jobs, &job->link );
+
+               font_prefetch_free( job );
+          }
+     }
+
+     while (manager->prefetch.current && manager->prefetch.current->font == font) {
+          manager->prefetch.cancel = true;
+
+          direct_waitqueue_wait( &manager->prefetch.cond, &manager->prefetch.lock );
+     }
+
+     direct_mutex_unlock( &manager->prefetch.lock );
+}
+
+static void
+font_manager_prefetch_deinit( CoreFontManager *manager )
+{
+     DirectLink *link, *next;
+
+     if (manager->prefetch.thread) {
+          direct_mutex_lock( &manager->prefetch.lock );
+
+          manager->prefetch.quit = true;
+
+          direct_waitqueue_broadcast( &manager->prefetch.cond );
+
+          direct_mutex_unlock( &manager->prefetch.lock );
+
+          direct_thread_join( manager->prefetch.thread );
+          direct_thread_destroy( manager->prefetch.thread );
+
+          manager->prefetch.thread = NULL;
+     }
+
+     direct_list_foreach_safe (link, next, manager->prefetch.jobs)
+          font_prefetch_free( (FontPrefetch*) link );
+
+     manager->prefetch.jobs = NULL;
+
+     direct_waitqueue_deinit( &manager->prefetch.cond );
+     direct_mutex_deinit( &manager->prefetch.lock );
+}
+
 DFBResult
 dfb_font_manager_init( CoreFontManager *manager,
                        CoreDFB         *core )
@@ -161,6 +675,12 @@ dfb_font_manager_init( CoreFontManager *manager,
 
      direct_recursive_mutex_init( &manager->lock );
 
+     direct_mutex_init( &manager->prefetch.lock );
+     direct_waitqueue_init( &manager->prefetch.cond );
+
+     if (dfb_config->font_share && !fusion_config->secure_fusion)
+          font_manager_share_init( manager );
+
      D_MAGIC_SET( manager, CoreFontManager );
 
      return DFB_OK;
@@ -191,9 +711,14 @@ dfb_font_manager_deinit( CoreFontManager *manager )
      D_ASSERT( manager->max_rows > 0 );
      D_ASSERT( manager->num_rows <= manager->max_rows );
 
+     font_manager_prefetch_deinit( manager );
+
      direct_map_iterate( manager->caches, destroy_caches, NULL );
      direct_map_destroy( manager->caches );
 
+     if (manager->share)
+          font_manager_share_deinit( manager );
+
      direct_mutex_deinit( &manager->lock );
 
      D_MAGIC_CLEAR( manager );
@@ -212,6 +737,8 @@ dfb_font_manager_lock( CoreFontManager *manager )
 
      direct_mutex_lock( &manager->lock );
 
+     manager->lock_depth++;
+
      return DFB_OK;
 }
 
@@ -224,6 +751,8 @@ dfb_font_manager_unlock( CoreFontManager *manager )
      D_ASSERT( manager->max_rows > 0 );
      D_ASSERT( manager->num_rows <= manager->max_rows );
 
+     manager->lock_depth--;
+
      direct_mutex_unlock( &manager->lock );
 
      return DFB_OK;
@@ -271,41 +800,11 @@ dfb_font_manager_get_cache( CoreFontManager          *manager,
      return DFB_OK;
 }
 
-typedef struct {
-     unsigned int      lru_stamp;
-     CoreFontCacheRow *lru_row;
-} FindLruRowContext;
-
-static DirectEnumerationResult
-find_lru_row( DirectMap *map,
-              void      *object,
-              void      *ctx )
-{
-     FindLruRowContext *context = ctx;
-     CoreFontCache     *cache   = object;
-     CoreFontCacheRow  *row;
-
-     D_DEBUG_AT( Font_Manager, "%s( %p )\n", __FUNCTION__, cache );
-
-     D_MAGIC_ASSERT( cache, CoreFontCache );
-
-     direct_list_foreach (row, cache->rows) {
-          D_DEBUG_AT( Font_Manager, "  -> stamp %llu\n", row->stamp );
-
-          if (!context->lru_row || context->lru_stamp > row->stamp) {
-               context->lru_row   = row;
-               context->lru_stamp = row->stamp;
-          }
-     }
-
-     return DENUM_OK;
-}
-
 DFBResult
 dfb_font_manager_remove_lru_row( CoreFontManager *manager )
 {
-     FindLruRowContext  context;
-     CoreFontCache     *cache;
+     CoreFontCacheRow *row;
+     CoreFontCache    *cache;
 
      D_DEBUG_AT( Font_Manager, "%s()\n", __FUNCTION__ );
 
@@ -313,66 +812,211 @@ dfb_font_manager_remove_lru_row( CoreFontManager *manager )
      D_ASSERT( manager->max_rows > 0 );
      D_ASSERT( manager->num_rows <= manager->max_rows );
 
-     context.lru_stamp = 0;
-     context.lru_row   = NULL;
-
-     direct_map_iterate( manager->caches, find_lru_row, &context );
-
-     if (!context.lru_row) {
+     row = manager->lru_first;
+     if (!row) {
           D_ERROR( "Core/Font: Could not find any LRU row!\n" );
           return DFB_ITEMNOTFOUND;
      }
 
-     D_DEBUG_AT( Font_Manager, "  -> row %p (stamp %llu)\n", context.lru_row, context.lru_row->stamp );
+     D_MAGIC_ASSERT( row, CoreFontCacheRow );
+
+     D_DEBUG_AT( Font_Manager, "  -> row %p (stamp %llu)\n", row, row->stamp );
 
-     cache = context.lru_row->cache;
+     cache = row->cache;
 
      D_MAGIC_ASSERT( cache, CoreFontCache );
 
-     direct_list_remove( &cache->rows, &context.lru_row->link );
-
-     dfb_font_cache_row_destroy( context.lru_row );
+     direct_list_remove( &cache->rows, &row->link );
 
      /* Decrease row counter. */
-     manager->num_rows--;
+     manager->num_rows -= row->rows;
+
+     manager->stats.evictions++;
+
+     dfb_font_cache_row_destroy( row );
 
      return DFB_OK;
 }
 
-/**********************************************************************************************************************/
-
 DFBResult
-dfb_font_cache_create( CoreFontManager          *manager,
-                       const CoreFontCacheType  *type,
-                       CoreFontCache           **ret_cache )
+dfb_font_manager_trim( CoreFontManager    *manager,
+                       unsigned long long  bytes,
+                       unsigned long long *ret_released )
 {
-     DFBResult      ret;
-     CoreFontCache *cache;
+     unsigned long long released = 0;
+
+     D_DEBUG_AT( Font_Manager, "%s( %llu )\n", __FUNCTION__, bytes );
 
      D_MAGIC_ASSERT( manager, CoreFontManager );
-     D_ASSERT( manager->max_rows > 0 );
-     D_ASSERT( manager->num_rows <= manager->max_rows );
-     D_ASSERT( type != NULL );
-     D_ASSERT( ret_cache != NULL );
 
-     cache = D_CALLOC( 1, sizeof(CoreFontCache) );
-     if (!cache)
-          return D_OOM();
+     if (ret_released)
+          *ret_released = 0;
 
-     ret = dfb_font_cache_init( cache, manager, type );
-     if (ret) {
-          D_FREE( cache );
-          return ret;
+     /* Rows may be in use by another thread, or by a caller higher up in the stack of this thread. */
+     if (direct_mutex_trylock( &manager->lock ))
+          return DFB_LOCKED;
+
+     if (manager->lock_depth) {
+          direct_mutex_unlock( &manager->lock );
+          return DFB_LOCKED;
      }
 
-     *ret_cache = cache;
+     while (manager->lru_first && released < bytes) {
+          released += manager->lru_first->bytes;
 
-     return DFB_OK;
-}
+          if (dfb_font_manager_remove_lru_row( manager ))
+               break;
 
-DFBResult
-dfb_font_cache_destroy( CoreFontCache *cache )
-{
+          manager->stats.trims++;
+     }
+
+     direct_mutex_unlock( &manager->lock );
+
+     D_DEBUG_AT( Font_Manager, "  -> released %llu bytes, %llu bytes left\n", released, manager->bytes );
+
+     if (ret_released)
+          *ret_released = released;
+
+     return released ? DFB_OK : DFB_ITEMNOTFOUND;
+}
+
+static DirectEnumerationResult
+count_cache_glyphs( DirectMap *map,
+                    void      *object,
+                    void      *ctx )
+{
+     CoreFontCache      *cache = object;
+     CoreFontCacheStats *stats = ctx;
+     CoreFontCacheRow   *row;
+
+     D_MAGIC_ASSERT( cache, CoreFontCache );
+
+     direct_list_foreach (row, cache->rows)
+          stats->glyphs += direct_list_count_elements_EXPENSIVE( row->glyphs );
+
+     return DENUM_OK;
+}
+
+DFBResult
+dfb_font_manager_get_stats( CoreFontManager    *manager,
+                            CoreFontCacheStats *ret_stats )
+{
+     D_DEBUG_AT( Font_Manager, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( manager, CoreFontManager );
+     D_ASSERT( ret_stats != NULL );
+
+     memset( ret_stats, 0, sizeof(CoreFontCacheStats) );
+
+     dfb_font_manager_lock( manager );
+
+     direct_map_iterate( manager->caches, count_cache_glyphs, ret_stats );
+
+     ret_stats->rows      = manager->num_rows;
+     ret_stats->bytes     = manager->bytes;
+     ret_stats->hits      = manager->stats.hits;
+     ret_stats->misses    = manager->stats.misses;
+     ret_stats->evictions = manager->stats.evictions;
+     ret_stats->trims     = manager->stats.trims;
+
+     dfb_font_manager_unlock( manager );
+
+     return DFB_OK;
+}
+
+static DirectEnumerationResult
+dump_cache( DirectMap *map,
+            void      *object,
+            void      *ctx )
+{
+     CoreFontCache      *cache  = object;
+     unsigned int        rows   = 0;
+     unsigned int        glyphs = 0;
+     unsigned long long  bytes  = 0;
+     CoreFontCacheRow   *row;
+
+     D_MAGIC_ASSERT( cache, CoreFontCache );
+
+     direct_list_foreach (row, cache->rows) {
+          rows   += row->rows;
+          glyphs += direct_list_count_elements_EXPENSIVE( row->glyphs );
+          bytes  += row->bytes;
+     }
+
+     printf( "%4u x %4u %8s  %-5s %5u %7u %10llu\n",
+             cache->row_width, cache->atlas ? cache->page_height : cache->type.height,
+             dfb_pixelformat_name( cache->type.pixel_format ), cache->atlas ? "atlas" : "rows", rows, glyphs, bytes );
+
+     return DENUM_OK;
+}
+
+void
+dfb_font_manager_dump( CoreFontManager *manager )
+{
+     CoreFontCacheStats stats;
+     unsigned long long lookups;
+     int                length;
+
+     D_MAGIC_ASSERT( manager, CoreFontManager );
+
+     dfb_font_manager_get_stats( manager, &stats );
+
+     lookups = stats.hits + stats.misses;
+
+     printf( "\n" );
+     printf( "--------------------[ Font Caches ]--------------------%n\n", &length );
+     printf( "Rows %u/%u, %u glyphs, %llu bytes, hit rate %llu%% (%llu/%llu), %u evictions, %u trimmed\n",
+             stats.rows, manager->max_rows, stats.glyphs, stats.bytes, lookups ? stats.hits * 100 / lookups : 0,
+             stats.hits, lookups, stats.evictions, stats.trims );
+     printf( "\n" );
+     printf( "      Size     Format  Type   Rows  Glyphs      Bytes\n" );
+
+     while (length--)
+          putc( '-', stdout );
+
+     printf( "\n" );
+
+     dfb_font_manager_lock( manager );
+
+     direct_map_iterate( manager->caches, dump_cache, NULL );
+
+     dfb_font_manager_unlock( manager );
+}
+
+/**********************************************************************************************************************/
+
+DFBResult
+dfb_font_cache_create( CoreFontManager          *manager,
+                       const CoreFontCacheType  *type,
+                       CoreFontCache           **ret_cache )
+{
+     DFBResult      ret;
+     CoreFontCache *cache;
+
+     D_MAGIC_ASSERT( manager, CoreFontManager );
+     D_ASSERT( manager->max_rows > 0 );
+     D_ASSERT( manager->num_rows <= manager->max_rows );
+     D_ASSERT( type != NULL );
+     D_ASSERT( ret_cache != NULL );
+
+     cache = D_CALLOC( 1, sizeof(CoreFontCache) );
+     if (!cache)
+          return D_OOM();
+
+     ret = dfb_font_cache_init( cache, manager, type );
+     if (ret) {
+          D_FREE( cache );
+          return ret;
+     }
+
+     *ret_cache = cache;
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_font_cache_destroy( CoreFontCache *cache )
+{
      D_MAGIC_ASSERT( cache, CoreFontCache );
 
      dfb_font_cache_deinit( cache );
@@ -406,6 +1050,17 @@ dfb_font_cache_init( CoreFontCache           *cache,
 
      cache->row_width = (cache->row_width + 7) & ~7;
 
+     if (dfb_config->font_atlas) {
+          cache->atlas       = true;
+          cache->page_rows   = MIN( FONT_ATLAS_PAGE_ROWS, manager->max_rows );
+          cache->page_height = cache->page_rows * type->height;
+     }
+     else {
+          cache->num_free  = type->height / 8 + 2;
+          cache->free_rows = D_CALLOC( cache->num_free, sizeof(CoreFontCacheRow*) );
+          if (!cache->free_rows)
+               return D_OOM();
+     }
 
      D_MAGIC_SET( cache, CoreFontCache );
 
@@ -423,6 +1078,12 @@ dfb_font_cache_deinit( CoreFontCache *cache )
           dfb_font_cache_row_destroy( row );
      }
 
+     if (cache->staging)
+          dfb_surface_unref( cache->staging );
+
+     if (cache->free_rows)
+          D_FREE( cache->free_rows );
+
      #if defined(__GNUC__) && __GNUC__ >= 10
      #pragma GCC diagnostic push
      #pragma GCC diagnostic ignored "-Wanalyzer-null-dereference"
@@ -445,10 +1106,10 @@ dfb_font_cache_get_row( CoreFontCache     *cache,
      DFBResult         ret;
      CoreFontManager  *manager;
      CoreFontCacheRow *row;
-     CoreFontCacheRow *best_row = NULL;
-     unsigned int      best_val = 0;
+     unsigned int      index;
 
      D_MAGIC_ASSERT( cache, CoreFontCache );
+     D_ASSERT( !cache->atlas );
      D_ASSERT( ret_row != NULL );
 
      manager = cache->manager;
@@ -465,25 +1126,17 @@ dfb_font_cache_get_row( CoreFontCache     *cache,
           return DFB_OK;
      }
 
-     /* Check for trailing space in each row. */
-     direct_list_foreach (row, cache->rows) {
-          D_MAGIC_ASSERT( row, CoreFontCacheRow );
-
-          /* If glyph fits... */
-          if (row->next_x + width <= cache->row_width) {
-               /* ...and no row yet or this row fits better... */
-               if (!best_row || best_val < row->next_x) {
-                    /* ...remember row. */
-                    best_row = row;
-                    best_val = row->next_x;
-               }
-          }
-     }
+     /* Take a row with the least trailing space the glyph fits in. */
+     for (index = MAX( (width + 7) / 8, 1 ); index < cache->num_free; index++) {
+          row = cache->free_rows[index];
+          if (row) {
+               D_MAGIC_ASSERT( row, CoreFontCacheRow );
+               D_ASSERT( row->next_x + width <= cache->row_width );
 
-     if (best_row) {
-          *ret_row = best_row;
+               *ret_row = row;
 
-          return DFB_OK;
+               return DFB_OK;
+          }
      }
 
      /* Maximum number of rows reached. */
@@ -503,13 +1156,179 @@ dfb_font_cache_get_row( CoreFontCache     *cache,
      direct_list_prepend( &cache->rows, &row->link );
 
      /* Increase row counter in manager. */
-     manager->num_rows++;
+     manager->num_rows += row->rows;
 
      *ret_row = row;
 
      return DFB_OK;
 }
 
+/*
+ * Return the lowest y position the area would have at the skyline node, or -1 if it does not fit.
+ */
+static int
+atlas_fit( const CoreFontCacheRow *row,
+           int                     index,
+           unsigned int            width,
+           unsigned int            height )
+{
+     const CoreFontCache *cache  = row->cache;
+     int                  y      = 0;
+     int                  remain = width;
+
+     if (row->skyline[index].x + width > cache->row_width)
+          return -1;
+
+     while (remain > 0) {
+          D_ASSERT( index < row->num_nodes );
+
+          y = MAX( y, row->skyline[index].y );
+
+          if (y + height > cache->page_height)
+               return -1;
+
+          remain -= row->skyline[index++].width;
+     }
+
+     return y;
+}
+
+static DFBResult
+atlas_insert( CoreFontCacheRow *row,
+              int               index,
+              int               y,
+              unsigned int      width,
+              unsigned int      height )
+{
+     FontAtlasNode *nodes = row->skyline;
+     int            end;
+     int            i;
+
+     if (row->num_nodes == row->max_nodes) {
+          nodes = D_REALLOC( row->skyline, row->max_nodes * 2 * sizeof(FontAtlasNode) );
+          if (!nodes)
+               return D_OOM();
+
+          row->skyline    = nodes;
+          row->max_nodes *= 2;
+     }
+
+     /* Insert the top of the new area. */
+     memmove( &nodes[index+1], &nodes[index], (row->num_nodes - index) * sizeof(FontAtlasNode) );
+
+     nodes[index].y     = y + height;
+     nodes[index].width = width;
+
+     row->num_nodes++;
+
+     /* Cut the nodes covered by the new area. */
+     end = nodes[index].x + width;
+
+     for (i = index + 1; i < row->num_nodes && nodes[i].x < end;) {
+          if (nodes[i].x + nodes[i].width <= end) {
+               memmove( &nodes[i], &nodes[i+1], (row->num_nodes - i - 1) * sizeof(FontAtlasNode) );
+               row->num_nodes--;
+          }
+          else {
+               nodes[i].width -= end - nodes[i].x;
+               nodes[i].x      = end;
+               break;
+          }
+     }
+
+     /* Merge neighbours at the same height. */
+     for (i = 0; i < row->num_nodes - 1;) {
+          if (nodes[i].y == nodes[i+1].y) {
+               nodes[i].width += nodes[i+1].width;
+
+               memmove( &nodes[i+1], &nodes[i+2], (row->num_nodes - i - 2) * sizeof(FontAtlasNode) );
+               row->num_nodes--;
+          }
+          else
+               i++;
+     }
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_font_cache_get_area( CoreFontCache     *cache,
+                         unsigned int       width,
+                         unsigned int       height,
+                         CoreFontCacheRow **ret_row,
+                         DFBPoint          *ret_pos )
+{
+     DFBResult         ret;
+     CoreFontManager  *manager;
+     CoreFontCacheRow *row;
+     CoreFontCacheRow *best_row   = NULL;
+     int               best_index = 0;
+     int               best_y     = 0;
+     int               i, y;
+
+     D_MAGIC_ASSERT( cache, CoreFontCache );
+     D_ASSERT( cache->atlas );
+     D_ASSERT( width <= cache->row_width );
+     D_ASSERT( height <= cache->page_height );
+     D_ASSERT( ret_row != NULL );
+     D_ASSERT( ret_pos != NULL );
+
+     manager = cache->manager;
+
+     D_MAGIC_ASSERT( manager, CoreFontManager );
+     D_ASSERT( manager->max_rows > 0 );
+     D_ASSERT( manager->num_rows <= manager->max_rows );
+
+     /* Find the lowest position in the freshest page the area fits in (bottom-left skyline packing). */
+     direct_list_foreach (row, cache->rows) {
+          D_MAGIC_ASSERT( row, CoreFontCacheRow );
+
+          for (i = 0; i < row->num_nodes; i++) {
+               y = atlas_fit( row, i, width, height );
+
+               if (y >= 0 && (!best_row || y < best_y)) {
+                    best_row   = row;
+                    best_index = i;
+                    best_y     = y;
+               }
+          }
+
+          if (best_row)
+               break;
+     }
+
+     if (!best_row) {
+          /* Remove the least recently used rows until the page can be accounted. */
+          while (manager->num_rows + cache->page_rows > manager->max_rows) {
+               ret = dfb_font_manager_remove_lru_row( manager );
+               if (ret)
+                    return ret;
+          }
+
+          /* Create another page. */
+          ret = dfb_font_cache_row_create( cache, &best_row );
+          if (ret)
+               return ret;
+
+          /* Prepend to list (freshest is first). */
+          direct_list_prepend( &cache->rows, &best_row->link );
+
+          /* Increase row counter in manager. */
+          manager->num_rows += best_row->rows;
+     }
+
+     ret_pos->x = best_row->skyline[best_index].x;
+     ret_pos->y = best_y;
+
+     ret = atlas_insert( best_row, best_index, best_y, width, height );
+     if (ret)
+          return ret;
+
+     *ret_row = best_row;
+
+     return DFB_OK;
+}
+
 DFBResult
 dfb_font_cache_row_create( CoreFontCache     *cache,
                            CoreFontCacheRow **ret_row )
@@ -559,14 +1378,33 @@ dfb_font_cache_row_init( CoreFontCacheRow *row,
      D_ASSERT( manager->max_rows > 0 );
      D_ASSERT( manager->num_rows <= manager->max_rows );
 
-     row->cache = cache;
+     row->cache      = cache;
+     row->rows       = cache->atlas ? cache->page_rows : 1;
+     row->free_index = -1;
+
+     if (cache->atlas) {
+          row->skyline = D_MALLOC( 16 * sizeof(FontAtlasNode) );
+          if (!row->skyline)
+               return D_OOM();
+
+          row->skyline[0].x     = 0;
+          row->skyline[0].y     = 0;
+          row->skyline[0].width = cache->row_width;
+
+          row->num_nodes = 1;
+          row->max_nodes = 16;
+     }
 
      /* Create a new font surface. */
-     ret = dfb_surface_create_simple( manager->core, cache->row_width, cache->type.height, cache->type.pixel_format,
-                                      DFB_COLORSPACE_DEFAULT( cache->type.pixel_format ), cache->type.surface_caps,
-                                      CSTF_FONT, dfb_config->font_resource_id, NULL, &row->surface );
+     ret = dfb_surface_create_simple( manager->core, cache->row_width,
+                                      cache->atlas ? cache->page_height : cache->type.height,
+                                      cache->type.pixel_format, DFB_COLORSPACE_DEFAULT( cache->type.pixel_format ),
+                                      cache->type.surface_caps, CSTF_FONT, dfb_config->font_resource_id, NULL,
+                                      &row->surface );
      if (ret) {
           D_DERROR( ret, "Core/Font: Could not create font surface!\n" );
+          if (row->skyline)
+               D_FREE( row->skyline );
           return ret;
      }
 
@@ -574,6 +1412,18 @@ dfb_font_cache_row_init( CoreFontCacheRow *row,
                  manager->num_rows, row->surface->config.size.w, row->surface->config.size.h,
                  dfb_pixelformat_name( row->surface->config.format ) );
 
+     row->bytes = DFB_BYTES_PER_LINE( row->surface->config.format, row->surface->config.size.w ) *
+                  DFB_PLANE_MULTIPLY( row->surface->config.format, row->surface->config.size.h );
+
+     manager->bytes += row->bytes;
+
+     row->stamp = manager->row_stamp++;
+
+     font_manager_lru_append( manager, row );
+
+     if (!cache->atlas)
+          font_cache_free_update( cache, row );
+
      D_MAGIC_SET( row, CoreFontCacheRow );
 
      return DFB_OK;
@@ -583,9 +1433,20 @@ DFBResult
 dfb_font_cache_row_deinit( CoreFontCacheRow *row )
 {
      CoreGlyphData *glyph, *next;
+     CoreFontCache *cache;
 
      D_MAGIC_ASSERT( row, CoreFontCacheRow );
 
+     cache = row->cache;
+
+     D_MAGIC_ASSERT( cache, CoreFontCache );
+
+     font_manager_lru_remove( cache->manager, row );
+
+     font_cache_free_remove( cache, row );
+
+     cache->manager->bytes -= row->bytes;
+
      /* Kick out all glyphs. */
      direct_list_foreach_safe (glyph, next, row->glyphs) {
           CoreFont *font = glyph->font;
@@ -593,10 +1454,23 @@ dfb_font_cache_row_deinit( CoreFontCacheRow *row )
           D_MAGIC_ASSERT( glyph, CoreGlyphData );
           D_ASSERT( glyph->layer < D_ARRAY_SIZE(font->layers) );
 
-          direct_hash_remove( font->layers[glyph->layer].glyph_hash, glyph->index );
+          if (glyph->published)
+               font_share_withdraw( font, glyph );
+
+          if (glyph->phase) {
+               direct_hash_remove( font->layers[glyph->layer].phase_hash, FONT_PHASE_KEY( glyph->index, glyph->phase ) );
+          }
+          else {
+               direct_hash_remove( font->layers[glyph->layer].glyph_hash, glyph->index );
+
+               if (glyph->index < 128)
+                    font->layers[glyph->layer].glyph_data[glyph->index] = NULL;
+          }
+
+          /* Invalidate text layouts referencing the glyph. */
+          font->glyph_serial++;
 
-          if (glyph->index < 128)
-               font->layers[glyph->layer].glyph_data[glyph->index] = NULL;
+          font->cache_stats.evictions++;
 
           D_MAGIC_CLEAR( glyph );
           D_FREE( glyph );
@@ -604,6 +1478,9 @@ dfb_font_cache_row_deinit( CoreFontCacheRow *row )
 
      dfb_surface_unref( row->surface );
 
+     if (row->skyline)
+          D_FREE( row->skyline );
+
      D_MAGIC_CLEAR( row );
 
      return DFB_OK;
@@ -640,6 +1517,17 @@ dfb_font_create( CoreDFB                   *core,
           }
      }
 
+     if (dfb_config->max_font_runs > 0) {
+          ret = direct_hash_create( 17, &font->runs.hash );
+          if (ret) {
+               for (i = 0; i < DFB_FONT_MAX_LAYERS; i++)
+                    direct_hash_destroy( font->layers[i].glyph_hash );
+
+               D_FREE( font );
+               return ret;
+          }
+     }
+
      font->core          = core;
      font->manager       = dfb_core_font_manager( core );
      font->description   = *description;
@@ -656,6 +1544,12 @@ dfb_font_create( CoreDFB                   *core,
           font->surface_caps = DSCAPS_PREMULTIPLIED;
      }
 
+     /* Shifted glyphs are interpolated per byte, which requires one byte per pixel or per channel. */
+     if (font->pixel_format == DSPF_A8 || font->pixel_format == DSPF_ARGB || font->pixel_format == DSPF_ABGR)
+          font->subpixel_phases = dfb_config->font_subpixel_phases;
+     else
+          font->subpixel_phases = 1;
+
      D_MAGIC_SET( font, CoreFont );
 
      *ret_font = font;
@@ -663,65 +1557,202 @@ dfb_font_create( CoreDFB                   *core,
      return DFB_OK;
 }
 
-void
-dfb_font_destroy( CoreFont *font )
+static void
+font_share_detach( CoreFont *font )
 {
-     int i;
-
-     D_DEBUG_AT( Core_Font, "%s()\n", __FUNCTION__ );
-
-     D_MAGIC_ASSERT( font, CoreFont );
-     D_ASSERT( font->encodings != NULL || !font->last_encoding );
+     CoreFontShare       *share    = font->share;
+     FontShareRegistry   *registry = font->manager->share;
+     FusionSHMPoolShared *pool     = dfb_core_shmpool( font->core );
 
-     dfb_font_dispose( font );
+     D_MAGIC_ASSERT( registry, FontShareRegistry );
+     D_MAGIC_ASSERT( share, CoreFontShare );
 
-     for (i = 0; i < DFB_FONT_MAX_LAYERS; i++)
-          direct_hash_destroy( font->layers[i].glyph_hash );
+     fusion_skirmish_prevail( &registry->lock );
 
-     for (i = DTEID_OTHER; i <= font->last_encoding; i++) {
-          CoreFontEncoding *encoding = font->encodings[i];
+     if (!--share->refs) {
+          D_DEBUG_AT( Font_Share, "  -> destroying '%s'\n", share->key );
 
-          D_ASSERT( encoding != NULL );
-          D_ASSERT( encoding->name != NULL );
+          fusion_hash_remove( registry->faces, share->key, NULL, NULL );
+          fusion_hash_destroy( share->glyphs );
 
-          D_MAGIC_CLEAR( encoding );
+          D_MAGIC_CLEAR( share );
 
-          D_FREE( encoding->name );
-          D_FREE( encoding );
+          SHFREE( pool, share->key );
+          SHFREE( pool, share );
      }
 
-     if (font->encodings)
-          D_FREE( font->encodings );
-
-     D_MAGIC_CLEAR( font );
+     fusion_skirmish_dismiss( &registry->lock );
 
-     D_FREE( font );
+     font->share = NULL;
 }
 
-static bool
-free_glyphs( DirectHash    *hash,
-             unsigned long  key,
-             void          *value,
-             void          *ctx )
+DFBResult
+dfb_font_share( CoreFont   *font,
+                const char *identity )
 {
-     CoreGlyphData    *data = value;
-     CoreFontCacheRow *row;
+     DFBResult                 ret;
+     CoreFontShare            *share;
+     char                      key[256];
+     const DFBFontDescription *desc     = &font->description;
+     FontShareRegistry        *registry = font->manager->share;
+     FusionSHMPoolShared      *pool     = dfb_core_shmpool( font->core );
 
-     D_DEBUG_AT( Core_Font, "%s( %lu )\n", __FUNCTION__, key );
+     D_DEBUG_AT( Font_Share, "%s( '%s' )\n", __FUNCTION__, identity );
 
-     D_MAGIC_ASSERT( data, CoreGlyphData );
+     D_MAGIC_ASSERT( font, CoreFont );
+     D_ASSERT( identity != NULL );
+     D_ASSERT( font->share == NULL );
 
-     CORE_GLYPH_DATA_DEBUG_AT( Core_Font, data );
+     if (!registry)
+          return DFB_UNSUPPORTED;
 
-     /* Remove glyph from font. */
-     direct_hash_remove( hash, key );
+     D_MAGIC_ASSERT( registry, FontShareRegistry );
+
+     /* Identify the data and everything the rendering of glyphs depends on. */
+     snprintf( key, sizeof(key), "%s:%x:%d:%d:%u:%d:%d:%d:%d:%d:%d:%x:%x", identity,
+               (desc->flags & DFDESC_ATTRIBUTES)      ? desc->attributes      : 0,
+               (desc->flags & DFDESC_HEIGHT)          ? desc->height          : 0,
+               (desc->flags & DFDESC_WIDTH)           ? desc->width           : 0,
+               (desc->flags & DFDESC_INDEX)           ? desc->index           : 0,
+               (desc->flags & DFDESC_FIXEDADVANCE)    ? desc->fixed_advance   : 0,
+               (desc->flags & DFDESC_FRACT_HEIGHT)    ? desc->fract_height    : 0,
+               (desc->flags & DFDESC_FRACT_WIDTH)     ? desc->fract_width     : 0,
+               (desc->flags & DFDESC_OUTLINE_WIDTH)   ? desc->outline_width   : 0,
+               (desc->flags & DFDESC_OUTLINE_OPACITY) ? desc->outline_opacity : 0,
+               (desc->flags & DFDESC_ROTATION)        ? desc->rotation        : 0,
+               font->pixel_format, font->surface_caps );
+
+     fusion_skirmish_prevail( &registry->lock );
+
+     share = fusion_hash_lookup( registry->faces, key );
+     if (!share) {
+          share = SHCALLOC( pool, 1, sizeof(CoreFontShare) );
+          if (!share) {
+               ret = D_OOSHM();
+               goto error;
+          }
 
-     row = data->row;
-     if (row) {
-          D_MAGIC_ASSERT( row, CoreFontCacheRow );
+          share->key = SHSTRDUP( pool, key );
+          if (!share->key) {
+               ret = D_OOSHM();
+               SHFREE( pool, share );
+               goto error;
+          }
 
-          /* Remove glyph from cache row. */
-          direct_list_remove( &row->glyphs, &data->link );
+          ret = fusion_hash_create( pool, HASH_INT, HASH_PTR, 163, &share->glyphs );
+          if (ret) {
+               SHFREE( pool, share->key );
+               SHFREE( pool, share );
+               goto error;
+          }
+
+          fusion_hash_set_autofree( share->glyphs, false, true );
+
+          ret = fusion_hash_insert( registry->faces, share->key, share );
+          if (ret) {
+               fusion_hash_destroy( share->glyphs );
+               SHFREE( pool, share->key );
+               SHFREE( pool, share );
+               goto error;
+          }
+
+          D_MAGIC_SET( share, CoreFontShare );
+
+          D_DEBUG_AT( Font_Share, "  -> new share '%s'\n", key );
+     }
+
+     D_MAGIC_ASSERT( share, CoreFontShare );
+
+     share->refs++;
+
+     fusion_skirmish_dismiss( &registry->lock );
+
+     font->share = share;
+
+     return DFB_OK;
+
+error:
+     fusion_skirmish_dismiss( &registry->lock );
+
+     return ret;
+}
+
+void
+dfb_font_destroy( CoreFont *font )
+{
+     int i;
+
+     D_DEBUG_AT( Core_Font, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( font, CoreFont );
+     D_ASSERT( font->encodings != NULL || !font->last_encoding );
+
+     font_prefetch_cancel( font->manager, font );
+
+     dfb_font_dispose( font );
+
+     D_DEBUG_AT( Core_Font, "  -> text layouts: %u hits, %u misses\n", font->runs.hits, font->runs.misses );
+
+     if (font->share)
+          font_share_detach( font );
+
+     if (font->runs.hash)
+          direct_hash_destroy( font->runs.hash );
+
+     for (i = 0; i < DFB_FONT_MAX_LAYERS; i++) {
+          direct_hash_destroy( font->layers[i].glyph_hash );
+
+          if (font->layers[i].phase_hash)
+               direct_hash_destroy( font->layers[i].phase_hash );
+     }
+
+     for (i = DTEID_OTHER; i <= font->last_encoding; i++) {
+          CoreFontEncoding *encoding = font->encodings[i];
+
+          D_ASSERT( encoding != NULL );
+          D_ASSERT( encoding->name != NULL );
+
+          D_MAGIC_CLEAR( encoding );
+
+          D_FREE( encoding->name );
+          D_FREE( encoding );
+     }
+
+     if (font->encodings)
+          D_FREE( font->encodings );
+
+     D_MAGIC_CLEAR( font );
+
+     D_FREE( font );
+}
+
+static bool
+free_glyphs( DirectHash    *hash,
+             unsigned long  key,
+             void          *value,
+             void          *ctx )
+{
+     CoreGlyphData    *data = value;
+     CoreFontCacheRow *row;
+
+     D_DEBUG_AT( Core_Font, "%s( %lu )\n", __FUNCTION__, key );
+
+     D_MAGIC_ASSERT( data, CoreGlyphData );
+
+     CORE_GLYPH_DATA_DEBUG_AT( Core_Font, data );
+
+     if (data->published)
+          font_share_withdraw( data->font, data );
+
+     /* Remove glyph from font. */
+     direct_hash_remove( hash, key );
+
+     row = data->row;
+     if (row) {
+          D_MAGIC_ASSERT( row, CoreFontCacheRow );
+
+          /* Remove glyph from cache row. */
+          direct_list_remove( &row->glyphs, &data->link );
 
           /* If cache row got empty, destroy it. */
           if (!row->glyphs) {
@@ -739,39 +1770,430 @@ free_glyphs( DirectHash    *hash,
                /* Remove row from cache. */
                direct_list_remove( &cache->rows, &row->link );
 
+               /* Decrease row counter in manager. */
+               manager->num_rows -= row->rows;
+
                /* Destroy row. */
                dfb_font_cache_row_destroy( row );
+          }
+     }
 
-               /* Decrease row counter in manager. */
-               manager->num_rows--;
+     D_MAGIC_CLEAR( data );
+
+     D_FREE( data );
+
+     return true;
+}
+
+static void
+font_run_remove( CoreFont    *font,
+                 CoreFontRun *run )
+{
+     D_MAGIC_ASSERT( run, CoreFontRun );
+
+     direct_hash_remove( font->runs.hash, run->hash );
+     direct_list_remove( &font->runs.list, &run->link );
+
+     font->runs.num--;
+
+     D_MAGIC_CLEAR( run );
+
+     D_FREE( run );
+}
+
+DFBResult
+dfb_font_dispose( CoreFont *font )
+{
+     int i;
+
+     D_DEBUG_AT( Core_Font, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( font, CoreFont );
+
+     dfb_font_manager_lock( font->manager );
+
+     while (font->runs.list)
+          font_run_remove( font, (CoreFontRun*) font->runs.list );
+
+     for (i = 0; i < DFB_FONT_MAX_LAYERS; i++) {
+          direct_hash_iterate( font->layers[i].glyph_hash, free_glyphs, NULL );
+
+          if (font->layers[i].phase_hash)
+               direct_hash_iterate( font->layers[i].phase_hash, free_glyphs, NULL );
+
+          memset( font->layers[i].glyph_data, 0, sizeof(font->layers[i].glyph_data) );
+     }
+
+     dfb_font_manager_unlock( font->manager );
+
+     return DFB_OK;
+}
+
+typedef struct {
+     CoreFontCacheStats *stats;
+     DirectHash         *rows;    /* rows counted so far */
+} FontStatsContext;
+
+static bool
+count_font_glyphs( DirectHash    *hash,
+                   unsigned long  key,
+                   void          *value,
+                   void          *ctx )
+{
+     CoreGlyphData      *data    = value;
+     FontStatsContext   *context = ctx;
+     CoreFontCacheStats *stats   = context->stats;
+     DirectHash         *rows    = context->rows;
+
+     D_MAGIC_ASSERT( data, CoreGlyphData );
+
+     if (!data->row)
+          return true;
+
+     stats->glyphs++;
+     stats->bytes += DFB_BYTES_PER_LINE( data->font->pixel_format, data->width ) *
+                     DFB_PLANE_MULTIPLY( data->font->pixel_format, data->height );
+
+     /* Count each row once. */
+     if (!direct_hash_lookup( rows, (unsigned long) data->row )) {
+          direct_hash_insert( rows, (unsigned long) data->row, data->row );
+
+          stats->rows++;
+     }
+
+     return true;
+}
+
+DFBResult
+dfb_font_get_cache_stats( CoreFont           *font,
+                          CoreFontCacheStats *ret_stats )
+{
+     DFBResult        ret;
+     int              i;
+     FontStatsContext context;
+
+     D_DEBUG_AT( Core_Font, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( font, CoreFont );
+     D_ASSERT( ret_stats != NULL );
+
+     memset( ret_stats, 0, sizeof(CoreFontCacheStats) );
+
+     ret = direct_hash_create( 17, &context.rows );
+     if (ret)
+          return ret;
+
+     context.stats = ret_stats;
+
+     dfb_font_manager_lock( font->manager );
+
+     for (i = 0; i < DFB_FONT_MAX_LAYERS; i++) {
+          direct_hash_iterate( font->layers[i].glyph_hash, count_font_glyphs, &context );
+
+          if (font->layers[i].phase_hash)
+               direct_hash_iterate( font->layers[i].phase_hash, count_font_glyphs, &context );
+     }
+
+     ret_stats->hits      = font->cache_stats.hits;
+     ret_stats->misses    = font->cache_stats.misses;
+     ret_stats->evictions = font->cache_stats.evictions;
+
+     dfb_font_manager_unlock( font->manager );
+
+     direct_hash_destroy( context.rows );
+
+     return DFB_OK;
+}
+
+/*
+ * Let the font implementation render the glyph into the staging surface and copy it to its area in the atlas page.
+ */
+static DFBResult
+render_atlas_glyph( CoreFontCache    *cache,
+                    CoreFont         *font,
+                    unsigned int      index,
+                    CoreGlyphData    *data,
+                    CoreFontCacheRow *row,
+                    const DFBPoint   *pos )
+{
+     DFBResult     ret;
+     DFBRectangle  rect;
+     int           pitch;
+     void         *buffer;
+
+     D_MAGIC_ASSERT( cache, CoreFontCache );
+     D_MAGIC_ASSERT( row, CoreFontCacheRow );
+
+     if (!cache->staging) {
+          ret = dfb_surface_create_simple( font->core, cache->type.height, cache->type.height,
+                                           cache->type.pixel_format, DFB_COLORSPACE_DEFAULT( cache->type.pixel_format ),
+                                           cache->type.surface_caps, CSTF_FONT, dfb_config->font_resource_id, NULL,
+                                           &cache->staging );
+          if (ret) {
+               D_DERROR( ret, "Core/Font: Could not create font staging surface!\n" );
+               return ret;
+          }
+     }
+
+     data->surface = cache->staging;
+     data->start   = 0;
+     data->y       = 0;
+
+     ret = font->RenderGlyph( font, index, data );
+
+     data->surface = row->surface;
+     data->start   = pos->x;
+     data->y       = pos->y;
+
+     if (ret)
+          return ret;
+
+     rect  = (DFBRectangle) { 0, 0, data->width, data->height };
+     pitch = DFB_BYTES_PER_LINE( cache->type.pixel_format, data->width );
+
+     buffer = D_MALLOC( pitch * data->height );
+     if (!buffer)
+          return D_OOM();
+
+     ret = dfb_surface_read_buffer( cache->staging, DSBR_BACK, buffer, pitch, &rect );
+     if (ret == DFB_OK) {
+          rect.x = pos->x;
+          rect.y = pos->y;
+
+          ret = dfb_surface_write_buffer( row->surface, DSBR_BACK, buffer, pitch, &rect );
+     }
+
+     D_FREE( buffer );
+
+     return ret;
+}
+
+/*
+ * Allocate space for the glyph bitmap in a cache row or atlas page and set its surface and position.
+ */
+static DFBResult
+font_cache_place_glyph( CoreFont          *font,
+                        CoreGlyphData     *data,
+                        CoreFontCache    **ret_cache,
+                        CoreFontCacheRow **ret_row,
+                        DFBPoint          *ret_pos )
+{
+     DFBResult          ret;
+     int                align;
+     CoreFontCacheType  type;
+     CoreFontCache     *cache;
+     CoreFontCacheRow  *row;
+     DFBPoint           pos;
+
+     /* Get the proper cache based on size. */
+     type.height       = MAX( data->height, data->width );
+     type.pixel_format = font->pixel_format;
+     type.surface_caps = font->surface_caps;
+
+     /* Avoid too many surface switches during one string rendering. */
+     type.height       = MAX( font->height, type.height );
+
+     ret = dfb_font_manager_get_cache( font->manager, &type, &cache );
+     if (ret) {
+          D_DEBUG_AT( Core_Font, "  -> could not get cache from manager!\n" );
+          return ret;
+     }
+
+     align = (8 / (DFB_BYTES_PER_PIXEL( font->pixel_format ) ?: 1)) *
+             (DFB_PIXELFORMAT_ALIGNMENT( font->pixel_format ) + 1) - 1;
+
+     if (cache->atlas) {
+          /* Check for an area in an atlas page to use. */
+          ret = dfb_font_cache_get_area( cache, (data->width + align) & ~align, data->height, &row, &pos );
+          if (ret) {
+               D_DEBUG_AT( Core_Font, "  -> could not get area from cache!\n" );
+               return ret;
+          }
+     }
+     else {
+          /* Check for a cache row (surface) to use. */
+          ret = dfb_font_cache_get_row( cache, data->width, &row );
+          if (ret) {
+               D_DEBUG_AT( Core_Font, "  -> could not get row from cache!\n" );
+               return ret;
           }
+
+          pos.x = row->next_x;
+          pos.y = 0;
+
+          row->next_x += (data->width + align) & ~align;
+
+          font_cache_free_update( cache, row );
+     }
+
+     data->row     = row;
+     data->surface = row->surface;
+     data->start   = pos.x;
+     data->y       = pos.y;
+
+     font_manager_touch_row( font->manager, row );
+
+     *ret_cache = cache;
+     *ret_row   = row;
+     *ret_pos   = pos;
+
+     return DFB_OK;
+}
+
+/*
+ * Add a row for a font surface created by another font manager, no glyphs are rendered into it.
+ */
+static DFBResult
+font_cache_import_row( CoreFontCache     *cache,
+                       CoreSurface       *surface,
+                       CoreFontCacheRow **ret_row )
+{
+     DFBResult         ret;
+     CoreFontManager  *manager;
+     CoreFontCacheRow *row;
+     unsigned int      rows = cache->atlas ? cache->page_rows : 1;
+
+     manager = cache->manager;
+
+     D_MAGIC_ASSERT( manager, CoreFontManager );
+
+     /* Remove the least recently used rows until the row can be accounted. */
+     while (manager->num_rows + rows > manager->max_rows) {
+          ret = dfb_font_manager_remove_lru_row( manager );
+          if (ret)
+               return ret;
      }
 
-     D_MAGIC_CLEAR( data );
+     row = D_CALLOC( 1, sizeof(CoreFontCacheRow) );
+     if (!row)
+          return D_OOM();
+
+     row->cache      = cache;
+     row->rows       = rows;
+     row->free_index = -1;
+     row->surface    = surface;
+
+     /* No space left for the rows, no skyline nodes for the pages. */
+     row->next_x     = cache->row_width;
+
+     row->stamp = manager->row_stamp++;
+
+     font_manager_lru_append( manager, row );
+
+     D_MAGIC_SET( row, CoreFontCacheRow );
+
+     /* Append to list, keep the freshest own row first. */
+     direct_list_append( &cache->rows, &row->link );
+
+     manager->num_rows += row->rows;
+
+     *ret_row = row;
+
+     return DFB_OK;
+}
+
+/*
+ * Take the glyph from the shared glyphs if it has been published.
+ */
+static DFBResult
+font_share_lookup( CoreFont          *font,
+                   CoreGlyphData     *data,
+                   CoreFontCacheRow **ret_row )
+{
+     DFBResult          ret;
+     FontShareGlyph    *glyph;
+     FontShareGlyph     shared;
+     CoreFontCacheType  type;
+     CoreSurface       *surface;
+     CoreFontCache     *cache;
+     CoreFontCacheRow  *row;
+     void              *key      = FONT_SHARE_KEY( data->index, data->layer );
+     CoreFontManager   *manager  = font->manager;
+     FontShareRegistry *registry = manager->share;
+     CoreFontShare     *share    = font->share;
+
+     D_MAGIC_ASSERT( registry, FontShareRegistry );
+     D_MAGIC_ASSERT( share, CoreFontShare );
+
+     fusion_skirmish_prevail( &registry->lock );
+
+     glyph = fusion_hash_lookup( share->glyphs, key );
+     if (glyph)
+          shared = *glyph;
+
+     fusion_skirmish_dismiss( &registry->lock );
+
+     if (!glyph)
+          return DFB_ITEMNOTFOUND;
+
+     D_DEBUG_AT( Font_Share, "%s( index %u, layer %u ) <- surface %u of %lu\n", __FUNCTION__,
+                 data->index, data->layer, shared.surface_id, shared.owner );
+
+     if (shared.surface_id) {
+          ret = dfb_core_get_surface( manager->core, shared.surface_id, &surface );
+          if (ret) {
+               D_DEBUG_AT( Font_Share, "  -> surface is gone\n" );
+
+               /* The process which rendered the glyph has been terminated. */
+               fusion_skirmish_prevail( &registry->lock );
 
-     D_FREE( data );
+               glyph = fusion_hash_lookup( share->glyphs, key );
+               if (glyph && glyph->surface_id == shared.surface_id)
+                    fusion_hash_remove( share->glyphs, key, NULL, NULL );
 
-     return true;
-}
+               fusion_skirmish_dismiss( &registry->lock );
 
-DFBResult
-dfb_font_dispose( CoreFont *font )
-{
-     int i;
+               return ret;
+          }
 
-     D_DEBUG_AT( Core_Font, "%s()\n", __FUNCTION__ );
+          /* Get the proper cache based on size, the same as the one of the glyph's surface. */
+          type.height       = MAX( font->height, MAX( shared.height, shared.width ) );
+          type.pixel_format = font->pixel_format;
+          type.surface_caps = font->surface_caps;
 
-     D_MAGIC_ASSERT( font, CoreFont );
+          ret = dfb_font_manager_get_cache( manager, &type, &cache );
+          if (ret) {
+               dfb_surface_unref( surface );
+               return ret;
+          }
 
-     dfb_font_manager_lock( font->manager );
+          /* Look for a row of the surface already in the cache. */
+          direct_list_foreach (row, cache->rows) {
+               D_MAGIC_ASSERT( row, CoreFontCacheRow );
 
-     for (i = 0; i < DFB_FONT_MAX_LAYERS; i++) {
-          direct_hash_iterate( font->layers[i].glyph_hash, free_glyphs, NULL );
+               if (row->surface == surface)
+                    break;
+          }
 
-          memset( font->layers[i].glyph_data, 0, sizeof(font->layers[i].glyph_data) );
+          if (row) {
+               dfb_surface_unref( surface );
+          }
+          else {
+               ret = font_cache_import_row( cache, surface, &row );
+               if (ret) {
+                    dfb_surface_unref( surface );
+                    return ret;
+               }
+          }
+
+          font_manager_touch_row( manager, row );
+
+          data->row     = row;
+          data->surface = surface;
      }
+     else
+          row = NULL;
 
-     dfb_font_manager_unlock( font->manager );
+     data->start    = shared.start;
+     data->y        = shared.y;
+     data->width    = shared.width;
+     data->height   = shared.height;
+     data->left     = shared.left;
+     data->top      = shared.top;
+     data->xadvance = shared.xadvance;
+     data->yadvance = shared.yadvance;
+
+     *ret_row = row;
 
      return DFB_OK;
 }
@@ -784,10 +2206,11 @@ dfb_font_get_glyph_data( CoreFont       *font,
 {
      DFBResult         ret;
      CoreGlyphData    *data;
-     int               align;
+     DFBPoint          pos;
      CoreFontManager  *manager;
      CoreFontCache    *cache;
-     CoreFontCacheRow *row = NULL;
+     CoreFontCacheRow *row     = NULL;
+     bool              publish = false;
 
      D_DEBUG_AT( Core_Font, "%s( index %u, layer %u )\n", __FUNCTION__, index, layer );
 
@@ -807,6 +2230,9 @@ dfb_font_get_glyph_data( CoreFont       *font,
           if (data->retry)
                goto retry;
 
+          font->cache_stats.hits++;
+          manager->stats.hits++;
+
           *ret_data = font->layers[layer].glyph_data[index];
           return DFB_OK;
      }
@@ -822,12 +2248,15 @@ dfb_font_get_glyph_data( CoreFont       *font,
           if (row) {
                D_MAGIC_ASSERT( row, CoreFontCacheRow );
 
-               row->stamp = manager->row_stamp++;
+               font_manager_touch_row( manager, row );
           }
 
           if (data->retry)
                goto retry;
 
+          font->cache_stats.hits++;
+          manager->stats.hits++;
+
           *ret_data = data;
           return DFB_OK;
      }
@@ -837,6 +2266,9 @@ dfb_font_get_glyph_data( CoreFont       *font,
      if (!font->GetGlyphData)
           return DFB_UNSUPPORTED;
 
+     font->cache_stats.misses++;
+     manager->stats.misses++;
+
      /* Allocate glyph data. */
      data = D_CALLOC( 1, sizeof(CoreGlyphData) );
      if (!data)
@@ -848,6 +2280,10 @@ dfb_font_get_glyph_data( CoreFont       *font,
      data->index = index;
      data->layer = layer;
 
+     /* Take the glyph rendered for another font created from the same file. */
+     if (font->share && font_share_lookup( font, data, &row ) == DFB_OK)
+          goto out;
+
 retry:
      data->retry = false;
 
@@ -872,51 +2308,30 @@ retry:
      if (data->width < 1 || data->height < 1) {
           D_DEBUG_AT( Core_Font, "  -> zero size glyph bitmap!\n" );
           data->start = data->width = data->height = 0;
+          publish = true;
           goto out;
      }
 
-     /* Get the proper cache based on size. */
-
-     CoreFontCacheType type;
-
-     type.height       = MAX( data->height, data->width );
-     type.pixel_format = font->pixel_format;
-     type.surface_caps = font->surface_caps;
+     /* Allocate space in the cache. */
+     ret = font_cache_place_glyph( font, data, &cache, &row, &pos );
+     if (ret)
+          goto error;
 
-     /* Avoid too many surface switches during one string rendering. */
-     type.height       = MAX( font->height, type.height );
+     if (cache->atlas) {
+          D_DEBUG_AT( Core_FontSurfaces, "  -> render %u - %2dx%2d at %03d,%03d\n",
+                      index, data->width, data->height, pos.x, pos.y );
 
-     ret = dfb_font_manager_get_cache( font->manager, &type, &cache );
-     if (ret) {
-          D_DEBUG_AT( Core_Font, "  -> could not get cache from manager!\n" );
-          goto error;
+          /* Render the glyph data into the page. */
+          ret = render_atlas_glyph( cache, font, index, data, row, &pos );
      }
+     else {
+          D_DEBUG_AT( Core_FontSurfaces, "  -> render %u - %2dx%2d at %03d\n",
+                      index, data->width, data->height, pos.x );
 
-     /* Check for a cache row (surface) to use. */
-     ret = dfb_font_cache_get_row( cache, data->width, &row );
-     if (ret) {
-          D_DEBUG_AT( Core_Font, "  -> could not get row from cache!\n" );
-          goto error;
+          /* Render the glyph data into the surface. */
+          ret = font->RenderGlyph( font, index, data );
      }
 
-     /* Add the glyph to the cache row. */
-
-     D_DEBUG_AT( Core_FontSurfaces, "  -> render %u - %2dx%2d at %03u\n",
-                 index, data->width, data->height, row->next_x );
-
-     data->row     = row;
-     data->start   = row->next_x;
-     data->surface = row->surface;
-
-     align = (8 / (DFB_BYTES_PER_PIXEL( font->pixel_format ) ?: 1)) *
-             (DFB_PIXELFORMAT_ALIGNMENT( font->pixel_format ) + 1) - 1;
-
-     row->next_x  += (data->width + align) & ~align;
-
-     row->stamp = manager->row_stamp++;
-
-     /* Render the glyph data into the surface. */
-     ret = font->RenderGlyph( font, index, data );
      if (ret) {
           D_DEBUG_AT( Core_Font, "  -> rendering glyph failed!\n" );
           data->start = data->width = data->height = 0;
@@ -932,6 +2347,8 @@ retry:
 
      CORE_GLYPH_DATA_DEBUG_AT( Core_Font, data );
 
+     publish = true;
+
 out:
      if (!data->inserted) {
           if (row)
@@ -945,6 +2362,9 @@ out:
           data->inserted = true;
      }
 
+     if (publish && font->share)
+          font_share_publish( font, data );
+
      *ret_data = data;
 
      return DFB_OK;
@@ -956,6 +2376,427 @@ error:
      return ret;
 }
 
+DFBResult
+dfb_font_get_glyph_phase( CoreFont       *font,
+                          CoreGlyphData  *glyph,
+                          unsigned int    phase,
+                          CoreGlyphData **ret_data )
+{
+     DFBResult         ret;
+     CoreGlyphData    *data;
+     DFBRectangle      rect;
+     DFBPoint          pos;
+     int               x, y, b;
+     int               bpp, src_pitch, dst_pitch;
+     int               w1, w0;
+     u8               *src, *dst;
+     unsigned long     key;
+     CoreFontCache    *cache;
+     CoreFontCacheRow *row;
+     DirectHash       *hash;
+
+     D_DEBUG_AT( Core_Font, "%s( index %u, layer %u, phase %u )\n", __FUNCTION__, glyph->index, glyph->layer, phase );
+
+     D_MAGIC_ASSERT( font, CoreFont );
+     D_MAGIC_ASSERT( glyph, CoreGlyphData );
+     D_ASSERT( phase > 0 && phase < font->subpixel_phases );
+     D_ASSERT( glyph->phase == 0 );
+     D_ASSERT( ret_data != NULL );
+
+     if (!glyph->width)
+          return DFB_UNSUPPORTED;
+
+     hash = font->layers[glyph->layer].phase_hash;
+     if (!hash) {
+          ret = direct_hash_create( 163, &font->layers[glyph->layer].phase_hash );
+          if (ret)
+               return ret;
+
+          hash = font->layers[glyph->layer].phase_hash;
+     }
+
+     key = FONT_PHASE_KEY( glyph->index, phase );
+
+     data = direct_hash_lookup( hash, key );
+     if (data) {
+          D_MAGIC_ASSERT( data, CoreGlyphData );
+
+          if (data->row)
+               font_manager_touch_row( font->manager, data->row );
+
+          *ret_data = data;
+
+          return DFB_OK;
+     }
+
+     /* Read back the glyph bitmap, before making room in the cache may kick it out. */
+     bpp       = DFB_BYTES_PER_PIXEL( font->pixel_format );
+     src_pitch = glyph->width * bpp;
+     dst_pitch = src_pitch + bpp;
+
+     src = D_MALLOC( (src_pitch + dst_pitch) * glyph->height );
+     if (!src)
+          return D_OOM();
+
+     dst = src + src_pitch * glyph->height;
+
+     rect = (DFBRectangle) { glyph->start, glyph->y, glyph->width, glyph->height };
+
+     ret = dfb_surface_read_buffer( glyph->surface, DSBR_BACK, src, src_pitch, &rect );
+     if (ret) {
+          D_FREE( src );
+          return ret;
+     }
+
+     data = D_CALLOC( 1, sizeof(CoreGlyphData) );
+     if (!data) {
+          D_FREE( src );
+          return D_OOM();
+     }
+
+     D_MAGIC_SET( data, CoreGlyphData );
+
+     data->font     = font;
+     data->index    = glyph->index;
+     data->layer    = glyph->layer;
+     data->phase    = phase;
+     data->width    = glyph->width + 1;
+     data->height   = glyph->height;
+     data->left     = glyph->left;
+     data->top      = glyph->top;
+     data->xadvance = glyph->xadvance;
+     data->yadvance = glyph->yadvance;
+
+     /* Interpolate each pixel with its left neighbour. */
+     w1 = (phase << 8) / font->subpixel_phases;
+     w0 = 256 - w1;
+
+     for (y = 0; y < data->height; y++) {
+          const u8 *s = src + y * src_pitch;
+          u8       *d = dst + y * dst_pitch;
+
+          for (x = 0; x < data->width; x++) {
+               for (b = 0; b < bpp; b++) {
+                    int cur  = (x < data->width - 1) ? s[x * bpp + b]       : 0;
+                    int left = (x > 0)               ? s[(x - 1) * bpp + b] : 0;
+
+                    d[x * bpp + b] = (cur * w0 + left * w1) >> 8;
+               }
+          }
+     }
+
+     ret = font_cache_place_glyph( font, data, &cache, &row, &pos );
+     if (ret) {
+          D_MAGIC_CLEAR( data );
+          D_FREE( data );
+          D_FREE( src );
+          return ret;
+     }
+
+     rect = (DFBRectangle) { pos.x, pos.y, data->width, data->height };
+
+     ret = dfb_surface_write_buffer( row->surface, DSBR_BACK, dst, dst_pitch, &rect );
+
+     D_FREE( src );
+
+     /* Keep the entry in its row anyway, the unshifted glyph is drawn for an empty one. */
+     if (ret) {
+          D_DERROR( ret, "Core/Font: Could not write shifted glyph for index %u!\n", data->index );
+          data->start = data->width = data->height = 0;
+     }
+     else
+          dfb_gfxcard_flush_texture_cache();
+
+     direct_list_append( &row->glyphs, &data->link );
+
+     direct_hash_insert( hash, key, data );
+
+     data->inserted = true;
+
+     *ret_data = data;
+
+     return DFB_OK;
+}
+
+/**********************************************************************************************************************/
+
+DFBResult
+dfb_font_prefetch( CoreFont           *font,
+                   const unsigned int *indices,
+                   int                 num )
+{
+     int              i;
+     CoreFontManager *manager;
+     FontPrefetch    *job;
+
+     D_DEBUG_AT( Font_Prefetch, "%s( %p, %d )\n", __FUNCTION__, font, num );
+
+     D_MAGIC_ASSERT( font, CoreFont );
+     D_ASSERT( indices != NULL || num == 0 );
+
+     manager = font->manager;
+
+     D_MAGIC_ASSERT( manager, CoreFontManager );
+
+     if (!font->GetGlyphData)
+          return DFB_UNSUPPORTED;
+
+     job = D_CALLOC( 1, sizeof(FontPrefetch) );
+     if (!job)
+          return D_OOM();
+
+     if (num) {
+          job->indices = D_MALLOC( num * sizeof(unsigned int) );
+          if (!job->indices) {
+               D_FREE( job );
+               return D_OOM();
+          }
+     }
+
+     /* Only queue glyphs which are not cached yet. */
+     dfb_font_lock( font );
+
+     for (i = 0; i < num; i++) {
+          unsigned int index = indices[i];
+
+          if (index < 128 ? font->layers[0].glyph_data[index] != NULL :
+                            direct_hash_lookup( font->layers[0].glyph_hash, index ) != NULL)
+               continue;
+
+          job->indices[job->num++] = index;
+     }
+
+     dfb_font_unlock( font );
+
+     D_DEBUG_AT( Font_Prefetch, "  -> %d glyphs not cached\n", job->num );
+
+     if (!job->num) {
+          if (job->indices)
+               D_FREE( job->indices );
+
+          D_FREE( job );
+
+          return DFB_OK;
+     }
+
+     job->font = font;
+
+     D_MAGIC_SET( job, FontPrefetch );
+
+     direct_mutex_lock( &manager->prefetch.lock );
+
+     if (!manager->prefetch.thread) {
+          manager->prefetch.quit   = false;
+          manager->prefetch.thread = direct_thread_create( DTT_DEFAULT, font_prefetch_thread, manager,
+                                                           "Font Prefetch" );
+          if (!manager->prefetch.thread) {
+               direct_mutex_unlock( &manager->prefetch.lock );
+               font_prefetch_free( job );
+               return DFB_FAILURE;
+          }
+     }
+
+     direct_list_append( &manager->prefetch.jobs, &job->link );
+
+     direct_waitqueue_broadcast( &manager->prefetch.cond );
+
+     direct_mutex_unlock( &manager->prefetch.lock );
+
+     return DFB_OK;
+}
+
+static unsigned int
+font_run_hash( DFBTextEncodingID  encoding,
+               const u8          *text,
+               int                bytes )
+{
+     unsigned int hash = 2166136261u ^ encoding;
+     int          i;
+
+     /* FNV-1a */
+     for (i = 0; i < bytes; i++) {
+          hash ^= text[i];
+          hash *= 16777619u;
+     }
+
+     return hash;
+}
+
+static DFBResult
+font_run_layout( CoreFont           *font,
+                 CoreFontRun        *run,
+                 const unsigned int *indices,
+                 int                 num )
+{
+     int          i;
+     int          x      = 0;
+     int          y      = 0;
+     unsigned int prev   = 0;
+     unsigned int serial = font->glyph_serial;
+
+     run->num = 0;
+
+     memset( &run->ink, 0, sizeof(DFBRectangle) );
+
+     for (i = 0; i < num; i++) {
+          CoreGlyphData *glyph;
+          DFBRectangle   rect;
+          int            kx, ky;
+          unsigned int   current = indices[i];
+
+          if (dfb_font_get_glyph_data( font, current, 0, &glyph )) {
+               prev = current;
+               continue;
+          }
+
+          /* Do not keep layouts with glyphs to be loaded again. */
+          if (glyph->retry)
+               return DFB_BUFFEREMPTY;
+
+          if (prev && font->GetKerning && font->GetKerning( font, prev, current, &kx, &ky ) == DFB_OK) {
+               x += kx << 8;
+               y += ky << 8;
+          }
+
+          rect = (DFBRectangle) { x + (glyph->left << 8), y + (glyph->top << 8), glyph->width << 8, glyph->height << 8 };
+
+          dfb_rectangle_union( &run->ink, &rect );
+
+          if (glyph->width) {
+               int            gx;
+               CoreGlyphData *shifted = dfb_font_position_glyph( font, glyph, x, &gx );
+
+               run->glyphs[run->num] = shifted;
+               run->points[run->num] = (DFBPoint) { gx + shifted->left, (y >> 8) + shifted->top };
+
+               run->num++;
+
+               /* Placing the shifted glyph may have kicked out the glyph, both have the same advance. */
+               glyph = shifted;
+          }
+
+          x   += glyph->xadvance;
+          y   += glyph->yadvance;
+          prev = current;
+     }
+
+     /* Glyphs loaded first may have been kicked out of the cache by the following ones. */
+     if (font->glyph_serial != serial)
+          return DFB_BUFFEREMPTY;
+
+     run->serial   = serial;
+     run->xadvance = x;
+     run->yadvance = y;
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_font_get_run( CoreFont           *font,
+                  DFBTextEncodingID   encoding,
+                  const void         *text,
+                  int                 bytes,
+                  CoreFontRun       **ret_run )
+{
+     DFBResult     ret;
+     CoreFontRun  *run;
+     unsigned int  hash;
+     int           num;
+     unsigned int  indices[bytes];
+
+     D_DEBUG_AT( Core_Font, "%s( %p [%d], %u )\n", __FUNCTION__, text, bytes, encoding );
+
+     D_MAGIC_ASSERT( font, CoreFont );
+     D_ASSERT( text != NULL );
+     D_ASSERT( bytes > 0 );
+     D_ASSERT( ret_run != NULL );
+
+     if (!font->runs.hash)
+          return DFB_UNSUPPORTED;
+
+     hash = font_run_hash( encoding, text, bytes );
+
+     run = direct_hash_lookup( font->runs.hash, hash );
+     if (run) {
+          D_MAGIC_ASSERT( run, CoreFontRun );
+
+          if (run->encoding == encoding && run->bytes == bytes && !memcmp( run->text, text, bytes ) &&
+              run->serial == font->glyph_serial) {
+               CoreFontCacheRow *row = NULL;
+               int               i;
+
+               D_DEBUG_AT( Core_Font, "  -> found %p with %d glyphs\n", run, run->num );
+
+               direct_list_move_to_front( &font->runs.list, &run->link );
+
+               /* Keep the rows holding the glyphs of the run from aging out of the cache. */
+               for (i = 0; i < run->num; i++) {
+                    if (run->glyphs[i]->row && run->glyphs[i]->row != row) {
+                         row = run->glyphs[i]->row;
+
+                         font_manager_touch_row( font->manager, row );
+                    }
+               }
+
+               font->runs.hits++;
+
+               *ret_run = run;
+
+               return DFB_OK;
+          }
+
+          /* Hash collision or glyphs kicked out of the cache, layout again. */
+          font_run_remove( font, run );
+     }
+
+     font->runs.misses++;
+
+     ret = dfb_font_decode_text( font, encoding, text, bytes, indices, &num );
+     if (ret)
+          return ret;
+
+     /* Allocate the run with its glyph, position and text arrays. */
+     run = D_MALLOC( sizeof(CoreFontRun) + num * (sizeof(CoreGlyphData*) + sizeof(DFBPoint)) + bytes );
+     if (!run)
+          return D_OOM();
+
+     memset( run, 0, sizeof(CoreFontRun) );
+
+     run->glyphs = (CoreGlyphData**) (run + 1);
+     run->points = (DFBPoint*) (run->glyphs + num);
+     run->text   = (const u8*) (run->points + num);
+
+     ret = font_run_layout( font, run, indices, num );
+     if (ret) {
+          D_DEBUG_AT( Core_Font, "  -> layout not cached\n" );
+          D_FREE( run );
+          return ret;
+     }
+
+     memcpy( (u8*) run->text, text, bytes );
+
+     run->hash     = hash;
+     run->encoding = encoding;
+     run->bytes    = bytes;
+
+     D_MAGIC_SET( run, CoreFontRun );
+
+     /* Drop least recently used layouts. */
+     while (font->runs.num >= dfb_config->max_font_runs)
+          font_run_remove( font, (CoreFontRun*) direct_list_get_last( font->runs.list ) );
+
+     direct_hash_insert( font->runs.hash, hash, run );
+     direct_list_prepend( &font->runs.list, &run->link );
+
+     font->runs.num++;
+
+     D_DEBUG_AT( Core_Font, "  -> created %p with %d glyphs\n", run, run->num );
+
+     *ret_run = run;
+
+     return DFB_OK;
+}
+
 /**********************************************************************************************************************/
 
 DFBResult
@@ -72,6 +72,7 @@ struct __DFB_CoreFont {
      struct {
           DirectHash              *glyph_hash;
           CoreGlyphData           *glyph_data[128];
+          DirectHash              *phase_hash;      /* glyphs rendered at subpixel positions */
      } layers[DFB_FONT_MAX_LAYERS];
 
      int                           height;          /* font height */
@@ -109,6 +110,26 @@ struct __DFB_CoreFont {
      int                           underline_thickness;
 
      CoreFontFlags                 flags;
+
+     struct {
+          DirectHash              *hash;
+          DirectLink              *list;          /* most recently used first */
+          int                      num;
+          unsigned int             hits;
+          unsigned int             misses;
+     } runs;                                        /* text layout cache */
+
+     unsigned int                  glyph_serial;    /* incremented whenever cached glyphs are kicked out */
+
+     CoreFontShare                *share;           /* glyphs shared with fonts created from the same file */
+
+     unsigned int                  subpixel_phases; /* number of horizontal subpixel positions glyphs are drawn at */
+
+     struct {
+          unsigned long long       hits;
+          unsigned long long       misses;
+          unsigned int             evictions;
+     } cache_stats;                                 /* glyph cache usage, see dfb_font_get_cache_stats() */
 };
 
 #define CORE_FONT_DEBUG_AT(Domain,font)                                   \
@@ -128,6 +149,7 @@ struct __DFB_CoreGlyphData {
 
      CoreSurface      *surface;  /* contains bitmap of glyph */
      int               start;    /* x offset of glyph in surface */
+     int               y;        /* y offset of glyph in surface */
      int               width;    /* width of the glyphs bitmap */
      int               height;   /* height of the glyphs bitmap */
      int               left;     /* x offset of the glyph */
@@ -141,6 +163,9 @@ struct __DFB_CoreGlyphData {
 
      bool              inserted;
      bool              retry;
+     bool              published; /* made available to fonts sharing the glyphs */
+
+     unsigned int      phase;     /* subpixel position in 1/subpixel_phases pixels, 0 for the rendered glyph */
 };
 
 #define CORE_GLYPH_DATA_DEBUG_AT(Domain,data)                           \
@@ -150,6 +175,7 @@ struct __DFB_CoreGlyphData {
           D_DEBUG_AT( Domain, "  -> row      %p\n", (data)->row );      \
           D_DEBUG_AT( Domain, "  -> surface  %p\n", (data)->surface );  \
           D_DEBUG_AT( Domain, "  -> start    %d\n", (data)->start );    \
+          D_DEBUG_AT( Domain, "  -> y        %d\n", (data)->y );        \
           D_DEBUG_AT( Domain, "  -> width    %d\n", (data)->width );    \
           D_DEBUG_AT( Domain, "  -> height   %d\n", (data)->height );   \
           D_DEBUG_AT( Domain, "  -> left     %d\n", (data)->left );     \
@@ -158,6 +184,30 @@ struct __DFB_CoreGlyphData {
           D_DEBUG_AT( Domain, "  -> yadvance %d\n", (data)->yadvance ); \
      } while (0)
 
+/*
+ * Layout of a text string, with the glyphs to blit and their positions relative to the origin of the string.
+ */
+typedef struct {
+     DirectLink          link;
+
+     unsigned int        hash;
+     DFBTextEncodingID   encoding;
+     const u8           *text;
+     int                 bytes;
+
+     unsigned int        serial;    /* glyph serial of the font at layout time */
+
+     int                 num;       /* number of glyphs with a bitmap */
+     CoreGlyphData     **glyphs;
+     DFBPoint           *points;
+
+     int                 xadvance;  /* x placement after the string (1/256 pixels) */
+     int                 yadvance;  /* y placement after the string (1/256 pixels) */
+     DFBRectangle        ink;       /* ink rectangle of the string (1/256 pixels) */
+
+     int                 magic;
+} CoreFontRun;
+
 /**********************************************************************************************************************/
 
 typedef struct {
@@ -166,6 +216,19 @@ typedef struct {
      DFBSurfaceCapabilities surface_caps;
 } CoreFontCacheType;
 
+/*
+ * Glyph cache statistics of a font or of all fonts of a manager.
+ */
+typedef struct {
+     unsigned int           rows;       /* cache rows in use, atlas pages count as the rows accounted for them */
+     unsigned int           glyphs;     /* glyphs stored in the cache rows */
+     unsigned long long     bytes;      /* memory of the cache row surfaces, glyph bitmaps only for a font */
+     unsigned long long     hits;       /* lookups of glyphs already loaded */
+     unsigned long long     misses;     /* glyphs loaded into the cache */
+     unsigned int           evictions;  /* rows (glyphs for a font) kicked out to make room or on memory pressure */
+     unsigned int           trims;      /* rows released on memory pressure, see dfb_font_manager_trim() */
+} CoreFontCacheStats;
+
 /**********************************************************************************************************************/
 
 DFBResult dfb_font_manager_create        ( CoreDFB                      *core,
@@ -188,6 +251,24 @@ DFBResult dfb_font_manager_get_cache     ( CoreFontManager              *manager
 
 DFBResult dfb_font_manager_remove_lru_row( CoreFontManager              *manager );
 
+/*
+ * Release least recently used cache rows until their surfaces account for at least the given number of bytes.
+ *
+ * Called on surface allocation failure, does nothing if the calling thread is using the font caches.
+ * Returns DFB_ITEMNOTFOUND if no row could be released.
+ */
+DFBResult dfb_font_manager_trim          ( CoreFontManager              *manager,
+                                           unsigned long long            bytes,
+                                           unsigned long long           *ret_released );
+
+DFBResult dfb_font_manager_get_stats     ( CoreFontManager              *manager,
+                                           CoreFontCacheStats           *ret_stats );
+
+/*
+ * Print the statistics of the manager and each of its caches to stdout.
+ */
+void      dfb_font_manager_dump          ( CoreFontManager              *manager );
+
 /**********************************************************************************************************************/
 
 DFBResult dfb_font_cache_create          ( CoreFontManager              *manager,
@@ -206,6 +287,12 @@ DFBResult dfb_font_cache_get_row         ( CoreFontCache                *cache,
                                            unsigned int                  width,
                                            CoreFontCacheRow            **ret_row );
 
+DFBResult dfb_font_cache_get_area        ( CoreFontCache                *cache,
+                                           unsigned int                  width,
+                                           unsigned int                  height,
+                                           CoreFontCacheRow            **ret_row,
+                                           DFBPoint                     *ret_pos );
+
 DFBResult dfb_font_cache_row_create      ( CoreFontCache                *cache,
                                            CoreFontCacheRow            **ret_row );
 
@@ -235,6 +322,12 @@ void      dfb_font_destroy               ( CoreFont                     *font );
  */
 DFBResult dfb_font_dispose               ( CoreFont                     *font );
 
+/*
+ * Get the glyph cache statistics of the font.
+ */
+DFBResult dfb_font_get_cache_stats       ( CoreFont                     *font,
+                                           CoreFontCacheStats           *ret_stats );
+
 /*
  * Load glyph data from font.
  */
@@ -243,6 +336,46 @@ DFBResult dfb_font_get_glyph_data        ( CoreFont                     *font,
                                            unsigned int                  layer,
                                            CoreGlyphData               **glyph_data );
 
+/*
+ * Get the glyph shifted to the right by 'phase' / 'subpixel_phases' pixels, the font must be locked.
+ *
+ * The shifted glyph is one pixel wider and created from the given glyph when not cached yet. Placing it may kick the
+ * given glyph out of the cache, so only the returned one may be accessed afterwards.
+ */
+DFBResult dfb_font_get_glyph_phase       ( CoreFont                     *font,
+                                           CoreGlyphData                *glyph,
+                                           unsigned int                  phase,
+                                           CoreGlyphData               **ret_data );
+
+/*
+ * Share glyphs with other fonts created from the same data with the same description, also in other processes.
+ *
+ * The 'identity' of the data has to be unique across processes, e.g. derived from the file or a hash of the content.
+ * To be called after construction of the font, before any glyph is loaded.
+ */
+DFBResult dfb_font_share                 ( CoreFont                     *font,
+                                           const char                   *identity );
+
+/*
+ * Lookup or create the layout of a text string using the first layer, the font must be locked.
+ *
+ * The returned run is valid until the font is unlocked or further glyphs are loaded.
+ */
+DFBResult dfb_font_get_run               ( CoreFont                     *font,
+                                           DFBTextEncodingID             encoding,
+                                           const void                   *text,
+                                           int                           bytes,
+                                           CoreFontRun                 **ret_run );
+
+/*
+ * Render glyphs that are not cached yet in a background thread, to avoid rendering them when drawing.
+ *
+ * Pending glyphs are dropped when the font is destroyed.
+ */
+DFBResult dfb_font_prefetch              ( CoreFont                     *font,
+                                           const unsigned int           *indices,
+                                           int                           num );
+
 /*
  * Register encoding implementations.
  *
@@ -304,4 +437,36 @@ dfb_font_unlock( CoreFont *font )
      dfb_font_manager_unlock( font->manager );
 }
 
+/*
+ * Get the glyph to draw at the horizontal position 'x' (1/256 pixels) and the pixel position to draw it at.
+ * Only the returned glyph may be accessed afterwards.
+ */
+static __inline__ CoreGlyphData *
+dfb_font_position_glyph( CoreFont      *font,
+                         CoreGlyphData *glyph,
+                         int            x,
+                         int           *ret_x )
+{
+     if (font->subpixel_phases > 1 && glyph->width) {
+          int            phases = font->subpixel_phases;
+          int            pos    = (x * phases + 128) >> 8;
+          int            phase  = pos % phases;
+          CoreGlyphData *shifted;
+
+          if (phase < 0)
+               phase += phases;
+
+          *ret_x = (pos - phase) / phases;
+
+          if (phase && dfb_font_get_glyph_phase( font, glyph, phase, &shifted ) == DFB_OK && shifted->width)
+               return shifted;
+
+          return glyph;
+     }
+
+     *ret_x = x >> 8;
+
+     return glyph;
+}
+
 #endif
@@ -3522,78 +3522,100 @@ font_state_restore( CardState *state,
      }
 }
 
-void
-dfb_gfxcard_drawstring( const u8                *text,
-                        int                      bytes,
-                        DFBTextEncodingID        encoding,
-                        int                      x,
-                        int                      y,
-                        CoreFont                *font,
-                        unsigned int             layers,
-                        CoreGraphicsStateClient *client,
-                        DFBSurfaceTextFlags      flags )
+/* Number of glyph blits collected before passing them on. */
+#define DRAWSTRING_MAX_BLITS 50
+
+static bool
+drawstring_clipped( const CoreFont  *font,
+                    const CardState *state,
+                    int              x,
+                    int              y )
+{
+     if (!(font->description.flags & DFDESC_ROTATION) || !font->description.rotation) {
+          if (!(state->render_options & DSRO_MATRIX) &&
+              (x > state->clip.x2 || y > state->clip.y2 ||
+               y + font->height <= state->clip.y1)) {
+               return true;
+          }
+     }
+
+     return false;
+}
+
+/*
+ * Collect the glyph blits of a string, the font must be locked. Collected blits are passed on before the source or
+ * the color of the state change, or if no space is left.
+ */
+static void
+drawstring_glyphs( const u8                *text,
+                   int                      bytes,
+                   DFBTextEncodingID        encoding,
+                   int                      x,
+                   int                      y,
+                   CoreFont                *font,
+                   unsigned int             layers,
+                   CoreGraphicsStateClient *client,
+                   DFBRectangle            *rects,
+                   DFBPoint                *points,
+                   int                     *ret_num_blits )
 {
      DFBResult     ret;
      unsigned int  indices[bytes];
      int           i, l, num;
      int           kern_x;
      int           kern_y;
-     DFBRectangle  rects[50];
-     DFBPoint      points[50];
-     CardState     state_backup;
-     CardState    *state;
-     CoreSurface  *surface;
-     int           num_blits = 0;
+     CardState    *state     = client->state;
+     CoreFontRun  *run;
+     int           num_blits = *ret_num_blits;
      int           ox        = x;
      int           oy        = y;
      unsigned int  prev      = 0;
 
-     D_ASSERT( card != NULL );
-     D_ASSERT( card->shared != NULL );
-
-     D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
+     /* Simple prechecks. */
+     if (drawstring_clipped( font, state, x, y ))
+          return;
 
-     state = client->state;
+     /* Replay the cached layout of the string. */
+     if (layers == 1 && dfb_font_get_run( font, encoding, text, bytes, &run ) == DFB_OK) {
+          for (i = 0; i < run->num; i++) {
+               CoreGlyphData *glyph = run->glyphs[i];
 
-     D_MAGIC_ASSERT( state, CardState );
-     D_MAGIC_ASSERT( state->destination, CoreSurface );
-     D_ASSERT( text != NULL );
-     D_ASSERT( bytes > 0 );
-     D_ASSERT( font != NULL );
+               if (glyph->surface != state->source || num_blits == DRAWSTRING_MAX_BLITS) {
+                    if (num_blits) {
+                         CoreGraphicsStateClient_Blit( client, rects, points, num_blits );
+                         num_blits = 0;
+                    }
 
-     if (encoding == DTEID_UTF8)
-          D_DEBUG_AT( Core_GraphicsOps, "%s( '%s' [%d], %d,%d, %p, %p )\n", __FUNCTION__,
-                      text, bytes, x, y, font, client );
-     else
-          D_DEBUG_AT( Core_GraphicsOps, "%s( %p [%d], %u, %d,%d, %p, %p )\n", __FUNCTION__,
-                      text, bytes, encoding, x, y, font, client );
+                    if (glyph->surface != state->source)
+                         dfb_state_set_source( state, glyph->surface );
+               }
 
-     surface = state->destination;
+               points[num_blits] = (DFBPoint) { ox + run->points[i].x, oy + run->points[i].y };
+               rects[num_blits]  = (DFBRectangle) { glyph->start, glyph->y, glyph->width, glyph->height };
 
-     /* Simple prechecks. */
-     if (!(font->description.flags & DFDESC_ROTATION) || !font->description.rotation) {
-          if (!(state->render_options & DSRO_MATRIX) &&
-              (x > state->clip.x2 || y > state->clip.y2 ||
-               y + font->height <= state->clip.y1)) {
-               return;
+               num_blits++;
           }
+
+          goto out;
      }
 
      /* Decode string to character indices. */
      ret = dfb_font_decode_text( font, encoding, text, bytes, indices, &num );
      if (ret)
-          return;
-
-     font_state_prepare( state, &state_backup, font, surface, !(flags & DSTF_BLEND_FUNCS) );
-
-     dfb_font_lock( font );
+          goto out;
 
      for (l = layers - 1; l >= 0; l--) {
           x = ox << 8;
           y = oy << 8;
 
-          if (layers > 1)
+          if (layers > 1) {
+               if (num_blits) {
+                    CoreGraphicsStateClient_Blit( client, rects, points, num_blits );
+                    num_blits = 0;
+               }
+
                dfb_state_set_color( state, &state->colors[l] );
+          }
 
           /* Blit glyphs. */
           for (i = 0; i < num; i++) {
@@ -3613,33 +3635,139 @@ dfb_gfxcard_drawstring( const u8                *text,
                }
 
                if (glyph->width) {
-                    if (glyph->surface != state->source || num_blits == D_ARRAY_SIZE(rects)) {
+                    int            gx;
+                    CoreGlyphData *shifted = dfb_font_position_glyph( font, glyph, x, &gx );
+
+                    if (shifted->surface != state->source || num_blits == DRAWSTRING_MAX_BLITS) {
                          if (num_blits) {
                               CoreGraphicsStateClient_Blit( client, rects, points, num_blits );
                               num_blits = 0;
                          }
 
-                         if (glyph->surface != state->source)
-                              dfb_state_set_source( state, glyph->surface );
+                         if (shifted->surface != state->source)
+                              dfb_state_set_source( state, shifted->surface );
                     }
 
-                    points[num_blits] = (DFBPoint) { (x >> 8) + glyph->left, (y >> 8) + glyph->top };
-                    rects[num_blits]  = (DFBRectangle) { glyph->start, 0, glyph->width, glyph->height };
+                    points[num_blits] = (DFBPoint) { gx + shifted->left, (y >> 8) + shifted->top };
+                    rects[num_blits]  = (DFBRectangle) { shifted->start, shifted->y, shifted->width, shifted->height };
 
                     num_blits++;
+
+                    /* Placing the shifted glyph may have kicked out the glyph, both have the same advance. */
+                    glyph = shifted;
                }
 
                x   += glyph->xadvance;
                y   += glyph->yadvance;
                prev = current;
           }
+     }
 
-          if (num_blits) {
-               CoreGraphicsStateClient_Blit( client, rects, points, num_blits );
-               num_blits = 0;
-          }
+out:
+     *ret_num_blits = num_blits;
+}
+
+void
+dfb_gfxcard_drawstring( const u8                *text,
+                        int                      bytes,
+                        DFBTextEncodingID        encoding,
+                        int                      x,
+                        int                      y,
+                        CoreFont                *font,
+                        unsigned int             layers,
+                        CoreGraphicsStateClient *client,
+                        DFBSurfaceTextFlags      flags )
+{
+     DFBRectangle  rects[DRAWSTRING_MAX_BLITS];
+     DFBPoint      points[DRAWSTRING_MAX_BLITS];
+     CardState     state_backup;
+     CardState    *state;
+     int           num_blits = 0;
+
+     D_ASSERT( card != NULL );
+     D_ASSERT( card->shared != NULL );
+
+     D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
+
+     state = client->state;
+
+     D_MAGIC_ASSERT( state, CardState );
+     D_MAGIC_ASSERT( state->destination, CoreSurface );
+     D_ASSERT( text != NULL );
+     D_ASSERT( bytes > 0 );
+     D_ASSERT( font != NULL );
+
+     if (encoding == DTEID_UTF8)
+          D_DEBUG_AT( Core_GraphicsOps, "%s( '%s' [%d], %d,%d, %p, %p )\n", __FUNCTION__,
+                      text, bytes, x, y, font, client );
+     else
+          D_DEBUG_AT( Core_GraphicsOps, "%s( %p [%d], %u, %d,%d, %p, %p )\n", __FUNCTION__,
+                      text, bytes, encoding, x, y, font, client );
+
+     /* Simple prechecks. */
+     if (drawstring_clipped( font, state, x, y ))
+          return;
+
+     font_state_prepare( state, &state_backup, font, state->destination, !(flags & DSTF_BLEND_FUNCS) );
+
+     dfb_font_lock( font );
+
+     drawstring_glyphs( text, bytes, encoding, x, y, font, layers, client, rects, points, &num_blits );
+
+     if (num_blits)
+          CoreGraphicsStateClient_Blit( client, rects, points, num_blits );
+
+     dfb_font_unlock( font );
+
+     font_state_restore( state, &state_backup );
+}
+
+void
+dfb_gfxcard_drawstrings( const CardString        *strings,
+                         int                      num,
+                         DFBTextEncodingID        encoding,
+                         CoreFont                *font,
+                         unsigned int             layers,
+                         CoreGraphicsStateClient *client,
+                         DFBSurfaceTextFlags      flags )
+{
+     int           i;
+     DFBRectangle  rects[DRAWSTRING_MAX_BLITS];
+     DFBPoint      points[DRAWSTRING_MAX_BLITS];
+     CardState     state_backup;
+     CardState    *state;
+     int           num_blits = 0;
+
+     D_ASSERT( card != NULL );
+     D_ASSERT( card->shared != NULL );
+
+     D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
+
+     state = client->state;
+
+     D_MAGIC_ASSERT( state, CardState );
+     D_MAGIC_ASSERT( state->destination, CoreSurface );
+     D_ASSERT( strings != NULL );
+     D_ASSERT( font != NULL );
+
+     D_DEBUG_AT( Core_GraphicsOps, "%s( %d, %u, %p, %p )\n", __FUNCTION__, num, encoding, font, client );
+
+     font_state_prepare( state, &state_backup, font, state->destination, !(flags & DSTF_BLEND_FUNCS) );
+
+     dfb_font_lock( font );
+
+     /* Merge the glyph blits of all strings. */
+     for (i = 0; i < num; i++) {
+          D_ASSERT( strings[i].text != NULL );
+          D_ASSERT( strings[i].bytes > 0 );
+
+          drawstring_glyphs( strings[i].text, strings[i].bytes, encoding, strings[i].x, strings[i].y, font, layers,
+                             client, rects, points, &num_blits );
      }
 
+     if (num_blits)
+          CoreGraphicsStateClient_Blit( client, rects, points, num_blits );
+
      dfb_font_unlock( font );
 
      font_state_restore( state, &state_backup );
@@ -3682,7 +3810,7 @@ dfb_gfxcard_drawglyph( CoreGlyphData           **glyph,
 
           /* Blit glyph. */
           if (glyph[l]->width) {
-               DFBRectangle rect  = { glyph[l]->start, 0, glyph[l]->width, glyph[l]->height };
+               DFBRectangle rect  = { glyph[l]->start, glyph[l]->y, glyph[l]->width, glyph[l]->height };
                DFBPoint     point = { x + glyph[l]->left, y + glyph[l]->top };
 
                dfb_state_set_source( state, glyph[l]->surface );
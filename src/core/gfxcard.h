@@ -329,6 +329,13 @@ typedef enum {
      GDLF_RESET      = 0x00000008
 } GraphicsDeviceLockFlags;
 
+typedef struct {
+     const u8          *text;
+     int                bytes;
+     int                x;       /* position of the string origin in the destination */
+     int                y;
+} CardString;
+
 /**********************************************************************************************************************/
 
 DFBResult      dfb_gfxcard_lock                  ( GraphicsDeviceLockFlags        flags );
@@ -443,6 +450,17 @@ void           dfb_gfxcard_drawstring            ( const u8
                                                    CoreGraphicsStateClient       *client,
                                                    DFBSurfaceTextFlags            flags );
 
+/*
+ * Draw several strings with the same font and flags, sharing the state setup and merging the glyph blits.
+ */
+void           dfb_gfxcard_drawstrings           ( const CardString              *strings,
+                                                   int                            num,
+                                                   DFBTextEncodingID              encoding,
+                                                   CoreFont                      *font,
+                                                   unsigned int                   layers,
+                                                   CoreGraphicsStateClient       *client,
+                                                   DFBSurfaceTextFlags            flags );
+
 void           dfb_gfxcard_drawglyph             ( CoreGlyphData                **glyph,
                                                    int                            x,
                                                    int                            y,
@@ -25,11 +25,13 @@
 #include <core/layer_control.h>
 #include <core/system.h>
 #include <core/windowstack.h>
+#include <direct/atomic.h>
 #include <direct/filesystem.h>
-#if !FUSION_BUILD_MULTI
+#include <direct/hash.h>
+#include <direct/memcpy.h>
 #include <direct/system.h>
-#endif /* FUSION_BUILD_MULTI */
 #include <direct/trace.h>
+#include <dfieff.h>
 #include <directfb_keynames.h>
 #include <fusion/conf.h>
 #include <fusion/shmalloc.h>
@@ -58,6 +60,13 @@ typedef struct {
 
      DirectLink         *drivers;
      DirectLink         *devices;
+
+     struct {
+          bool           active;
+          DirectFile     file;
+          DirectMutex    lock;
+          long long      start;
+     } record;                                         /* For input event recording. */
 } DFBInputCore;
 
 DFB_CORE_PART( input_core, InputCore );
@@ -225,10 +234,17 @@ dfb_input_set_global( ReactionFunc func,
 static DFBInputCore       *core_local;
 static DFBInputCoreShared *core_input;
 
-static void init_devices( CoreDFB *core );
-static void flush_keys  ( CoreInputDevice *device );
+static void init_devices      ( CoreDFB *core );
+static void flush_keys        ( CoreInputDevice *device );
+static void free_keymap_lookup( CoreInputDevice *device );
 
 static ReactionResult local_processing_hotplug( const void *msg_data, void *ctx );
+
+static void input_record_start ( DFBInputCore *data );
+static void input_record_stop  ( DFBInputCore *data );
+static void input_record_device( CoreInputDevice *device );
+static void input_record_event ( CoreInputDevice *device, const DFBInputEvent *event );
+
 #if FUSION_BUILD_MULTI
 static Reaction       local_processing_react; /* Local reaction to hot-plug event */
 #endif /* FUSION_BUILD_MULTI */
@@ -274,6 +290,9 @@ dfb_input_core_initialize( CoreDFB            *core,
      }
 #endif /* FUSION_BUILD_MULTI */
 
+     if (dfb_config->input_record)
+          input_record_start( data );
+
      init_devices( core );
 
      D_MAGIC_SET( data, DFBInputCore );
@@ -443,11 +462,16 @@ dfb_input_core_shutdown( DFBInputCore *data,
 
           SHFREE( pool, ishared );
 
+          free_keymap_lookup( device );
+
           D_MAGIC_CLEAR( device );
 
           D_FREE( device );
      }
 
+     if (data->record.active)
+          input_record_stop( data );
+
      D_MAGIC_CLEAR( data );
      D_MAGIC_CLEAR( shared );
 
@@ -483,6 +507,8 @@ dfb_input_core_leave( DFBInputCore *data,
           fusion_ref_down( &ishared->ref, false );
 #endif /* FUSION_BUILD_MULTI */
 
+          free_keymap_lookup( device );
+
           D_FREE( device );
      }
 
@@ -631,10 +657,12 @@ static DFBResult                  load_keymap     ( CoreInputDevice
                                                     char                            *filename );
 static DFBResult                  reload_keymap   ( CoreInputDevice                 *device );
 
-static bool lookup_from_table( CoreInputDevice *device, DFBInputEvent *event, DFBInputEventFlags lookup );
-static void fixup_key_event  ( CoreInputDevice *device, DFBInputEvent *event );
-static void fixup_mouse_event( CoreInputDevice *device, DFBInputEvent *event );
-static bool core_input_filter( CoreInputDevice *device, DFBInputEvent *event );
+static bool update_keymap_lookup( CoreInputDevice *device );
+static bool lookup_from_table   ( CoreInputDevice *device, DFBInputEvent *event, DFBInputEventFlags lookup );
+static void fixup_key_event     ( CoreInputDevice *device, DFBInputEvent *event );
+static void fixup_mouse_event   ( CoreInputDevice *device, DFBInputEvent *event );
+static bool core_input_filter   ( CoreInputDevice *device, DFBInputEvent *event );
+static void update_snapshot     ( CoreInputDevice *device, const DFBInputEvent *event );
 
 void
 dfb_input_enumerate_devices( InputDeviceCallback         callback,
@@ -870,6 +898,12 @@ dfb_input_dispatch( CoreInputDevice *device,
                D_DEBUG_AT( Core_InputEvt, "  => GLOBAL\n" );
      }
 
+     if (core_local->record.active)
+          input_record_event( device, event );
+
+     /* The device state has been changed by the fixup, even if the event gets filtered. */
+     update_snapshot( device, event );
+
      if (core_input_filter( device, event ))
           D_DEBUG_AT( Core_InputEvt, "  ****>> FILTERED\n" );
      else
@@ -1020,6 +1054,7 @@ dfb_input_device_get_state( CoreInputDevice  *device,
                             InputDeviceState *ret_state )
 {
      CoreInputDeviceShared *shared;
+     unsigned int           seq;
 
      D_DEBUG_AT( Core_Input, "%s( %p )\n", __FUNCTION__, device );
 
@@ -1029,11 +1064,48 @@ dfb_input_device_get_state( CoreInputDevice  *device,
 
      shared = device->shared;
 
-     *ret_state = shared->state;
+     /* Read the state published with the last dispatched event, without locking. */
+     do {
+          seq = *(volatile unsigned int*) &shared->snapshot.seq;
+
+          D_SYNC_SYNCHRONIZE();
+
+          *ret_state = shared->snapshot.state;
+
+          D_SYNC_SYNCHRONIZE();
+     } while ((seq & 1) || seq != *(volatile unsigned int*) &shared->snapshot.seq);
 
      return DFB_OK;
 }
 
+void
+dfb_input_device_get_snapshot( CoreInputDevice     *device,
+                               InputDeviceSnapshot *ret_snapshot )
+{
+     CoreInputDeviceShared *shared;
+     unsigned int           seq;
+
+     D_DEBUG_AT( Core_Input, "%s( %p )\n", __FUNCTION__, device );
+
+     D_MAGIC_ASSERT( device, CoreInputDevice );
+     D_ASSERT( device->shared != NULL );
+     D_ASSERT( ret_snapshot != NULL );
+
+     shared = device->shared;
+
+     do {
+          seq = *(volatile unsigned int*) &shared->snapshot.seq;
+
+          D_SYNC_SYNCHRONIZE();
+
+          direct_memcpy( ret_snapshot, &shared->snapshot, sizeof(InputDeviceSnapshot) );
+
+          D_SYNC_SYNCHRONIZE();
+     } while ((seq & 1) || seq != *(volatile unsigned int*) &shared->snapshot.seq);
+
+     ret_snapshot->seq = seq;
+}
+
 DFBResult
 dfb_input_device_set_configuration( CoreInputDevice            *device,
                                     const DFBInputDeviceConfig *config )
@@ -1080,6 +1152,9 @@ input_add_device( CoreInputDevice *device )
      direct_list_append( &core_local->devices, &device->link );
 
      core_input->devices[core_input->num++] = shared;
+
+     if (core_local->record.active)
+          input_record_device( device );
 }
 
 static void
@@ -1824,6 +1899,8 @@ local_processing_hotplug( const void *msg_data,
                fusion_ref_down( &shared->ref, false );
 #endif /* FUSION_BUILD_MULTI */
 
+               free_keymap_lookup( device );
+
                D_MAGIC_CLEAR( device );
                D_FREE( device );
           }
@@ -1836,6 +1913,141 @@ local_processing_hotplug( const void *msg_data,
 
 /**********************************************************************************************************************/
 
+static void
+input_record_write( DFBInputCore     *data,
+                    DFBInputDeviceID  device_id,
+                    DFIEFFRecordType  type,
+                    const void       *payload,
+                    size_t            size )
+{
+     DirectResult  ret;
+     u8            buf[sizeof(DFIEFFRecord) + MAX( sizeof(DFIEFFDevice), sizeof(DFIEFFEvent) )];
+     DFIEFFRecord *record = (DFIEFFRecord*) buf;
+
+     D_ASSERT( size <= sizeof(buf) - sizeof(DFIEFFRecord) );
+
+     record->type      = type;
+     record->device_id = device_id;
+
+     direct_memcpy( record + 1, payload, size );
+
+     direct_mutex_lock( &data->record.lock );
+
+     if (data->record.active) {
+          record->micros = direct_clock_get_micros() - data->record.start;
+
+          ret = direct_file_write( &data->record.file, buf, sizeof(DFIEFFRecord) + size, NULL );
+          if (ret) {
+               D_DERROR( ret, "Core/Input: Failed to write input record file, recording stopped!\n" );
+               data->record.active = false;
+          }
+     }
+
+     direct_mutex_unlock( &data->record.lock );
+}
+
+static void
+input_record_start( DFBInputCore *data )
+{
+     DirectResult ret;
+     DFIEFFHeader header = { .magic = { 'D', 'F', 'I', 'E', 'F' }, .major = 0, .minor = 1 };
+
+     D_DEBUG_AT( Core_Input, "%s( '%s' )\n", __FUNCTION__, dfb_config->input_record );
+
+     ret = direct_file_open( &data->record.file, dfb_config->input_record, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+     if (ret) {
+          D_DERROR( ret, "Core/Input: Could not open input record file '%s'!\n", dfb_config->input_record );
+          return;
+     }
+
+     ret = direct_file_write( &data->record.file, &header, sizeof(header), NULL );
+     if (ret) {
+          D_DERROR( ret, "Core/Input: Could not write input record file '%s'!\n", dfb_config->input_record );
+          direct_file_close( &data->record.file );
+          return;
+     }
+
+     direct_mutex_init( &data->record.lock );
+
+     data->record.start  = direct_clock_get_micros();
+     data->record.active = true;
+
+     D_INFO( "DirectFB/Input: Recording input events to '%s'\n", dfb_config->input_record );
+}
+
+static void
+input_record_stop( DFBInputCore *data )
+{
+     D_DEBUG_AT( Core_Input, "%s()\n", __FUNCTION__ );
+
+     direct_mutex_lock( &data->record.lock );
+
+     data->record.active = false;
+
+     direct_file_close( &data->record.file );
+
+     direct_mutex_unlock( &data->record.lock );
+
+     direct_mutex_deinit( &data->record.lock );
+}
+
+static void
+input_record_device( CoreInputDevice *device )
+{
+     DFIEFFDevice device_record;
+
+     D_MAGIC_ASSERT( device, CoreInputDevice );
+     D_ASSERT( device->shared != NULL );
+
+     device_record.desc = device->shared->device_info.desc;
+
+     input_record_write( core_local, device->shared->id, DFIEFF_RECORD_DEVICE, &device_record, sizeof(device_record) );
+}
+
+static void
+input_record_event( CoreInputDevice     *device,
+                    const DFBInputEvent *event )
+{
+     DFIEFFEvent event_record;
+
+     D_MAGIC_ASSERT( device, CoreInputDevice );
+     D_ASSERT( device->shared != NULL );
+
+     /* Record the event after fixup, so that a replay doesn't depend on the keymap of the device. */
+     event_record.type       = event->type;
+     event_record.flags      = event->flags & ~DIEF_TIMESTAMP;
+     event_record.key_code   = event->key_code;
+     event_record.key_id     = event->key_id;
+     event_record.key_symbol = event->key_symbol;
+     event_record.modifiers  = event->modifiers;
+     event_record.locks      = event->locks;
+     event_record.button     = event->button;
+     event_record.buttons    = event->buttons;
+     event_record.axis       = event->axis;
+     event_record.axisabs    = event->axisabs;
+     event_record.axisrel    = event->axisrel;
+     event_record.min        = event->min;
+     event_record.max        = event->max;
+     event_record.slot_id    = event->slot_id;
+
+     /* Undo the 'lefty' swap, it's applied again when the event is replayed. The buttons mask is derived from the
+        swapped buttons, so leave it to the replay to rebuild it. */
+     if (dfb_config->lefty) {
+          if (event->type == DIET_BUTTONPRESS || event->type == DIET_BUTTONRELEASE) {
+               if (event->button == DIBI_LEFT)
+                    event_record.button = DIBI_RIGHT;
+               else if (event->button == DIBI_RIGHT)
+                    event_record.button = DIBI_LEFT;
+          }
+
+          event_record.flags &= ~DIEF_BUTTONS;
+     }
+
+     input_record_write( core_local, device->shared->id, DFIEFF_RECORD_EVENT, &event_record, sizeof(event_record) );
+}
+
+/**********************************************************************************************************************/
+
 static DFBInputDeviceKeyIdentifier symbol_to_id( DFBInputDeviceKeySymbol     symbol );
 static DFBInputDeviceKeySymbol     id_to_symbol( DFBInputDeviceKeyIdentifier id,
                                                  DFBInputDeviceModifierMask  modifiers,
@@ -1884,6 +2096,8 @@ get_keymap_entry( CoreInputDevice *device,
           /* Write keycode to entry. */
           entry->code = code;
 
+          map->serial++;
+
           /* Fetch entry from driver. */
           ret = funcs->GetKeymapEntry( device, device->driver_data, entry );
           if (ret)
@@ -1933,6 +2147,9 @@ set_keymap_entry( CoreInputDevice                 *device,
      /* Copy the entry to the map. */
      map->entries[code - map->min_keycode] = *entry;
 
+     /* Invalidate the lookup tables. */
+     map->serial++;
+
      return DFB_OK;
 }
 
@@ -2036,6 +2253,7 @@ load_keymap( CoreInputDevice *device,
           if (ret) {
                if (ret == DFB_EOF) {
                     direct_file_close( &fd );
+                    update_keymap_lookup( device );
                     return DFB_OK;
                }
                direct_file_close( &fd );
@@ -2117,15 +2335,98 @@ reload_keymap( CoreInputDevice *device )
      for (i = 0; i < shared->keymap.num_entries; i++)
           map->entries[i].code = -1;
 
+     map->serial++;
+
      /* Fetch the whole map. */
      for (i = shared->keymap.min_keycode; i <= shared->keymap.max_keycode; i++)
           get_keymap_entry( device, i );
 
+     update_keymap_lookup( device );
+
      D_INFO( "DirectFB/Input: Reloaded keymap for '%s' [0x%02x]\n", shared->device_info.desc.name, shared->id );
 
      return DFB_OK;
 }
 
+/*
+ * Rebuild the reverse lookup tables of the keymap if it has been changed since they were built.
+ * Returns false if the tables are not available.
+ */
+static bool
+update_keymap_lookup( CoreInputDevice *device )
+{
+     int                    i;
+     InputDeviceKeymap     *map;
+     CoreInputDeviceShared *shared;
+
+     D_MAGIC_ASSERT( device, CoreInputDevice );
+     D_ASSERT( device->shared != NULL );
+
+     shared = device->shared;
+
+     map = &shared->keymap;
+
+     if (device->keymap_lookup.id_index && device->keymap_lookup.serial == map->serial)
+          return true;
+
+     D_DEBUG_AT( Core_Input, "%s( %p ) <- serial %u\n", __FUNCTION__, device, map->serial );
+
+     if (!device->keymap_lookup.id_index) {
+          device->keymap_lookup.id_index = D_CALLOC( DIKI_NUMBER_OF_KEYS, sizeof(int) );
+          if (!device->keymap_lookup.id_index) {
+               D_OOM();
+               return false;
+          }
+     }
+     else
+          memset( device->keymap_lookup.id_index, 0, DIKI_NUMBER_OF_KEYS * sizeof(int) );
+
+     if (device->keymap_lookup.symbol_index)
+          direct_hash_destroy( device->keymap_lookup.symbol_index );
+
+     if (direct_hash_create( map->num_entries * (DIKSI_LAST + 1), &device->keymap_lookup.symbol_index )) {
+          device->keymap_lookup.symbol_index = NULL;
+          D_FREE( device->keymap_lookup.id_index );
+          device->keymap_lookup.id_index = NULL;
+          return false;
+     }
+
+     /* Keep the first matching entry, like a linear search would find it. */
+     for (i = 0; i < map->num_entries; i++) {
+          int                        n;
+          DFBInputDeviceKeymapEntry *entry = &map->entries[i];
+          unsigned int               index = entry->identifier - DIKI_UNKNOWN;
+
+          if (index < DIKI_NUMBER_OF_KEYS && !device->keymap_lookup.id_index[index])
+               device->keymap_lookup.id_index[index] = i + 1;
+
+          for (n = 0; n <= DIKSI_LAST; n++) {
+               if (!direct_hash_lookup( device->keymap_lookup.symbol_index, entry->symbols[n] ))
+                    direct_hash_insert( device->keymap_lookup.symbol_index, entry->symbols[n], (void*)(long) (i + 1) );
+          }
+     }
+
+     device->keymap_lookup.serial = map->serial;
+
+     return true;
+}
+
+static void
+free_keymap_lookup( CoreInputDevice *device )
+{
+     D_MAGIC_ASSERT( device, CoreInputDevice );
+
+     if (device->keymap_lookup.symbol_index) {
+          direct_hash_destroy( device->keymap_lookup.symbol_index );
+          device->keymap_lookup.symbol_index = NULL;
+     }
+
+     if (device->keymap_lookup.id_index) {
+          D_FREE( device->keymap_lookup.id_index );
+          device->keymap_lookup.id_index = NULL;
+     }
+}
+
 static bool
 lookup_from_table( CoreInputDevice    *device,
                    DFBInputEvent      *event,
@@ -2180,6 +2481,12 @@ find_key_code_by_id( CoreInputDevice             *device,
 
      map = &shared->keymap;
 
+     if ((unsigned int) (id - DIKI_UNKNOWN) < DIKI_NUMBER_OF_KEYS && update_keymap_lookup( device )) {
+          i = device->keymap_lookup.id_index[id - DIKI_UNKNOWN];
+
+          return i ? map->entries[i-1].code : -1;
+     }
+
      for (i = 0; i < map->num_entries; i++) {
           DFBInputDeviceKeymapEntry *entry = &map->entries[i];
 
@@ -2207,6 +2514,12 @@ find_key_code_by_symbol( CoreInputDevice         *device,
 
      map = &shared->keymap;
 
+     if (update_keymap_lookup( device )) {
+          i = (long) direct_hash_lookup( device->keymap_lookup.symbol_index, symbol );
+
+          return i ? map->entries[i-1].code : -1;
+     }
+
      for (i = 0; i < map->num_entries; i++) {
           int                        n;
           DFBInputDeviceKeymapEntry *entry = &map->entries[i];
@@ -2902,3 +3215,57 @@ core_input_filter( CoreInputDevice *device,
 
      return false;
 }
+
+static void
+update_snapshot( CoreInputDevice     *device,
+                 const DFBInputEvent *event )
+{
+     CoreInputDeviceShared *shared;
+     InputDeviceSnapshot   *snapshot;
+     unsigned int           index;
+     unsigned int           seq;
+
+     D_MAGIC_ASSERT( device, CoreInputDevice );
+     D_ASSERT( core_local != NULL );
+
+     shared   = device->shared;
+     snapshot = &shared->snapshot;
+
+     /* Mark the snapshot as being updated, an odd counter also keeps out other writers of the same device. */
+     while (true) {
+          seq = *(volatile unsigned int*) &snapshot->seq;
+
+          if (!(seq & 1) && D_SYNC_BOOL_COMPARE_AND_SWAP( &snapshot->seq, seq, seq + 1 ))
+               break;
+
+          direct_sched_yield();
+     }
+
+     snapshot->state = shared->state;
+
+     switch (event->type) {
+          case DIET_KEYPRESS:
+          case DIET_KEYRELEASE:
+               index = event->key_id - DFB_KEY( IDENTIFIER, 0 );
+               if (index < DIKI_NUMBER_OF_KEYS)
+                    snapshot->keystates[index] = (event->type == DIET_KEYPRESS) ? DIKS_DOWN : DIKS_UP;
+               break;
+
+          case DIET_AXISMOTION:
+               if (event->axis < DIAI_FIRST || event->axis > DIAI_LAST)
+                    break;
+
+               if (event->flags & DIEF_AXISREL)
+                    snapshot->axis[event->axis] += event->axisrel;
+               if (event->flags & DIEF_AXISABS)
+                    snapshot->axis[event->axis] = event->axisabs;
+               break;
+
+          default:
+               break;
+     }
+
+     D_SYNC_SYNCHRONIZE();
+
+     snapshot->seq++;
+}
@@ -124,6 +124,7 @@ typedef struct {
      int                        max_keycode;
      int                        num_entries;
      DFBInputDeviceKeymapEntry *entries;
+     unsigned int               serial;      /* incremented on each change of the entries */
 } InputDeviceKeymap;
 
 typedef struct {
@@ -133,6 +134,21 @@ typedef struct {
      DFBInputDeviceButtonMask   buttons;
 } InputDeviceState;
 
+/*
+ * Device state published in shared memory for lock-free polling.
+ *
+ * The sequence counter is odd while the master updates the snapshot, which also serializes the writers of a device.
+ * Readers retry until they got an even and unchanged counter around their copy.
+ */
+typedef struct {
+     unsigned int                 seq;
+
+     InputDeviceState             state;
+
+     int                          axis[DIAI_LAST+1];              /* position of all axes */
+     DFBInputDeviceKeyState       keystates[DIKI_NUMBER_OF_KEYS]; /* state of all keys */
+} InputDeviceSnapshot;
+
 typedef struct {
      int                          magic;
 
@@ -146,6 +162,8 @@ typedef struct {
 
      InputDeviceState             state;
 
+     InputDeviceSnapshot          snapshot;    /* state of the dispatched events */
+
      DFBInputDeviceKeyIdentifier  last_key;    /* last key pressed */
      DFBInputDeviceKeySymbol      last_symbol; /* last symbol pressed */
      bool                         first_press; /* first press of key */
@@ -185,6 +203,12 @@ struct __DFB_CoreInputDevice {
      void                  *driver_data;
 
      CoreDFB               *core;
+
+     struct {
+          unsigned int      serial;       /* keymap serial the lookup tables have been built for */
+          int              *id_index;     /* index + 1 of the first entry per key identifier */
+          DirectHash       *symbol_index; /* index + 1 of the first entry per key symbol */
+     } keymap_lookup;
 };
 
 /**********************************************************************************************************************/
@@ -247,6 +271,9 @@ DFBResult                   dfb_input_device_reload_keymap      ( CoreInputDevic
 DFBResult                   dfb_input_device_get_state          ( CoreInputDevice                 *device,
                                                                   InputDeviceState                *ret_state );
 
+void                        dfb_input_device_get_snapshot       ( CoreInputDevice                 *device,
+                                                                  InputDeviceSnapshot             *ret_snapshot );
+
 DFBResult                   dfb_input_device_set_configuration  ( CoreInputDevice                 *device,
                                                                   const DFBInputDeviceConfig      *config );
 
@@ -26,15 +26,79 @@ D_DEBUG_DOMAIN( Core_Local, "Core/Local", "DirectFB Core Local Surface Pool" );
 
 /**********************************************************************************************************************/
 
+typedef struct {
+     CoreSurfacePoolRecycler  recycler;
+} LocalPoolData;
+
 typedef struct {
      int   magic;
      void *addr;
      int   pitch;
      int   size;
+     void *packed;  /* compressed buffer while being parked */
 } LocalAllocationData;
 
+/* Base alignment of buffers advised to be backed by transparent huge pages. */
+#define LOCAL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**********************************************************************************************************************/
+
+/*
+ * Base alignment of a buffer, non-zero if it's allocated by posix_memalign() function.
+ */
+static unsigned int
+local_align( int size )
+{
+     if (dfb_config->surface_hugepages && size >= dfb_config->surface_hugepages * 1024LL)
+          return LOCAL_HUGE_PAGE_SIZE;
+
+     if (dfb_config->system_surface_align_base && dfb_config->system_surface_align_pitch)
+          return dfb_config->system_surface_align_base;
+
+     return 0;
+}
+
+static void
+local_free( void         *addr,
+            unsigned int  align,
+            void         *ctx )
+{
+     if (align)
+          /* This was allocated by posix_memalign() function and requires free(). */
+          free( addr );
+     else
+          D_FREE( addr );
+}
+
+static void *
+local_alloc( int          size,
+             unsigned int align )
+{
+     void *addr = NULL;
+
+     /* posix_memalign() function requires base alignment to actually be at least four. */
+     if (align) {
+          if (posix_memalign( &addr, align, size ))
+               addr = NULL;
+#ifdef MADV_HUGEPAGE
+          else if (align == LOCAL_HUGE_PAGE_SIZE && madvise( addr, size, MADV_HUGEPAGE ))
+               D_DEBUG_AT( Core_Local, "  -> no transparent huge pages (%s)\n", strerror( errno ) );
+#endif
+     }
+     else
+          addr = D_MALLOC( size );
+
+     return addr;
+}
+
 /**********************************************************************************************************************/
 
+static int
+localPoolDataSize( void )
+{
+     return sizeof(LocalPoolData);
+}
+
 static int
 localAllocationDataSize( void )
 {
@@ -86,10 +150,17 @@ localDestroyPool( CoreSurfacePool *pool,
                   void            *pool_data,
                   void            *pool_local )
 {
+     LocalPoolData *data = pool_data;
+
      D_DEBUG_AT( Core_Local, "%s()\n", __FUNCTION__ );
 
      D_MAGIC_ASSERT( pool, CoreSurfacePool );
 
+     D_DEBUG_AT( Core_Local, "  -> recycled %u of %u allocations\n",
+                 data->recycler.hits, data->recycler.hits + data->recycler.misses );
+
+     dfb_surface_pool_recycle_trim( &data->recycler, true, local_free, NULL );
+
      return DFB_OK;
 }
 
@@ -114,7 +185,9 @@ localAllocateBuffer( CoreSurfacePool       *pool,
                      void                  *alloc_data )
 {
      CoreSurface         *surface;
+     LocalPoolData       *data  = pool_data;
      LocalAllocationData *alloc = alloc_data;
+     unsigned int         align;
 
      D_DEBUG_AT( Core_Local, "%s()\n", __FUNCTION__ );
 
@@ -135,22 +208,34 @@ localAllocateBuffer( CoreSurfacePool       *pool,
 
           dfb_surface_calc_buffer_size( surface, dfb_config->system_surface_align_pitch, 0,
                                         &alloc->pitch, &alloc->size );
-
-          /* posix_memalign() function requires base alignment to actually be at least four. */
-          int err = posix_memalign( &alloc->addr, dfb_config->system_surface_align_base, alloc->size );
-          if (err) {
-              D_ERROR( "Core/Local: Error from posix_memalign with base alignment %u\n",
-                       dfb_config->system_surface_align_base );
-              return DFB_FAILURE;
-          }
      }
      /* Create un-aligned local system surface buffer. */
-     else {
+     else
           dfb_surface_calc_buffer_size( surface, 8, 0, &alloc->pitch, &alloc->size );
 
-          alloc->addr = D_MALLOC( alloc->size );
-          if (!alloc->addr)
+     align = local_align( alloc->size );
+
+     /* Reuse a buffer released recently. */
+     alloc->addr = dfb_surface_pool_recycle_get( &data->recycler, alloc->size, align, local_free, NULL );
+
+     if (!alloc->addr) {
+          alloc->addr = local_alloc( alloc->size, align );
+
+          /* Give back the kept buffers and try again. */
+          if (!alloc->addr && data->recycler.num) {
+               dfb_surface_pool_recycle_trim( &data->recycler, true, local_free, NULL );
+
+               alloc->addr = local_alloc( alloc->size, align );
+          }
+
+          if (!alloc->addr) {
+               if (align) {
+                    D_ERROR( "Core/Local: Error from posix_memalign with base alignment %u\n", align );
+                    return DFB_FAILURE;
+               }
+
                return D_OOM();
+          }
      }
 
      D_MAGIC_SET( alloc, LocalAllocationData );
@@ -169,18 +254,28 @@ localDeallocateBuffer( CoreSurfacePool       *pool,
                        CoreSurfaceAllocation *allocation,
                        void                  *alloc_data )
 {
+     LocalPoolData       *data  = pool_data;
      LocalAllocationData *alloc = alloc_data;
+     unsigned int         align;
 
      D_DEBUG_AT( Core_Local, "%s()\n", __FUNCTION__ );
 
      D_MAGIC_ASSERT( pool, CoreSurfacePool );
      D_MAGIC_ASSERT( alloc, LocalAllocationData );
 
-     if (dfb_config->system_surface_align_base && dfb_config->system_surface_align_pitch)
-          /* This was allocated by posix_memalign() function and requires free(). */
-          free( alloc->addr );
-     else
-          D_FREE( alloc->addr );
+     align = local_align( alloc->size );
+
+     if (alloc->packed) {
+          D_FREE( alloc->packed );
+
+          D_MAGIC_CLEAR( alloc );
+
+          return DFB_OK;
+     }
+
+     /* Keep the buffer for an allocation of the same size. */
+     if (!dfb_surface_pool_recycle_put( &data->recycler, alloc->addr, alloc->size, align, local_free, NULL ))
+          local_free( alloc->addr, align, NULL );
 
      D_MAGIC_CLEAR( alloc );
 
@@ -232,7 +327,84 @@ localUnlock( CoreSurfacePool       *pool,
      return DFB_OK;
 }
 
+static DFBResult
+localPark( CoreSurfacePool       *pool,
+           void                  *pool_data,
+           void                  *pool_local,
+           CoreSurfaceAllocation *allocation,
+           void                  *alloc_data,
+           int                   *ret_size )
+{
+     LocalAllocationData *alloc = alloc_data;
+     unsigned int         align;
+     void                *packed;
+     int                  size;
+
+     D_DEBUG_AT( Core_Local, "%s() <- size %d\n", __FUNCTION__, alloc->size );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+     D_MAGIC_ASSERT( alloc, LocalAllocationData );
+     D_ASSERT( alloc->packed == NULL );
+
+     align = local_align( alloc->size );
+
+     /* Parking has to save at least a quarter of the buffer. */
+     packed = D_MALLOC( alloc->size / 4 * 3 );
+     if (!packed)
+          return D_OOM();
+
+     size = dfb_surface_pool_pack( alloc->addr, alloc->size, packed, alloc->size / 4 * 3 );
+     if (!size) {
+          D_FREE( packed );
+          return DFB_BUFFERTOOLARGE;
+     }
+
+     alloc->packed = D_REALLOC( packed, size ) ?: packed;
+
+     local_free( alloc->addr, align, NULL );
+
+     alloc->addr = NULL;
+
+     *ret_size = size;
+
+     return DFB_OK;
+}
+
+static DFBResult
+localUnpark( CoreSurfacePool       *pool,
+             void                  *pool_data,
+             void                  *pool_local,
+             CoreSurfaceAllocation *allocation,
+             void                  *alloc_data )
+{
+     LocalAllocationData *alloc = alloc_data;
+     unsigned int         align;
+
+     D_DEBUG_AT( Core_Local, "%s() <- size %d\n", __FUNCTION__, alloc->size );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+     D_MAGIC_ASSERT( alloc, LocalAllocationData );
+     D_ASSERT( alloc->packed != NULL );
+
+     align = local_align( alloc->size );
+
+     alloc->addr = local_alloc( alloc->size, align );
+     if (!alloc->addr)
+          return D_OOM();
+
+     dfb_surface_pool_unpack( alloc->packed, allocation->packed_size, alloc->addr, alloc->size );
+
+     D_FREE( alloc->packed );
+
+     alloc->packed = NULL;
+
+     return DFB_OK;
+}
+
 const SurfacePoolFuncs localSurfacePoolFuncs = {
+     .PoolDataSize       = localPoolDataSize,
      .AllocationDataSize = localAllocationDataSize,
      .InitPool           = localInitPool,
      .JoinPool           = localJoinPool,
@@ -241,5 +413,7 @@ const SurfacePoolFuncs localSurfacePoolFuncs = {
      .AllocateBuffer     = localAllocateBuffer,
      .DeallocateBuffer   = localDeallocateBuffer,
      .Lock               = localLock,
-     .Unlock             = localUnlock
+     .Unlock             = localUnlock,
+     .Park               = localPark,
+     .Unpark             = localUnpark
 };
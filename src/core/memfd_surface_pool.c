@@ -0,0 +1,468 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#define _GNU_SOURCE /* To get memfd_create() declaration and file sealing definitions. */
+
+#include <core/core.h>
+#include <core/surface_allocation.h>
+#include <core/surface_buffer.h>
+#include <core/surface_pool.h>
+#include <core/system.h>
+#include <direct/filesystem.h>
+#include <direct/system.h>
+#include <direct/util.h>
+#include <fcntl.h>
+#include <fusion/call.h>
+#include <sys/mman.h>
+
+D_DEBUG_DOMAIN( Core_Memfd, "Core/Memfd", "DirectFB Core Memfd Surface Pool" );
+
+/**********************************************************************************************************************/
+
+/*
+ * Each buffer is a sealed memfd of the master, other processes open it via procfs when locking the buffer.
+ * Buffers are always created and destroyed by the master, slaves allocating directly do so via a call.
+ *
+ * The file descriptor is provided as the lock handle, e.g. to be passed to consumers outside of DirectFB.
+ */
+
+/* Size buffers backed by huge pages are rounded up to. */
+#define MEMFD_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+typedef enum {
+     MEMFD_CALL_ALLOCATE   = 1,
+     MEMFD_CALL_DEALLOCATE = 2
+} MemfdCall;
+
+typedef struct {
+     pid_t        master_pid;
+     bool         hugetlb;
+
+     FusionCall   call;
+} MemfdPoolData;
+
+typedef struct {
+     CoreDFB     *core;
+     FusionWorld *world;
+} MemfdPoolLocalData;
+
+typedef struct {
+     int          magic;
+
+     char         name[48];
+
+     int          fd;          /* file descriptor in the master */
+     int          pitch;
+     int          size;
+     int          map_size;    /* size of the file */
+     void        *master_map;  /* mapping in the master */
+} MemfdAllocationData;
+
+/**********************************************************************************************************************/
+
+static int
+memfd_create_buffer( const char *name,
+                     int         size,
+                     bool        hugetlb )
+{
+     DirectResult ret;
+     DirectFile   fd = { .fd = -1 };
+
+     fd.fd = memfd_create( name, MFD_CLOEXEC | MFD_ALLOW_SEALING | (hugetlb ? MFD_HUGETLB : 0) );
+     if (fd.fd < 0)
+          return -1;
+
+     ret = direct_file_truncate( &fd, size );
+     if (ret) {
+          direct_file_close( &fd );
+          return -1;
+     }
+
+     /* The size is fixed from now on, so that mappings in other processes can't be truncated under their feet. */
+     if (fcntl( fd.fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL ) < 0)
+          D_DEBUG_AT( Core_Memfd, "  -> could not seal '%s'!\n", name );
+
+     return fd.fd;
+}
+
+static DFBResult
+memfd_allocate( MemfdPoolData       *data,
+                MemfdAllocationData *alloc )
+{
+     DirectResult ret;
+     DirectFile   fd = { .fd = -1 };
+
+     D_DEBUG_AT( Core_Memfd, "%s( '%s' )\n", __FUNCTION__, alloc->name );
+
+     alloc->fd = -1;
+
+     /* Try huge pages first, falling back to normal pages if none are available. Without reserved huge pages, the
+        memfd is still created, but mapping it fails. */
+     if (data->hugetlb) {
+          alloc->map_size = direct_util_align( alloc->size, MEMFD_HUGE_PAGE_SIZE );
+          alloc->fd       = memfd_create_buffer( alloc->name, alloc->map_size, true );
+
+          if (alloc->fd >= 0) {
+               fd.fd = alloc->fd;
+
+               if (direct_file_map( &fd, NULL, 0, alloc->map_size, DFP_READ | DFP_WRITE, &alloc->master_map )) {
+                    direct_file_close( &fd );
+                    alloc->fd = -1;
+               }
+          }
+
+          D_DEBUG_AT( Core_Memfd, "  -> %s huge pages\n", alloc->fd < 0 ? "no" : "using" );
+     }
+
+     if (alloc->fd < 0) {
+          alloc->map_size = alloc->size;
+          alloc->fd       = memfd_create_buffer( alloc->name, alloc->map_size, false );
+
+          if (alloc->fd < 0) {
+               ret = errno2result( errno );
+               D_DERROR( ret, "Core/Memfd: Could not create memfd '%s' with %d bytes!\n",
+                         alloc->name, alloc->map_size );
+               return ret;
+          }
+
+          fd.fd = alloc->fd;
+
+          ret = direct_file_map( &fd, NULL, 0, alloc->map_size, DFP_READ | DFP_WRITE, &alloc->master_map );
+          if (ret) {
+               D_DERROR( ret, "Core/Memfd: Could not mmap '%s'!\n", alloc->name );
+               direct_file_close( &fd );
+               return ret;
+          }
+     }
+
+     D_DEBUG_AT( Core_Memfd, "  -> fd %d, size %d\n", alloc->fd, alloc->map_size );
+
+     return DFB_OK;
+}
+
+static void
+memfd_deallocate( MemfdAllocationData *alloc )
+{
+     DirectFile fd = { .fd = -1 };
+
+     D_DEBUG_AT( Core_Memfd, "%s( fd %d )\n", __FUNCTION__, alloc->fd );
+
+     direct_file_unmap( alloc->master_map, alloc->map_size );
+
+     /* Processes having the buffer locked keep their own descriptor and mapping. */
+     fd.fd = alloc->fd;
+
+     direct_file_close( &fd );
+}
+
+static FusionCallHandlerResult
+memfd_call_handler( int           caller,
+                    int           call_arg,
+                    void         *call_ptr,
+                    void         *ctx,
+                    unsigned int  serial,
+                    int          *ret_val )
+{
+     MemfdPoolData       *data  = ctx;
+     MemfdAllocationData *alloc = call_ptr;
+
+     switch (call_arg) {
+          case MEMFD_CALL_ALLOCATE:
+               *ret_val = memfd_allocate( data, alloc );
+               break;
+
+          case MEMFD_CALL_DEALLOCATE:
+               memfd_deallocate( alloc );
+               *ret_val = DFB_OK;
+               break;
+
+          default:
+               D_BUG( "unknown call %d", call_arg );
+               *ret_val = DFB_BUG;
+               break;
+     }
+
+     return FCHR_RETURN;
+}
+
+static DFBResult
+memfd_call( MemfdPoolData       *data,
+            MemfdPoolLocalData  *local,
+            MemfdCall            call,
+            MemfdAllocationData *alloc )
+{
+     DirectResult ret;
+     int          val;
+
+     if (dfb_core_is_master( local->core )) {
+          memfd_call_handler( 0, call, alloc, data, 0, &val );
+          return val;
+     }
+
+     ret = fusion_call_execute( &data->call, FCEF_NONE, call, alloc, &val );
+     if (ret)
+          return ret;
+
+     return val;
+}
+
+/**********************************************************************************************************************/
+
+static int
+memfdPoolDataSize( void )
+{
+     return sizeof(MemfdPoolData);
+}
+
+static int
+memfdPoolLocalDataSize( void )
+{
+     return sizeof(MemfdPoolLocalData);
+}
+
+static int
+memfdAllocationDataSize( void )
+{
+     return sizeof(MemfdAllocationData);
+}
+
+static DFBResult
+memfdInitPool( CoreDFB                    *core,
+               CoreSurfacePool            *pool,
+               void                       *pool_data,
+               void                       *pool_local,
+               void                       *system_data,
+               CoreSurfacePoolDescription *ret_desc )
+{
+     MemfdPoolData      *data  = pool_data;
+     MemfdPoolLocalData *local = pool_local;
+
+     D_DEBUG_AT( Core_Memfd, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_ASSERT( ret_desc != NULL );
+
+     ret_desc->caps              = CSPCAPS_VIRTUAL;
+     ret_desc->access[CSAID_CPU] = CSAF_READ | CSAF_WRITE | CSAF_SHARED;
+     ret_desc->types             = CSTF_LAYER | CSTF_WINDOW | CSTF_CURSOR | CSTF_FONT | CSTF_SHARED | CSTF_INTERNAL;
+     ret_desc->priority          = (dfb_system_caps() & CSCAPS_PREFER_SHM) ? CSPP_PREFERED : CSPP_DEFAULT;
+
+     if (dfb_system_caps() & CSCAPS_SYSMEM_EXTERNAL)
+          ret_desc->types |= CSTF_EXTERNAL;
+
+     snprintf( ret_desc->name, DFB_SURFACE_POOL_DESC_NAME_LENGTH, "Shared Memfd Memory" );
+
+     local->core  = core;
+     local->world = dfb_core_world( core );
+
+     data->master_pid = direct_getpid();
+     data->hugetlb    = dfb_config->surface_memfd_hugetlb;
+
+     fusion_call_init( &data->call, memfd_call_handler, data, local->world );
+
+     return DFB_OK;
+}
+
+static DFBResult
+memfdDestroyPool( CoreSurfacePool *pool,
+                  void            *pool_data,
+                  void            *pool_local )
+{
+     MemfdPoolData *data = pool_data;
+
+     D_DEBUG_AT( Core_Memfd, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+
+     fusion_call_destroy( &data->call );
+
+     return DFB_OK;
+}
+
+static DFBResult
+memfdJoinPool( CoreDFB         *core,
+               CoreSurfacePool *pool,
+               void            *pool_data,
+               void            *pool_local,
+               void            *system_data )
+{
+     MemfdPoolLocalData *local = pool_local;
+
+     D_DEBUG_AT( Core_Memfd, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+
+     local->core  = core;
+     local->world = dfb_core_world( core );
+
+     return DFB_OK;
+}
+
+static DFBResult
+memfdAllocateBuffer( CoreSurfacePool       *pool,
+                     void                  *pool_data,
+                     void                  *pool_local,
+                     CoreSurfaceBuffer     *buffer,
+                     CoreSurfaceAllocation *allocation,
+                     void                  *alloc_data )
+{
+     DFBResult            ret;
+     CoreSurface         *surface;
+     MemfdAllocationData *alloc = alloc_data;
+
+     D_DEBUG_AT( Core_Memfd, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+     D_MAGIC_ASSERT( buffer->surface, CoreSurface );
+
+     surface = buffer->surface;
+
+     dfb_surface_calc_buffer_size( surface, 8, 0, &alloc->pitch, &alloc->size );
+
+     snprintf( alloc->name, sizeof(alloc->name), "dfb-surface-0x%08x-%u", surface->object.id, buffer->index );
+
+     ret = memfd_call( pool_data, pool_local, MEMFD_CALL_ALLOCATE, alloc );
+     if (ret)
+          return ret;
+
+     D_MAGIC_SET( alloc, MemfdAllocationData );
+
+     allocation->flags = CSALF_VOLATILE;
+     allocation->size  = alloc->size;
+
+     return DFB_OK;
+}
+
+static DFBResult
+memfdDeallocateBuffer( CoreSurfacePool       *pool,
+                       void                  *pool_data,
+                       void                  *pool_local,
+                       CoreSurfaceBuffer     *buffer,
+                       CoreSurfaceAllocation *allocation,
+                       void                  *alloc_data )
+{
+     MemfdAllocationData *alloc = alloc_data;
+
+     D_DEBUG_AT( Core_Memfd, "%s( fd %d )\n", __FUNCTION__, alloc->fd );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( alloc, MemfdAllocationData );
+
+     memfd_call( pool_data, pool_local, MEMFD_CALL_DEALLOCATE, alloc );
+
+     D_MAGIC_CLEAR( alloc );
+
+     return DFB_OK;
+}
+
+static DFBResult
+memfdLock( CoreSurfacePool       *pool,
+           void                  *pool_data,
+           void                  *pool_local,
+           CoreSurfaceAllocation *allocation,
+           void                  *alloc_data,
+           CoreSurfaceBufferLock *lock )
+{
+     DirectResult         ret;
+     MemfdPoolData       *data  = pool_data;
+     MemfdPoolLocalData  *local = pool_local;
+     MemfdAllocationData *alloc = alloc_data;
+     char                 buf[64];
+     DirectFile           fd;
+
+     D_DEBUG_AT( Core_Memfd, "%s() <- size %d\n", __FUNCTION__, alloc->size );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+     D_MAGIC_ASSERT( lock, CoreSurfaceBufferLock );
+     D_MAGIC_ASSERT( alloc, MemfdAllocationData );
+
+     if (dfb_core_is_master( local->core )) {
+          lock->addr   = alloc->master_map;
+          lock->handle = (void*)(long) alloc->fd;
+     }
+     else {
+          /* Get a descriptor of the master's memfd, only the buffers being locked are mapped. */
+          snprintf( buf, sizeof(buf), "/proc/%d/fd/%d", data->master_pid, alloc->fd );
+
+          ret = direct_file_open( &fd, buf, O_RDWR | O_CLOEXEC, 0 );
+          if (ret) {
+               D_DERROR( ret, "Core/Memfd: Could not open '%s'!\n", buf );
+               return ret;
+          }
+
+          ret = direct_file_map( &fd, NULL, 0, alloc->map_size, DFP_READ | DFP_WRITE, &lock->addr );
+          if (ret) {
+               D_DERROR( ret, "Core/Memfd: Could not mmap '%s'!\n", buf );
+               direct_file_close( &fd );
+               return ret;
+          }
+
+          lock->handle = (void*)(long) fd.fd;
+
+          D_DEBUG_AT( Core_Memfd, "  -> mapped to %p (fd %d)\n", lock->addr, fd.fd );
+     }
+
+     lock->pitch = alloc->pitch;
+
+     return DFB_OK;
+}
+
+static DFBResult
+memfdUnlock( CoreSurfacePool       *pool,
+             void                  *pool_data,
+             void                  *pool_local,
+             CoreSurfaceAllocation *allocation,
+             void                  *alloc_data,
+             CoreSurfaceBufferLock *lock )
+{
+     MemfdPoolLocalData  *local = pool_local;
+     MemfdAllocationData *alloc = alloc_data;
+     DirectFile           fd    = { .fd = -1 };
+
+     D_DEBUG_AT( Core_Memfd, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+     D_MAGIC_ASSERT( lock, CoreSurfaceBufferLock );
+     D_MAGIC_ASSERT( alloc, MemfdAllocationData );
+
+     if (!dfb_core_is_master( local->core )) {
+          direct_file_unmap( lock->addr, alloc->map_size );
+
+          fd.fd = (long) lock->handle;
+
+          direct_file_close( &fd );
+     }
+
+     return DFB_OK;
+}
+
+const SurfacePoolFuncs memfdSurfacePoolFuncs = {
+     .PoolDataSize       = memfdPoolDataSize,
+     .PoolLocalDataSize  = memfdPoolLocalDataSize,
+     .AllocationDataSize = memfdAllocationDataSize,
+     .InitPool           = memfdInitPool,
+     .JoinPool           = memfdJoinPool,
+     .DestroyPool        = memfdDestroyPool,
+     .AllocateBuffer     = memfdAllocateBuffer,
+     .DeallocateBuffer   = memfdDeallocateBuffer,
+     .Lock               = memfdLock,
+     .Unlock             = memfdUnlock
+};
@@ -21,6 +21,7 @@
 #include <core/surface_buffer.h>
 #include <core/surface_pool.h>
 #include <core/system.h>
+#include <direct/memcpy.h>
 #include <fusion/conf.h>
 #include <fusion/shmalloc.h>
 #include <fusion/shm/pool.h>
@@ -30,7 +31,9 @@ D_DEBUG_DOMAIN( Core_Shared, "Core/Shared", "DirectFB Core Shared Surface Pool"
 /**********************************************************************************************************************/
 
 typedef struct {
-     FusionSHMPoolShared *shmpool;
+     FusionSHMPoolShared     *shmpool;
+
+     CoreSurfacePoolRecycler  recycler;
 } SharedPoolData;
 
 typedef struct {
@@ -43,10 +46,48 @@ typedef struct {
      void *aligned_addr;
      int   pitch;
      int   size;
+     void *packed;        /* compressed buffer while being parked */
 } SharedAllocationData;
 
 /**********************************************************************************************************************/
 
+static void
+shared_free( void         *addr,
+             unsigned int  align,
+             void         *ctx )
+{
+     SharedPoolData *data = ctx;
+
+     SHFREE( data->shmpool, addr );
+}
+
+static void *
+shared_alloc( SharedPoolData *data,
+              int             size,
+              unsigned int    align )
+{
+     void *addr;
+
+     /* Reuse a buffer released recently. */
+     addr = dfb_surface_pool_recycle_get( &data->recycler, size, align, shared_free, data );
+     if (addr)
+          return addr;
+
+     /* Extra space for the alignment of the base address. */
+     addr = SHMALLOC( data->shmpool, size + align );
+
+     /* Give back the kept buffers and try again. */
+     if (!addr && data->recycler.num) {
+          dfb_surface_pool_recycle_trim( &data->recycler, true, shared_free, data );
+
+          addr = SHMALLOC( data->shmpool, size + align );
+     }
+
+     return addr;
+}
+
+/**********************************************************************************************************************/
+
 static int
 sharedPoolDataSize( void )
 {
@@ -115,6 +156,11 @@ sharedDestroyPool( CoreSurfacePool *pool,
 
      D_MAGIC_ASSERT( pool, CoreSurfacePool );
 
+     D_DEBUG_AT( Core_Shared, "  -> recycled %u of %u allocations\n",
+                 data->recycler.hits, data->recycler.hits + data->recycler.misses );
+
+     dfb_surface_pool_recycle_trim( &data->recycler, true, shared_free, data );
+
      fusion_shm_pool_destroy( local->world, data->shmpool );
 
      return DFB_OK;
@@ -151,7 +197,7 @@ sharedAllocateBuffer( CoreSurfacePool       *pool,
           dfb_surface_calc_buffer_size( surface, dfb_config->system_surface_align_pitch, 0,
                                         &alloc->pitch, &alloc->size );
 
-          alloc->addr = SHMALLOC( data->shmpool, alloc->size + dfb_config->system_surface_align_base );
+          alloc->addr = shared_alloc( data, alloc->size, dfb_config->system_surface_align_base );
           if (!alloc->addr)
                return D_OOSHM();
 
@@ -166,7 +212,7 @@ sharedAllocateBuffer( CoreSurfacePool       *pool,
      else {
           dfb_surface_calc_buffer_size( surface, 8, 0, &alloc->pitch, &alloc->size );
 
-          alloc->addr = SHMALLOC( data->shmpool, alloc->size );
+          alloc->addr = shared_alloc( data, alloc->size, 0 );
           if (!alloc->addr)
                return D_OOSHM();
 
@@ -194,7 +240,16 @@ sharedDeallocateBuffer( CoreSurfacePool       *pool,
 
      D_MAGIC_ASSERT( pool, CoreSurfacePool );
 
-     SHFREE( data->shmpool, alloc->addr );
+     if (alloc->packed) {
+          SHFREE( data->shmpool, alloc->packed );
+          return DFB_OK;
+     }
+
+     /* Keep the buffer for an allocation of the same size. */
+     if (!dfb_surface_pool_recycle_put( &data->recycler, alloc->addr, alloc->size,
+                                        alloc->aligned_addr ? dfb_config->system_surface_align_base : 0,
+                                        shared_free, data ))
+          SHFREE( data->shmpool, alloc->addr );
 
      return DFB_OK;
 }
@@ -243,6 +298,93 @@ sharedUnlock( CoreSurfacePool       *pool,
      return DFB_OK;
 }
 
+static DFBResult
+sharedPark( CoreSurfacePool       *pool,
+            void                  *pool_data,
+            void                  *pool_local,
+            CoreSurfaceAllocation *allocation,
+            void                  *alloc_data,
+            int                   *ret_size )
+{
+     SharedPoolData       *data  = pool_data;
+     SharedAllocationData *alloc = alloc_data;
+     void                 *tmp;
+     int                   size;
+
+     D_DEBUG_AT( Core_Shared, "%s() <- size %d\n", __FUNCTION__, alloc->size );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+     D_ASSERT( alloc->packed == NULL );
+
+     /* Parking has to save at least a quarter of the buffer. */
+     tmp = D_MALLOC( alloc->size / 4 * 3 );
+     if (!tmp)
+          return D_OOM();
+
+     size = dfb_surface_pool_pack( alloc->aligned_addr ?: alloc->addr, alloc->size, tmp, alloc->size / 4 * 3 );
+     if (!size) {
+          D_FREE( tmp );
+          return DFB_BUFFERTOOLARGE;
+     }
+
+     alloc->packed = SHMALLOC( data->shmpool, size );
+     if (!alloc->packed) {
+          D_FREE( tmp );
+          return D_OOSHM();
+     }
+
+     direct_memcpy( alloc->packed, tmp, size );
+
+     D_FREE( tmp );
+
+     SHFREE( data->shmpool, alloc->addr );
+
+     alloc->addr         = NULL;
+     alloc->aligned_addr = NULL;
+
+     *ret_size = size;
+
+     return DFB_OK;
+}
+
+static DFBResult
+sharedUnpark( CoreSurfacePool       *pool,
+              void                  *pool_data,
+              void                  *pool_local,
+              CoreSurfaceAllocation *allocation,
+              void                  *alloc_data )
+{
+     SharedPoolData       *data  = pool_data;
+     SharedAllocationData *alloc = alloc_data;
+     unsigned int          align = 0;
+
+     D_DEBUG_AT( Core_Shared, "%s() <- size %d\n", __FUNCTION__, alloc->size );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+     D_ASSERT( alloc->packed != NULL );
+
+     if (dfb_config->system_surface_align_base && dfb_config->system_surface_align_pitch)
+          align = dfb_config->system_surface_align_base;
+
+     alloc->addr = shared_alloc( data, alloc->size, align );
+     if (!alloc->addr)
+          return D_OOSHM();
+
+     /* Calculate the aligned address. */
+     if (align)
+          alloc->aligned_addr = (void*) ((unsigned long) alloc->addr + align - (unsigned long) alloc->addr % align);
+
+     dfb_surface_pool_unpack( alloc->packed, allocation->packed_size, alloc->aligned_addr ?: alloc->addr, alloc->size );
+
+     SHFREE( data->shmpool, alloc->packed );
+
+     alloc->packed = NULL;
+
+     return DFB_OK;
+}
+
 const SurfacePoolFuncs sharedSurfacePoolFuncs = {
      .PoolDataSize       = sharedPoolDataSize,
      .PoolLocalDataSize  = sharedPoolLocalDataSize,
@@ -252,5 +394,7 @@ const SurfacePoolFuncs sharedSurfacePoolFuncs = {
      .AllocateBuffer     = sharedAllocateBuffer,
      .DeallocateBuffer   = sharedDeallocateBuffer,
      .Lock               = sharedLock,
-     .Unlock             = sharedUnlock
+     .Unlock             = sharedUnlock,
+     .Park               = sharedPark,
+     .Unpark             = sharedUnpark
 };
@@ -128,6 +128,16 @@ release_frame( CoreSurface *surface,
      }
 }
 
+/*
+ * With 'surface-clear', buffers are cleared when locked for the first time, so that no allocation is made for surfaces
+ * reconfigured before being used. Buffers of YUV formats are still cleared by the graphics card after creation.
+ */
+static __inline__ CoreSurfaceBufferFlags
+buffer_clear_flags( const CoreSurface *surface )
+{
+     return (dfb_config->surface_clear && !DFB_COLOR_IS_YUV( surface->config.format )) ? CSBF_CLEAR : CSBF_NONE;
+}
+
 /**********************************************************************************************************************/
 
 static const ReactionFunc dfb_surface_globals[] = {
@@ -395,8 +405,10 @@ dfb_surface_create( CoreDFB                  *core,
      for (eye = DSSE_LEFT; num_eyes > 0; num_eyes--, eye = DSSE_RIGHT) {
           dfb_surface_set_stereo_eye( surface, eye );
           for (i = 0; i < buffers; i++) {
-               ret = dfb_surface_buffer_create( core, surface, (eye == DSSE_RIGHT) ? CSBF_RIGHT : CSBF_NONE, i,
-                                                &surface->buffers[i] );
+               ret = dfb_surface_buffer_create( core, surface,
+                                                ((eye == DSSE_RIGHT) ? CSBF_RIGHT : CSBF_NONE) |
+                                                buffer_clear_flags( surface ),
+                                                i, &surface->buffers[i] );
                if (ret) {
                     D_DERROR( ret, "Core/Surface: Error creating surface buffer!\n" );
                     dfb_surface_unlock( surface );
@@ -427,7 +439,7 @@ dfb_surface_create( CoreDFB                  *core,
      /* Activate the object. */
      fusion_object_activate( &surface->object );
 
-     if (dfb_config->surface_clear)
+     if (dfb_config->surface_clear && DFB_COLOR_IS_YUV( surface->config.format ))
           dfb_surface_clear_buffers( surface );
 
      /* Return the new surface. */
@@ -951,8 +963,10 @@ dfb_surface_reconfig( CoreSurface             *surface,
           for (i = 0; i < buffers; i++) {
                CoreSurfaceBuffer *buffer;
 
-               ret = dfb_surface_buffer_create( core_dfb, surface, (eye == DSSE_RIGHT) ? CSBF_RIGHT : CSBF_NONE, i,
-                                                &buffer );
+               ret = dfb_surface_buffer_create( core_dfb, surface,
+                                                ((eye == DSSE_RIGHT) ? CSBF_RIGHT : CSBF_NONE) |
+                                                buffer_clear_flags( surface ),
+                                                i, &buffer );
                if (ret) {
                     D_DERROR( ret, "Core/Surface: Error creating surface buffer!\n" );
                     goto error;
@@ -981,7 +995,7 @@ dfb_surface_reconfig( CoreSurface             *surface,
 
      dfb_surface_notify( surface, CSNF_SIZEFORMAT );
 
-     if (dfb_config->surface_clear)
+     if (dfb_config->surface_clear && DFB_COLOR_IS_YUV( surface->config.format ))
           dfb_surface_clear_buffers( surface );
 
      fusion_skirmish_dismiss( &surface->lock );
@@ -16,15 +16,24 @@
    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 */
 
+#include <config.h>
 #include <core/CoreSurfaceAllocation.h>
 #include <core/core.h>
 #include <core/gfxcard.h>
+#include <core/state.h>
+#include <core/surface.h>
 #include <core/surface_allocation.h>
 #include <core/surface_buffer.h>
 #include <core/surface_pool_bridge.h>
 #include <direct/memcpy.h>
+#include <direct/thread.h>
 #include <directfb_util.h>
 #include <fusion/shmalloc.h>
+#include <misc/conf.h>
+
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
 
 D_DEBUG_DOMAIN( Core_SurfAllocation, "Core/SurfAllocation", "DirectFB Core Surface Allocation" );
 
@@ -112,6 +121,7 @@ dfb_surface_allocation_create( CoreDFB                *core,
      allocation->resource_id = buffer->resource_id;
      allocation->index       = buffer->index;
      allocation->buffer_id   = buffer->object.id;
+     allocation->last_access = direct_clock_get_millis();
 
      if (pool->alloc_data_size) {
           allocation->data = SHCALLOC( pool->shmpool, 1, pool->alloc_data_size );
@@ -200,14 +210,176 @@ dfb_surface_allocation_decouple( CoreSurfaceAllocation *allocation )
      return DFB_OK;
 }
 
+/*
+ * Lines of one plane to be copied, large planes are split into several regions copied by different threads.
+ */
+typedef struct {
+     const char *src;
+     char       *dst;
+     int         srcpitch;
+     int         dstpitch;
+     int         bytes;        /* bytes per line */
+     int         lines;
+     bool        nontemporal;  /* bypass the cache when writing the destination */
+} TransferRegion;
+
+/* Maximum number of threads copying a plane. */
+#define MAX_TRANSFER_THREADS      8
+
+/* Minimum amount of data copied by each thread. */
+#define TRANSFER_THREAD_SIZE      (1024 * 1024)
+
+/* Use non-temporal stores for transfers of at least this size, or if the destination is video memory. */
+#define TRANSFER_NONTEMPORAL_SIZE (256 * 1024)
+
+#ifdef USE_SSE2
+static void
+copy_nontemporal( char       *dst,
+                  const char *src,
+                  size_t      len )
+{
+     size_t head = (16 - ((unsigned long) dst & 15)) & 15;
+
+     if (len < head + 64) {
+          direct_memcpy( dst, src, len );
+          return;
+     }
+
+     if (head) {
+          direct_memcpy( dst, src, head );
+          dst += head;
+          src += head;
+          len -= head;
+     }
+
+     for (; len >= 64; len -= 64, dst += 64, src += 64) {
+          __m128i a = _mm_loadu_si128( (const __m128i*) src );
+          __m128i b = _mm_loadu_si128( (const __m128i*) src + 1 );
+          __m128i c = _mm_loadu_si128( (const __m128i*) src + 2 );
+          __m128i d = _mm_loadu_si128( (const __m128i*) src + 3 );
+
+          _mm_stream_si128( (__m128i*) dst,     a );
+          _mm_stream_si128( (__m128i*) dst + 1, b );
+          _mm_stream_si128( (__m128i*) dst + 2, c );
+          _mm_stream_si128( (__m128i*) dst + 3, d );
+     }
+
+     if (len)
+          direct_memcpy( dst, src, len );
+}
+#endif
+
+static void
+transfer_region( const TransferRegion *region )
+{
+     int         i;
+     const char *src = region->src;
+     char       *dst = region->dst;
+
+     if (!region->lines)
+          return;
+
+#ifdef USE_SSE2
+     if (region->nontemporal) {
+          /* Equal pitches allow copying the lines including the padding in between with one call. */
+          if (region->srcpitch == region->dstpitch)
+               copy_nontemporal( dst, src, (size_t) region->srcpitch * (region->lines - 1) + region->bytes );
+          else {
+               for (i = 0; i < region->lines; i++) {
+                    copy_nontemporal( dst, src, region->bytes );
+                    src += region->srcpitch;
+                    dst += region->dstpitch;
+               }
+          }
+
+          _mm_sfence();
+
+          return;
+     }
+#endif
+
+     if (region->srcpitch == region->dstpitch)
+          direct_memcpy( dst, src, (size_t) region->srcpitch * (region->lines - 1) + region->bytes );
+     else {
+          for (i = 0; i < region->lines; i++) {
+               direct_memcpy( dst, src, region->bytes );
+               src += region->srcpitch;
+               dst += region->dstpitch;
+          }
+     }
+}
+
+static void *
+transfer_thread( DirectThread *thread,
+                 void         *arg )
+{
+     transfer_region( arg );
+
+     return NULL;
+}
+
+/*
+ * Copy the lines of a plane, splitting them across up to 'surface-transfer-threads' threads if the plane is large.
+ */
+static void
+transfer_plane( const char *src,
+                char       *dst,
+                int         srcpitch,
+                int         dstpitch,
+                int         bytes,
+                int         lines,
+                bool        nontemporal )
+{
+     int             i;
+     int             num;
+     TransferRegion  regions[MAX_TRANSFER_THREADS];
+     DirectThread   *threads[MAX_TRANSFER_THREADS];
+
+     num = MIN( dfb_config->surface_transfer_threads, (long long) bytes * lines / TRANSFER_THREAD_SIZE );
+     num = CLAMP( num, 1, MIN( MAX_TRANSFER_THREADS, lines ) );
+
+     for (i = 0; i < num; i++) {
+          int first = lines * i / num;
+          int last  = lines * (i + 1) / num;
+
+          regions[i].src         = src + (long) srcpitch * first;
+          regions[i].dst         = dst + (long) dstpitch * first;
+          regions[i].srcpitch    = srcpitch;
+          regions[i].dstpitch    = dstpitch;
+          regions[i].bytes       = bytes;
+          regions[i].lines       = last - first;
+          regions[i].nontemporal = nontemporal;
+     }
+
+     if (num > 1)
+          D_DEBUG_AT( Core_SurfAllocation, "  -> %d x %d bytes split into %d regions\n", lines, bytes, num );
+
+     /* The calling thread copies the first region while the others are copied by short lived threads. */
+     for (i = 1; i < num; i++)
+          threads[i] = direct_thread_create( DTT_DEFAULT, transfer_thread, &regions[i], "Surface Transfer" );
+
+     transfer_region( &regions[0] );
+
+     for (i = 1; i < num; i++) {
+          if (threads[i]) {
+               direct_thread_join( threads[i] );
+               direct_thread_destroy( threads[i] );
+          }
+          else
+               transfer_region( &regions[i] );
+     }
+}
+
 static void
 transfer_buffer( const CoreSurfaceConfig *config,
                  const char              *src,
                  char                    *dst,
                  int                      srcpitch,
-                 int                      dstpitch )
+                 int                      dstpitch,
+                 bool                     video )
 {
-     int i;
+     int  bytes;
+     bool nontemporal = false;
 
      D_DEBUG_AT( Core_SurfAllocation, "%s( %p, %p [%d] -> %p [%d] ) <- %d\n", __FUNCTION__,
                  config, src, srcpitch, dst, dstpitch, config->size.h );
@@ -219,65 +391,51 @@ transfer_buffer( const CoreSurfaceConfig *config,
      D_ASSERT( srcpitch >= DFB_BYTES_PER_LINE( config->format, config->size.w ) );
      D_ASSERT( dstpitch >= DFB_BYTES_PER_LINE( config->format, config->size.w ) );
 
-     for (i = 0; i < config->size.h; i++) {
-          direct_memcpy( dst, src, DFB_BYTES_PER_LINE( config->format, config->size.w ) );
-          src += srcpitch;
-          dst += dstpitch;
-     }
+     bytes = DFB_BYTES_PER_LINE( config->format, config->size.w );
+
+#ifdef USE_SSE2
+     if (dfb_config->sse2)
+          nontemporal = video || (long long) dstpitch * config->size.h >= TRANSFER_NONTEMPORAL_SIZE;
+#endif
+
+     transfer_plane( src, dst, srcpitch, dstpitch, bytes, config->size.h, nontemporal );
+
+     src += srcpitch * config->size.h;
+     dst += dstpitch * config->size.h;
 
      switch (config->format) {
           case DSPF_I420:
           case DSPF_YV12:
-               for (i = 0; i < config->size.h; i++) {
-                    direct_memcpy( dst, src, DFB_BYTES_PER_LINE( config->format, config->size.w / 2 ) );
-                    src += srcpitch / 2;
-                    dst += dstpitch / 2;
-               }
+               transfer_plane( src, dst, srcpitch / 2, dstpitch / 2,
+                               DFB_BYTES_PER_LINE( config->format, config->size.w / 2 ), config->size.h, nontemporal );
                break;
 
           case DSPF_NV12:
           case DSPF_NV21:
-               for (i = 0; i < config->size.h / 2; i++) {
-                    direct_memcpy( dst, src, DFB_BYTES_PER_LINE( config->format, config->size.w ) );
-                    src += srcpitch;
-                    dst += dstpitch;
-               }
+               transfer_plane( src, dst, srcpitch, dstpitch, bytes, config->size.h / 2, nontemporal );
                break;
 
           case DSPF_Y42B:
           case DSPF_YV16:
-               for (i = 0; i < config->size.h * 2; i++) {
-                    direct_memcpy( dst, src, DFB_BYTES_PER_LINE( config->format, config->size.w / 2 ) );
-                    src += srcpitch / 2;
-                    dst += dstpitch / 2;
-               }
+               transfer_plane( src, dst, srcpitch / 2, dstpitch / 2,
+                               DFB_BYTES_PER_LINE( config->format, config->size.w / 2 ), config->size.h * 2,
+                               nontemporal );
                break;
 
           case DSPF_NV16:
           case DSPF_NV61:
-               for (i = 0; i < config->size.h; i++) {
-                    direct_memcpy( dst, src, DFB_BYTES_PER_LINE( config->format, config->size.w ) );
-                    src += srcpitch;
-                    dst += dstpitch;
-               }
+               transfer_plane( src, dst, srcpitch, dstpitch, bytes, config->size.h, nontemporal );
                break;
 
           case DSPF_Y444:
           case DSPF_YV24:
-               for (i = 0; i < config->size.h * 2; i++) {
-                    direct_memcpy( dst, src, DFB_BYTES_PER_LINE( config->format, config->size.w ) );
-                    src += srcpitch;
-                    dst += dstpitch;
-               }
+               transfer_plane( src, dst, srcpitch, dstpitch, bytes, config->size.h * 2, nontemporal );
                break;
 
           case DSPF_NV24:
           case DSPF_NV42:
-               for (i = 0; i < config->size.h; i++) {
-                    direct_memcpy( dst, src, DFB_BYTES_PER_LINE( config->format, config->size.w * 2 ) );
-                    src += srcpitch;
-                    dst += dstpitch;
-               }
+               transfer_plane( src, dst, srcpitch, dstpitch,
+                               DFB_BYTES_PER_LINE( config->format, config->size.w * 2 ), config->size.h, nontemporal );
                break;
 
           default:
@@ -328,7 +486,8 @@ allocation_update_copy( CoreSurfaceAllocation *allocation,
           return ret;
      }
 
-     transfer_buffer( &allocation->config, (char*) src.addr, (char*) dst.addr, src.pitch, dst.pitch );
+     transfer_buffer( &allocation->config, (char*) src.addr, (char*) dst.addr, src.pitch, dst.pitch,
+                      allocation->pool->desc.caps & CSPCAPS_PHYSICAL );
 
      dfb_surface_pool_unlock( allocation->pool, allocation, &dst );
      dfb_surface_pool_unlock( source->pool, source, &src );
@@ -417,6 +576,116 @@ allocation_update_read( CoreSurfaceAllocation *allocation,
      return ret;
 }
 
+static DFBResult
+allocation_clear( CoreSurfaceAllocation *allocation )
+{
+     DFBResult             ret;
+     CoreSurfaceBufferLock dst;
+     int                   y;
+     int                   bytes = DFB_BYTES_PER_LINE( allocation->config.format, allocation->config.size.w );
+     int                   lines = DFB_PLANE_MULTIPLY( allocation->config.format, allocation->config.size.h );
+
+     D_DEBUG_AT( Core_SurfAllocation, "%s( %p )\n", __FUNCTION__, allocation );
+
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+
+     if (!(allocation->access[CSAID_CPU] & CSAF_WRITE)) {
+          void *data;
+
+          data = D_CALLOC( lines, bytes );
+          if (!data)
+               return D_OOM();
+
+          ret = dfb_surface_pool_write( allocation->pool, allocation, data, bytes, NULL );
+
+          D_FREE( data );
+
+          return ret;
+     }
+
+     /* Lock the allocation. */
+     dfb_surface_buffer_lock_init( &dst, CSAID_CPU, CSAF_WRITE );
+
+     dfb_surface_pool_prelock( allocation->pool, allocation, CSAID_CPU, CSAF_WRITE );
+
+     allocation->accessed[CSAID_CPU] |= CSAF_WRITE;
+
+     ret = dfb_surface_pool_lock( allocation->pool, allocation, &dst );
+     if (ret) {
+          D_DEBUG_AT( Core_SurfAllocation, "  -> could not lock allocation for clearing\n" );
+          dfb_surface_buffer_lock_deinit( &dst );
+          return ret;
+     }
+
+     for (y = 0; y < lines; y++)
+          memset( (char*) dst.addr + y * dst.pitch, 0, bytes );
+
+     dfb_surface_pool_unlock( allocation->pool, allocation, &dst );
+
+     dfb_surface_buffer_lock_deinit( &dst );
+
+     return DFB_OK;
+}
+
+/*
+ * Clear the buffer with the graphics card, for allocations that can't be cleared by the CPU. The buffer is locked
+ * like for drawing, which may use another allocation of the buffer.
+ */
+static DFBResult
+allocation_clear_gfx( CoreSurfaceAllocation *allocation )
+{
+     DFBResult             ret;
+     CardState             state;
+     DFBRectangle          rect;
+     DFBSurfaceBufferRole  role;
+     DFBSurfaceStereoEye   eye;
+     CoreSurfaceBuffer    *buffer  = allocation->buffer;
+     CoreSurface          *surface = buffer->surface;
+
+     D_DEBUG_AT( Core_SurfAllocation, "%s( %p )\n", __FUNCTION__, allocation );
+
+     eye = (buffer->flags & CSBF_RIGHT) ? DSSE_RIGHT : DSSE_LEFT;
+
+     /* Find the role of the buffer for locking. */
+     for (role = DSBR_FRONT; role <= DSBR_IDLE; role++) {
+          if (dfb_surface_get_buffer2( surface, role, eye ) == buffer)
+               break;
+     }
+
+     if (role > DSBR_IDLE)
+          return DFB_UNSUPPORTED;
+
+     dfb_state_init( &state, core_dfb );
+
+     ret = dfb_state_set_destination( &state, surface );
+     if (ret) {
+          dfb_state_destroy( &state );
+          return ret;
+     }
+
+     rect.x = 0;
+     rect.y = 0;
+     rect.w = surface->config.size.w;
+     rect.h = surface->config.size.h;
+
+     state.clip.x2 = rect.w - 1;
+     state.clip.y2 = rect.h - 1;
+     state.to      = role;
+     state.to_eye  = eye;
+
+     dfb_gfxcard_fillrectangles( &rect, 1, &state );
+
+     dfb_gfxcard_flush();
+
+     dfb_state_stop_drawing( &state );
+
+     dfb_state_set_destination( &state, NULL );
+
+     dfb_state_destroy( &state );
+
+     return DFB_OK;
+}
+
 DFBResult
 dfb_surface_allocation_update( CoreSurfaceAllocation  *allocation,
                                CoreSurfaceAccessFlags  access )
@@ -437,6 +706,31 @@ dfb_surface_allocation_update( CoreSurfaceAllocation  *allocation,
      D_MAGIC_ASSERT( buffer->surface, CoreSurface );
      FUSION_SKIRMISH_ASSERT( &buffer->surface->lock );
 
+     /* Clear the buffer when it is locked for the first time, but not for transfers between pools. */
+     if (access != CSAF_NONE && (buffer->flags & CSBF_CLEAR)) {
+          buffer->flags &= ~CSBF_CLEAR;
+
+          ret = allocation_clear( allocation );
+          if (ret == DFB_OK) {
+               direct_serial_increase( &buffer->serial );
+
+               direct_serial_copy( &allocation->serial, &buffer->serial );
+
+               buffer->written = allocation;
+               buffer->read    = NULL;
+          }
+          else {
+               D_DEBUG_AT( Core_SurfAllocation, "  -> clearing with the graphics card\n" );
+
+               /* If another allocation gets cleared, the allocation is updated from it below. */
+               ret = allocation_clear_gfx( allocation );
+
+               /* The content is undefined then, but the buffer remains usable. */
+               if (ret)
+                    D_DERROR( ret, "Core/SurfAllocation: Deferred clearing failed!\n" );
+          }
+     }
+
      if (direct_serial_update( &allocation->serial, &buffer->serial ) && buffer->written) {
           CoreSurfaceAllocation *source = buffer->written;
 
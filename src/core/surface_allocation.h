@@ -29,12 +29,13 @@ typedef enum {
      CSALF_INITIALIZING = 0x00000001, /* Allocation is being initialized. */
      CSALF_VOLATILE     = 0x00000002, /* Allocation should be freed when no longer up to date. */
      CSALF_PREALLOCATED = 0x00000004, /* Preallocated memory, don't zap when "thrifty-surface-buffers" is active. */
+     CSALF_PARKED       = 0x00000008, /* Buffer is compressed, restored on the next lock. */
 
      CSALF_MUCKOUT      = 0x00001000, /* Indicates surface pool being in the progress of mucking out this and possibly
                                          other allocations to have enough space for a new allocation to be made. */
      CSALF_DEALLOCATED  = 0x00002000, /* Decoupled and deallocated surface buffer allocation. */
 
-     CSALF_ALL          = 0x00003007  /* All of these. */
+     CSALF_ALL          = 0x0000300F  /* All of these. */
 } CoreSurfaceAllocationFlags;
 
 struct __DFB_CoreSurfaceAllocation {
@@ -68,6 +69,10 @@ struct __DFB_CoreSurfaceAllocation {
      FusionCall                    call;                /* dispatch */
 
      FusionObjectID                buffer_id;           /* buffer id */
+
+     long long                     last_access;         /* Time of the last lock in milliseconds, used for eviction. */
+     int                           packed_size;         /* Size of the compressed buffer while being parked. */
+     FusionID                      identity;            /* Creator of the surface, for memory accounting. */
 };
 
 #if D_DEBUG_ENABLED
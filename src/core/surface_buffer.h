@@ -35,8 +35,9 @@ typedef enum {
 
      CSBF_DECOUPLE = 0x00000002, /* Buffer is about to be deallocated and removed from surface. */
      CSBF_RIGHT    = 0x00000004, /* Buffer is for right eye. */
+     CSBF_CLEAR    = 0x00000008, /* Buffer is cleared when it is locked for the first time. */
 
-     CSBF_ALL      = 0x00000006  /* All of these. */
+     CSBF_ALL      = 0x0000000E  /* All of these. */
 } CoreSurfaceBufferFlags;
 
 struct __DFB_CoreSurfaceBuffer {
@@ -16,12 +16,16 @@
    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 */
 
+#include <config.h>
+#include <core/core.h>
 #include <core/core_parts.h>
+#include <core/fonts.h>
 #include <core/surface_allocation.h>
 #include <core/surface_buffer.h>
 #include <core/surface_core.h>
 #include <core/surface_pool_bridge.h>
 #include <direct/signals.h>
+#include <direct/thread.h>
 #include <directfb_util.h>
 #include <fusion/conf.h>
 
@@ -36,6 +40,9 @@ DFB_CORE_PART( surface_core, SurfaceCore );
 #if FUSION_BUILD_MULTI
 extern const SurfacePoolFuncs       sharedSurfacePoolFuncs;
 extern const SurfacePoolFuncs       sharedSecureSurfacePoolFuncs;
+#if HAVE_MEMFD_CREATE
+extern const SurfacePoolFuncs       memfdSurfacePoolFuncs;
+#endif
 #else /* FUSION_BUILD_MULTI */
 extern const SurfacePoolFuncs       localSurfacePoolFuncs;
 #endif /* FUSION_BUILD_MULTI */
@@ -152,7 +159,8 @@ static DFBEnumerationResult
 surface_pool_callback( CoreSurfacePool *pool,
                        void            *ctx )
 {
-     int length;
+     int                      length;
+     CoreSurfacePoolParkStats stats;
 
      printf( "\n" );
      printf( "--------------------[ Surface Buffer Allocations in %s ]--------------------%n\n",
@@ -166,6 +174,12 @@ surface_pool_callback( CoreSurfacePool *pool,
 
      dfb_surface_pool_enumerate( pool, alloc_callback, NULL );
 
+     if (dfb_surface_pool_park_stats( pool, &stats ) == DFB_OK && stats.parks) {
+          printf( "\nParked: %u allocations, %llu kB in %llu kB, %u parks, %u unparks (avg %lld us, max %lld us)\n",
+                  stats.parked, stats.parked_bytes / 1024, stats.packed_bytes / 1024, stats.parks, stats.unparks,
+                  stats.unparks ? stats.unpark_micros / stats.unparks : 0, stats.unpark_max_micros );
+     }
+
      return DFENUM_OK;
 }
 
@@ -180,11 +194,118 @@ dfb_surface_core_dump_handler( int   num,
                                void *addr,
                                void *ctx )
 {
+     DFBSurfaceCore  *data    = ctx;
+     CoreFontManager *manager = dfb_core_font_manager( data->core );
+
      dump_surface_pools();
 
+     if (manager)
+          dfb_font_manager_dump( manager );
+
      return DSHR_OK;
 }
 
+static void *
+park_thread_main( DirectThread *thread,
+                  void         *arg )
+{
+     DFBSurfaceCore *data = arg;
+     long long       idle = dfb_config->surface_park_idle;
+
+     direct_mutex_lock( &data->park_lock );
+
+     while (!data->park_quit) {
+          /* Check twice per idle time, allocations are parked after at most one and a half of it. */
+          direct_waitqueue_wait_timeout( &data->park_cond, &data->park_lock, MAX( idle / 2, 100 ) * 1000 );
+
+          if (data->park_quit)
+               break;
+
+          direct_mutex_unlock( &data->park_lock );
+
+          dfb_surface_pool_park_idle( data->shared->surface_pool, idle );
+
+          direct_mutex_lock( &data->park_lock );
+     }
+
+     direct_mutex_unlock( &data->park_lock );
+
+     return NULL;
+}
+
+static void
+stop_park_thread( DFBSurfaceCore *data )
+{
+     if (!data->park_thread)
+          return;
+
+     direct_mutex_lock( &data->park_lock );
+
+     data->park_quit = true;
+
+     direct_waitqueue_broadcast( &data->park_cond );
+
+     direct_mutex_unlock( &data->park_lock );
+
+     direct_thread_join( data->park_thread );
+     direct_thread_destroy( data->park_thread );
+
+     data->park_thread = NULL;
+
+     direct_waitqueue_deinit( &data->park_cond );
+     direct_mutex_deinit( &data->park_lock );
+}
+
+static void *
+stats_thread_main( DirectThread *thread,
+                   void         *arg )
+{
+     DFBSurfaceCore *data = arg;
+
+     direct_mutex_lock( &data->stats_lock );
+
+     while (!data->stats_quit) {
+          direct_waitqueue_wait_timeout( &data->stats_cond, &data->stats_lock,
+                                         dfb_config->surface_memory_stats * 1000LL );
+
+          if (data->stats_quit)
+               break;
+
+          direct_mutex_unlock( &data->stats_lock );
+
+          dfb_surface_pools_log_usage();
+
+          direct_mutex_lock( &data->stats_lock );
+     }
+
+     direct_mutex_unlock( &data->stats_lock );
+
+     return NULL;
+}
+
+static void
+stop_stats_thread( DFBSurfaceCore *data )
+{
+     if (!data->stats_thread)
+          return;
+
+     direct_mutex_lock( &data->stats_lock );
+
+     data->stats_quit = true;
+
+     direct_waitqueue_broadcast( &data->stats_cond );
+
+     direct_mutex_unlock( &data->stats_lock );
+
+     direct_thread_join( data->stats_thread );
+     direct_thread_destroy( data->stats_thread );
+
+     data->stats_thread = NULL;
+
+     direct_waitqueue_deinit( &data->stats_cond );
+     direct_mutex_deinit( &data->stats_lock );
+}
+
 static DFBResult
 dfb_surface_core_initialize( CoreDFB              *core,
                              DFBSurfaceCore       *data,
@@ -201,6 +322,22 @@ dfb_surface_core_initialize( CoreDFB              *core,
      data->shared = shared;
 
 #if FUSION_BUILD_MULTI
+#if HAVE_MEMFD_CREATE
+     /* The memfd pool does not restrict access to the buffers like the secure pool. */
+     if (dfb_config->surface_memfd && fusion_config->secure_fusion)
+          D_WARN( "option 'surface-memfd' ignored with secure fusion" );
+
+     if (dfb_config->surface_memfd && !fusion_config->secure_fusion) {
+          ret = dfb_surface_pool_initialize2( core, &memfdSurfacePoolFuncs, data, &shared->surface_pool );
+          if (ret) {
+               D_DERROR( ret, "Core/SurfaceCore: Could not register 'memfd' surface pool!\n" );
+               return ret;
+          }
+
+          shared->memfd_pool = true;
+     }
+     else
+#endif
      if (fusion_config->secure_fusion) {
           ret = dfb_surface_pool_initialize2( core, &sharedSecureSurfacePoolFuncs, data, &shared->surface_pool );
           if (ret) {
@@ -252,6 +389,22 @@ dfb_surface_core_initialize( CoreDFB              *core,
      D_MAGIC_SET( data, DFBSurfaceCore );
      D_MAGIC_SET( shared, DFBSurfaceCoreShared );
 
+     /* The master parks idle allocations of the system memory pool. */
+     if (dfb_config->surface_park_idle) {
+          direct_mutex_init( &data->park_lock );
+          direct_waitqueue_init( &data->park_cond );
+
+          data->park_thread = direct_thread_create( DTT_CLEANUP, park_thread_main, data, "Surface Park" );
+     }
+
+     /* The master logs the memory usage of all processes. */
+     if (dfb_config->surface_memory_stats) {
+          direct_mutex_init( &data->stats_lock );
+          direct_waitqueue_init( &data->stats_cond );
+
+          data->stats_thread = direct_thread_create( DTT_CLEANUP, stats_thread_main, data, "Surface Stats" );
+     }
+
      return DFB_OK;
 }
 
@@ -271,6 +424,11 @@ dfb_surface_core_join( CoreDFB              *core,
      data->shared = shared;
 
 #if FUSION_BUILD_MULTI
+#if HAVE_MEMFD_CREATE
+     if (shared->memfd_pool)
+          dfb_surface_pool_join2( core, shared->surface_pool, &memfdSurfacePoolFuncs, data );
+     else
+#endif
      if (fusion_config->secure_fusion)
           dfb_surface_pool_join2( core, shared->surface_pool, &sharedSecureSurfacePoolFuncs, data );
      else
@@ -311,6 +469,9 @@ dfb_surface_core_shutdown( DFBSurfaceCore *data,
 
      shared = data->shared;
 
+     stop_park_thread( data );
+     stop_stats_thread( data );
+
      direct_signal_handler_remove( data->dump_signal_handler );
 
      dfb_surface_pool_bridge_destroy( shared->prealloc_pool_bridge );
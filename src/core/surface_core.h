@@ -20,6 +20,8 @@
 #define __CORE__SURFACE_CORE_H__
 
 #include <core/coretypes.h>
+#include <direct/mutex.h>
+#include <direct/waitqueue.h>
 
 /**********************************************************************************************************************/
 
@@ -29,6 +31,8 @@ typedef struct {
      CoreSurfacePool       *surface_pool;
      CoreSurfacePool       *prealloc_pool;
 
+     bool                   memfd_pool;        /* surface_pool is the memfd surface pool */
+
      CoreSurfacePoolBridge *prealloc_pool_bridge;
 } DFBSurfaceCoreShared;
 
@@ -40,6 +44,16 @@ typedef struct __DFB_DFBSurfaceCore {
      DFBSurfaceCoreShared *shared;
 
      DirectSignalHandler  *dump_signal_handler;
+
+     DirectThread         *park_thread;        /* parks idle allocations if 'surface-park-idle' is set */
+     DirectMutex           park_lock;
+     DirectWaitQueue       park_cond;
+     bool                  park_quit;
+
+     DirectThread         *stats_thread;       /* logs the memory usage if 'surface-memory-stats' is set */
+     DirectMutex           stats_lock;
+     DirectWaitQueue       stats_cond;
+     bool                  stats_quit;
 } DFBSurfaceCore;
 
 #endif
@@ -17,6 +17,7 @@
 */
 
 #include <core/core.h>
+#include <core/fonts.h>
 #include <core/surface_allocation.h>
 #include <core/surface_buffer.h>
 #include <core/surface_pool.h>
@@ -37,6 +38,35 @@ static void                   *pool_locals[MAX_SURFACE_POOLS];
 static CoreSurfacePool        *pool_array[MAX_SURFACE_POOLS];
 static unsigned int            pool_order[MAX_SURFACE_POOLS];
 
+/**********************************************************************************************************************/
+
+/*
+ * Results of the negotiation are kept for repeated allocations of surfaces with the same configuration, as long as no
+ * pool was out of memory.
+ */
+
+#define NEGOTIATION_CACHE_SIZE 64
+
+typedef struct {
+     CoreSurfaceConfig       config;
+     CoreSurfaceTypeFlags    type;      /* including the policy of the buffer */
+     CoreSurfaceAccessorID   accessor;
+     CoreSurfaceAccessFlags  access;
+     bool                    master;    /* slaves may only use shared pools */
+} NegotiationKey;
+
+typedef struct {
+     NegotiationKey          key;
+     unsigned int            generation; /* entry is valid if it matches negotiation_generation */
+     DFBResult               result;
+     unsigned int            num;
+     CoreSurfacePoolID       pools[MAX_SURFACE_POOLS];
+} NegotiationEntry;
+
+static DirectMutex             negotiation_lock = DIRECT_MUTEX_INITIALIZER();
+static unsigned int            negotiation_generation = 1;
+static NegotiationEntry        negotiation_cache[NEGOTIATION_CACHE_SIZE];
+
 static __inline__ const SurfacePoolFuncs *
 get_funcs( const CoreSurfacePool *pool )
 {
@@ -60,11 +90,43 @@ get_local( const CoreSurfacePool *pool )
      return pool_locals[pool->pool_id];
 }
 
+static __inline__ CoreSurfaceTypeFlags
+required_type( const CoreSurfaceBuffer *buffer )
+{
+     CoreSurfaceTypeFlags type = buffer->surface->type & ~(CSTF_INTERNAL | CSTF_EXTERNAL);
+
+     switch (buffer->policy) {
+          case CSP_SYSTEMONLY:
+               type |= CSTF_INTERNAL;
+               break;
+
+          case CSP_VIDEOONLY:
+               type |= CSTF_EXTERNAL;
+               break;
+
+          default:
+               break;
+     }
+
+     return type;
+}
+
 static DFBResult init_pool        ( CoreDFB *core, CoreSurfacePool *pool, const SurfacePoolFuncs *funcs, void *ctx );
 static void      insert_pool_local( CoreSurfacePool *pool );
 static void      remove_pool_local( CoreSurfacePoolID pool_id );
 static void      remove_allocation( CoreSurfacePool *pool, CoreSurfaceAllocation *allocation_in );
 static DFBResult backup_allocation( CoreSurfaceAllocation *allocation_in );
+static DFBResult muck_out_flagged ( CoreSurfacePool *pool );
+static DFBResult flag_lru_victims ( CoreSurfacePool *pool, CoreSurfaceBuffer *buffer );
+static DFBResult unpark_allocation( CoreSurfacePool *pool, CoreSurfaceAllocation *allocation );
+static void      account_usage    ( CoreSurfacePool *pool, CoreSurfaceAllocation *allocation, bool add );
+static bool      negotiation_key  ( CoreSurfaceBuffer *buffer, CoreSurfaceAccessorID accessor,
+                                    CoreSurfaceAccessFlags access, NegotiationKey *ret_key );
+static bool      lookup_negotiated( const NegotiationKey *key, CoreSurfacePool **ret_pools, unsigned int max_pools,
+                                    unsigned int *ret_num, DFBResult *ret_result );
+static void      store_negotiated ( const NegotiationKey *key, CoreSurfacePool **pools, unsigned int num,
+                                    DFBResult result );
+static void      forget_negotiated( const NegotiationKey *key );
 
 /**********************************************************************************************************************/
 
@@ -220,6 +282,8 @@ DFBResult
 dfb_surface_pool_destroy( CoreSurfacePool *pool )
 {
      const SurfacePoolFuncs *funcs;
+     int                     i;
+     CoreSurfacePoolUsage   *usage;
 
      D_MAGIC_ASSERT( pool, CoreSurfacePool );
      D_ASSERT( pool->pool_id >= 0 );
@@ -242,6 +306,10 @@ dfb_surface_pool_destroy( CoreSurfacePool *pool )
 
      fusion_skirmish_destroy( &pool->lock );
 
+     fusion_vector_foreach (usage, i, pool->usages)
+          SHFREE( pool->shmpool, usage );
+
+     fusion_vector_destroy( &pool->usages );
      fusion_vector_destroy( &pool->allocs );
 
      D_MAGIC_CLEAR( pool );
@@ -346,6 +414,8 @@ dfb_surface_pools_negotiate( CoreSurfaceBuffer       *buffer,
      CoreSurfacePool      *free_pools[pool_count];
      unsigned int          oom_count = 0;
      CoreSurfacePool      *oom_pools[pool_count];
+     NegotiationKey        key;
+     bool                  cacheable;
 
      D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
      D_MAGIC_ASSERT( buffer->surface, CoreSurface );
@@ -371,23 +441,18 @@ dfb_surface_pools_negotiate( CoreSurfaceBuffer       *buffer,
      if (accessor < 0 || accessor >= CSAID_NUM)
           return DFB_INVARG;
 
-     type = surface->type & ~(CSTF_INTERNAL | CSTF_EXTERNAL);
+     type = required_type( buffer );
 
-     switch (buffer->policy) {
-          case CSP_SYSTEMONLY:
-               type |= CSTF_INTERNAL;
-               break;
+     D_DEBUG_AT( Core_SurfacePool, "  -> 0x%02x 0x%03x required\n", access, type );
 
-          case CSP_VIDEOONLY:
-               type |= CSTF_EXTERNAL;
-               break;
+     /* Skip the pool tests for a configuration negotiated before. */
+     cacheable = negotiation_key( buffer, accessor, access, &key );
 
-          default:
-               break;
+     if (cacheable && lookup_negotiated( &key, ret_pools, max_pools, ret_num, &ret )) {
+          D_DEBUG_AT( Core_SurfacePool, "  -> %u pools (cached)\n", *ret_num );
+          return ret;
      }
 
-     D_DEBUG_AT( Core_SurfacePool, "  -> 0x%02x 0x%03x required\n", access, type );
-
      if (access & CSAF_READ)
           D_DEBUG_AT( Core_SurfacePool, "  -> READ\n" );
 
@@ -480,7 +545,13 @@ dfb_surface_pools_negotiate( CoreSurfaceBuffer       *buffer,
 
      *ret_num = num;
 
-     return free_count ? DFB_OK : oom_count ? DFB_NOVIDEOMEMORY : DFB_UNSUPPORTED;
+     ret = free_count ? DFB_OK : oom_count ? DFB_NOVIDEOMEMORY : DFB_UNSUPPORTED;
+
+     /* Pools out of memory are not ranked again after deallocations, so such results are not kept. */
+     if (cacheable && num && !oom_count && num == free_count)
+          store_negotiated( &key, ret_pools, num, ret );
+
+     return ret;
 }
 
 DFBResult
@@ -529,6 +600,42 @@ dfb_surface_pools_lookup( CoreSurfacePoolID   pool_id,
      return DFB_IDNOTFOUND;
 }
 
+DFBResult
+dfb_surface_pools_get_usage( FusionID               identity,
+                             DFBSurfaceMemoryUsage *ret_usage )
+{
+     DFBResult            ret;
+     int                  i, n;
+     CoreSurfacePoolUsage usage;
+
+     D_ASSERT( ret_usage != NULL );
+
+     D_DEBUG_AT( Core_SurfacePool, "%s( %lu )\n", __FUNCTION__, identity );
+
+     memset( ret_usage, 0, sizeof(DFBSurfaceMemoryUsage) );
+
+     for (i = 0; i < pool_count; i++) {
+          CoreSurfacePool        *pool = pool_array[i];
+          DFBSurfaceMemoryAmount *amounts;
+
+          D_MAGIC_ASSERT( pool, CoreSurfacePool );
+
+          ret = dfb_surface_pool_get_usage( pool, identity, &usage );
+          if (ret)
+               return ret;
+
+          /* Pools of system memory may also be used for video memory surfaces (CSCAPS_SYSMEM_EXTERNAL). */
+          amounts = (pool->desc.types & CSTF_INTERNAL) ? ret_usage->system : ret_usage->video;
+
+          for (n = 0; n < DSMT_NUM; n++) {
+               amounts[n].allocations += usage.amounts[n].allocations;
+               amounts[n].bytes       += usage.amounts[n].bytes;
+          }
+     }
+
+     return DFB_OK;
+}
+
 DFBResult
 dfb_surface_pools_allocate( CoreSurfaceBuffer       *buffer,
                             CoreSurfaceAccessorID    accessor,
@@ -541,6 +648,7 @@ dfb_surface_pools_allocate( CoreSurfaceBuffer       *buffer,
      CoreSurfaceAllocation *allocation = NULL;
      CoreSurfacePool       *pools[pool_count];
      unsigned int           num_pools;
+     NegotiationKey         key;
 
      D_UNUSED_P( surface );
 
@@ -604,6 +712,10 @@ dfb_surface_pools_allocate( CoreSurfaceBuffer       *buffer,
           }
      }
 
+     /* Negotiate again next time if the preferred pool could not do the allocation. */
+     if ((!allocation || i > 0) && negotiation_key( buffer, accessor, access, &key ))
+          forget_negotiated( &key );
+
      /* Check if none of the pools could do the allocation. */
      if (!allocation) {
           /* Try to find a pool with older allocations to muck out. */
@@ -623,6 +735,27 @@ dfb_surface_pools_allocate( CoreSurfaceBuffer       *buffer,
           }
      }
 
+     /* Release least recently used glyph cache rows and try once more. */
+     if (!allocation && core_dfb && core_dfb->font_manager) {
+          int size;
+
+          dfb_surface_calc_buffer_size( surface, 8, 1, NULL, &size );
+
+          if (dfb_font_manager_trim( core_dfb->font_manager, size, NULL ) == DFB_OK) {
+               D_DEBUG_AT( Core_SurfacePool, "  -> trimmed font caches, retrying...\n" );
+
+               for (i = 0; i < num_pools; i++) {
+                    CoreSurfacePool *pool = pools[i];
+
+                    if (!pool)
+                         continue;
+
+                    if (dfb_surface_pool_allocate( pool, buffer, NULL, 0, &allocation ) == DFB_OK)
+                         break;
+               }
+          }
+     }
+
      if (!allocation) {
           D_DEBUG_AT( Core_SurfacePool, "  -> allocation failed!\n" );
           return DFB_FAILURE;
@@ -810,6 +943,8 @@ dfb_surface_pool_allocate( CoreSurfacePool        *pool,
      fusion_vector_add( &buffer->allocs, allocation );
      fusion_vector_add( &pool->allocs, allocation );
 
+     account_usage( pool, allocation, true );
+
      /* Mark the CoreSurfaceAllocation as having been read and written to by the CPU because it is possible that
         the CPU cache after the allocation has some data due to a read/write performed as part of allocation. */
      allocation->accessed[CSAID_CPU] |= CSAF_READ | CSAF_WRITE;
@@ -866,8 +1001,18 @@ dfb_surface_pool_deallocate( CoreSurfacePool       *pool,
           return ret;
      }
 
+     if (allocation->flags & CSALF_PARKED) {
+          pool->park_stats.parked--;
+          pool->park_stats.parked_bytes -= allocation->size;
+          pool->park_stats.packed_bytes -= allocation->packed_size;
+
+          allocation->flags &= ~CSALF_PARKED;
+     }
+
      remove_allocation( pool, allocation );
 
+     account_usage( pool, allocation, false );
+
      allocation->flags |= CSALF_DEALLOCATED;
 
      CoreSurfaceAllocationNotification notification;
@@ -884,10 +1029,8 @@ dfb_surface_pool_displace( CoreSurfacePool        *pool,
                            CoreSurfaceBuffer      *buffer,
                            CoreSurfaceAllocation **ret_allocation )
 {
-     DFBResult               ret, ret_lock = DFB_OK;
-     int                     i, retries = 3;
+     DFBResult               ret;
      CoreSurface            *surface;
-     CoreSurfaceAllocation  *allocation;
      const SurfacePoolFuncs *funcs;
 
      D_UNUSED_P( surface );
@@ -910,81 +1053,46 @@ dfb_surface_pool_displace( CoreSurfacePool        *pool,
           return DFB_FUSION;
 
      /* Check for integrated method to muck out older allocations for a new one. */
-     if (funcs->MuckOut) {
+     if (funcs->MuckOut)
           ret = funcs->MuckOut( pool, pool->data, get_local(pool), buffer );
-          if (ret) {
-               fusion_skirmish_dismiss( &pool->lock );
-               return ret;
-          }
-     }
-     else {
-          D_UNIMPLEMENTED();
-     }
-
-retry:
-     fusion_vector_foreach (allocation, i, pool->allocs) {
-          CORE_SURFACE_ALLOCATION_ASSERT( allocation );
-
-          if (allocation->flags & CSALF_MUCKOUT) {
-               CoreSurface       *alloc_surface;
-               CoreSurfaceBuffer *alloc_buffer;
-
-               alloc_buffer = allocation->buffer;
-
-               D_MAGIC_ASSERT( alloc_buffer, CoreSurfaceBuffer );
-
-               alloc_surface = alloc_buffer->surface;
-
-               D_MAGIC_ASSERT( alloc_surface, CoreSurface );
-
-               D_DEBUG_AT( Core_SurfacePool, "  <= %p %5dk, %lu\n",
-                           allocation, allocation->size / 1024, allocation->offset );
+     else
+          ret = flag_lru_victims( pool, buffer );
 
-               ret = dfb_surface_trylock( alloc_surface );
-               if (ret) {
-                    D_WARN( "could not lock surface (%s)", DirectFBErrorString( ret ) );
-                    ret_lock = ret;
-                    continue;
-               }
+     if (ret) {
+          fusion_skirmish_dismiss( &pool->lock );
+          return ret;
+     }
 
-               /* Ensure mucked out allocation is backed up to another pool. */
-               ret = backup_allocation( allocation );
-               if (ret) {
-                    D_WARN( "could not backup allocation (%s)", DirectFBErrorString( ret ) );
-                    dfb_surface_unlock( alloc_surface );
-                    goto error;
-               }
+     ret = muck_out_flagged( pool );
+     if (ret == DFB_OK)
+          ret = dfb_surface_pool_allocate( pool, buffer, NULL, 0, ret_allocation );
 
-               /* Deallocate mucked out allocation. */
-               dfb_surface_allocation_decouple( allocation );
-               i--;
+     fusion_skirmish_dismiss( &pool->lock );
 
-               dfb_surface_unlock( alloc_surface );
-          }
-     }
+     return ret;
+}
 
-     if (ret_lock) {
-          if (retries--)
-               goto retry;
+DFBResult
+dfb_surface_pool_compact( CoreSurfacePool *pool )
+{
+     DFBResult               ret;
+     const SurfacePoolFuncs *funcs;
 
-          ret = DFB_LOCKED;
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
 
-          goto error;
-     }
-     else
-          ret = dfb_surface_pool_allocate( pool, buffer, NULL, 0, ret_allocation );
+     D_DEBUG_AT( Core_SurfacePool, "%s( %p [%u - %s] )\n", __FUNCTION__, pool, pool->pool_id, pool->desc.name );
 
-     fusion_skirmish_dismiss( &pool->lock );
+     funcs = get_funcs( pool );
 
-     return ret;
+     if (!funcs->Compact)
+          return DFB_UNSUPPORTED;
 
-error:
-     fusion_vector_foreach (allocation, i, pool->allocs) {
-          CORE_SURFACE_ALLOCATION_ASSERT( allocation );
+     if (fusion_skirmish_prevail( &pool->lock ))
+          return DFB_FUSION;
 
-          if (allocation->flags & CSALF_MUCKOUT)
-               allocation->flags &= ~CSALF_MUCKOUT;
-     }
+     ret = funcs->Compact( pool, pool->data, get_local(pool) );
+     if (ret == DFB_OK)
+          ret = muck_out_flagged( pool );
 
      fusion_skirmish_dismiss( &pool->lock );
 
@@ -1047,6 +1155,13 @@ dfb_surface_pool_lock( CoreSurfacePool       *pool,
 
      D_ASSERT( funcs->Lock != NULL );
 
+     /* Restore a parked buffer first. */
+     if (allocation->flags & CSALF_PARKED) {
+          ret = unpark_allocation( pool, allocation );
+          if (ret)
+               return ret;
+     }
+
      lock->allocation = allocation;
      lock->buffer     = allocation->buffer;
 
@@ -1057,6 +1172,8 @@ dfb_surface_pool_lock( CoreSurfacePool       *pool,
           return ret;
      }
 
+     allocation->last_access = direct_clock_get_millis();
+
      return DFB_OK;
 }
 
@@ -1215,133 +1332,456 @@ dfb_surface_pool_enumerate ( CoreSurfacePool          *pool,
      return DFB_OK;
 }
 
-/**********************************************************************************************************************/
-
-static DFBResult
-init_pool( CoreDFB                *core,
-           CoreSurfacePool        *pool,
-           const SurfacePoolFuncs *funcs,
-           void                   *ctx )
+static void
+recycle_remove( CoreSurfacePoolRecycler *recycler,
+                int                      index )
 {
-     DFBResult ret;
+     recycler->bytes -= recycler->slots[index].size;
+     recycler->num--;
 
-     D_MAGIC_ASSERT( pool, CoreSurfacePool );
-     D_ASSERT( funcs != NULL );
-     D_ASSERT( funcs->InitPool != NULL );
+     memmove( &recycler->slots[index], &recycler->slots[index+1],
+              (recycler->num - index) * sizeof(CoreSurfacePoolRecycleSlot) );
+}
 
-     D_DEBUG_AT( Core_SurfacePool, "%s( %p, %p )\n", __FUNCTION__, pool, funcs );
+void *
+dfb_surface_pool_recycle_get( CoreSurfacePoolRecycler    *recycler,
+                              int                         size,
+                              unsigned int                align,
+                              CoreSurfacePoolRecycleFree  free_func,
+                              void                       *ctx )
+{
+     int   i;
+     void *addr;
 
-     if (funcs->PoolDataSize)
-          pool->pool_data_size = funcs->PoolDataSize();
+     D_ASSERT( recycler != NULL );
+     D_ASSERT( free_func != NULL );
 
-     if (funcs->PoolLocalDataSize)
-          pool->pool_local_data_size = funcs->PoolLocalDataSize();
+     if (!recycler->num)
+          return NULL;
 
-     if (funcs->AllocationDataSize)
-          pool->alloc_data_size = funcs->AllocationDataSize();
+     dfb_surface_pool_recycle_trim( recycler, false, free_func, ctx );
 
-     /* Allocate shared pool data. */
-     if (pool->pool_data_size) {
-          pool->data = SHCALLOC( pool->shmpool, 1, pool->pool_data_size );
-          if (!pool->data)
-               return D_OOSHM();
-     }
+     /* Take the most recently released buffer, its pages are most likely still resident. */
+     for (i = recycler->num - 1; i >= 0; i--) {
+          if (recycler->slots[i].size == size && recycler->slots[i].align == align) {
+               addr = recycler->slots[i].addr;
 
-     /* Allocate local pool data. */
-     if (pool->pool_local_data_size && !(pool_locals[pool->pool_id] = D_CALLOC( 1, pool->pool_local_data_size ))) {
-          SHFREE( pool->shmpool, pool->data );
-          return D_OOM();
-     }
+               recycle_remove( recycler, i );
 
-     fusion_vector_init( &pool->allocs, 4, pool->shmpool );
+               recycler->hits++;
 
-     ret = funcs->InitPool( core, pool, pool->data, get_local(pool), ctx, &pool->desc );
-     if (ret) {
-          D_DERROR( ret, "Core/SurfacePool: Initializing '%s' failed!\n", pool->desc.name );
+               D_DEBUG_AT( Core_SurfacePool, "%s( %d, %u ) -> %p\n", __FUNCTION__, size, align, addr );
 
-          if (pool_locals[pool->pool_id]) {
-               D_FREE( pool_locals[pool->pool_id] );
-               pool_locals[pool->pool_id] = NULL;
+               return addr;
           }
-          if (pool->data) {
-               SHFREE( pool->shmpool, pool->data );
-               pool->data = NULL;
-          }
-          return ret;
      }
 
-     pool->desc.caps &= ~(CSPCAPS_READ | CSPCAPS_WRITE);
-
-     if (funcs->Read)
-          pool->desc.caps |= CSPCAPS_READ;
-
-     if (funcs->Write)
-          pool->desc.caps |= CSPCAPS_WRITE;
-
-     fusion_skirmish_init2( &pool->lock, pool->desc.name, dfb_core_world( core ), fusion_config->secure_fusion );
+     recycler->misses++;
 
-     return DFB_OK;
+     return NULL;
 }
 
-static void
-insert_pool_local( CoreSurfacePool *pool )
+bool
+dfb_surface_pool_recycle_put( CoreSurfacePoolRecycler    *recycler,
+                              void                       *addr,
+                              int                         size,
+                              unsigned int                align,
+                              CoreSurfacePoolRecycleFree  free_func,
+                              void                       *ctx )
 {
-     int i, n;
+     unsigned long long max_bytes = (unsigned long long) dfb_config->surface_recycle_size * 1024;
 
-     for (i = 0; i < pool_count - 1; i++) {
-          D_ASSERT( pool_order[i] >= 0 );
-          D_ASSERT( pool_order[i] < pool_count - 1 );
+     D_ASSERT( recycler != NULL );
+     D_ASSERT( addr != NULL );
+     D_ASSERT( free_func != NULL );
 
-          D_MAGIC_ASSERT( pool_array[pool_order[i]], CoreSurfacePool );
+     if (size > max_bytes)
+          return false;
 
-          if (pool_array[pool_order[i]]->desc.priority < pool->desc.priority)
-               break;
-     }
+     D_DEBUG_AT( Core_SurfacePool, "%s( %p, %d, %u )\n", __FUNCTION__, addr, size, align );
 
-     for (n = pool_count - 1; n > i; n--) {
-          D_ASSERT( pool_order[n-1] >= 0 );
-          D_ASSERT( pool_order[n-1] < pool_count - 1 );
+     dfb_surface_pool_recycle_trim( recycler, false, free_func, ctx );
 
-          D_MAGIC_ASSERT( pool_array[pool_order[n-1]], CoreSurfacePool );
+     /* Free the least recently released buffers to make room. */
+     while (recycler->num == CORE_SURFACE_POOL_RECYCLE_SLOTS || recycler->bytes + size > max_bytes) {
+          free_func( recycler->slots[0].addr, recycler->slots[0].align, ctx );
 
-          pool_order[n] = pool_order[n-1];
+          recycle_remove( recycler, 0 );
      }
 
-     pool_order[n] = pool_count - 1;
+     recycler->slots[recycler->num].addr  = addr;
+     recycler->slots[recycler->num].size  = size;
+     recycler->slots[recycler->num].align = align;
+     recycler->slots[recycler->num].stamp = direct_clock_get_millis();
 
-     for (i = 0; i < pool_count; i++) {
-          D_DEBUG_AT( Core_SurfacePool, "  %c> [%d] %p - '%s' [%u] (%u), %p\n",
-                      (i == n) ? '=' : '-', i, pool_array[pool_order[i]], pool_array[pool_order[i]]->desc.name,
-                      pool_array[pool_order[i]]->pool_id, pool_array[pool_order[i]]->desc.priority,
-                      pool_funcs[pool_order[i]] );
+     recycler->bytes += size;
+     recycler->num++;
 
-          D_ASSERT( pool_order[i] == pool_array[pool_order[i]]->pool_id );
-     }
+     return true;
 }
 
-static void
-remove_pool_local( CoreSurfacePoolID pool_id )
+void
+dfb_surface_pool_recycle_trim( CoreSurfacePoolRecycler    *recycler,
+                               bool                        all,
+                               CoreSurfacePoolRecycleFree  free_func,
+                               void                       *ctx )
 {
-     int i;
+     long long limit = direct_clock_get_millis() - dfb_config->surface_recycle_idle;
 
-     /* Free local pool data. */
-     if (pool_locals[pool_id]) {
-          D_FREE( pool_locals[pool_id] );
-          pool_locals[pool_id] = NULL;
-     }
+     D_ASSERT( recycler != NULL );
+     D_ASSERT( free_func != NULL );
 
-     /* Erase entries of the pool. */
-     pool_array[pool_id] = NULL;
-     pool_funcs[pool_id] = NULL;
+     /* Slots are ordered by time of release. */
+     while (recycler->num && (all || recycler->slots[0].stamp < limit)) {
+          D_DEBUG_AT( Core_SurfacePool, "%s() <- freeing %p (%d bytes)\n", __FUNCTION__,
+                      recycler->slots[0].addr, recycler->slots[0].size );
 
-     while (pool_count > 0 && !pool_array[pool_count-1]) {
-          pool_count--;
+          free_func( recycler->slots[0].addr, recycler->slots[0].align, ctx );
 
-          for (i = 0; i < pool_count; i++) {
-               if (pool_order[i] == pool_count) {
-                    direct_memmove( &pool_order[i], &pool_order[i+1], sizeof(pool_order[0]) * (pool_count - i) );
-                    break;
-               }
+          recycle_remove( recycler, 0 );
+     }
+}
+
+DFBResult
+dfb_surface_pool_park_idle( CoreSurfacePool *pool,
+                            long long        idle )
+{
+     int                     i;
+     long long               now;
+     CoreSurfaceAllocation  *allocation;
+     const SurfacePoolFuncs *funcs;
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+
+     D_DEBUG_AT( Core_SurfacePool, "%s( %p [%u - %s], %lld )\n", __FUNCTION__,
+                 pool, pool->pool_id, pool->desc.name, idle );
+
+     funcs = get_funcs( pool );
+
+     if (!funcs->Park || !funcs->Unpark)
+          return DFB_UNSUPPORTED;
+
+     if (fusion_skirmish_prevail( &pool->lock ))
+          return DFB_FUSION;
+
+     now = direct_clock_get_millis();
+
+     fusion_vector_foreach (allocation, i, pool->allocs) {
+          DFBResult    ret;
+          int          size;
+          CoreSurface *surface;
+
+          CORE_SURFACE_ALLOCATION_ASSERT( allocation );
+
+          if (allocation->flags & (CSALF_INITIALIZING | CSALF_PREALLOCATED | CSALF_PARKED | CSALF_MUCKOUT))
+               continue;
+
+          if (now - allocation->last_access < idle || dfb_surface_allocation_locks( allocation ))
+               continue;
+
+          D_MAGIC_ASSERT( allocation->buffer, CoreSurfaceBuffer );
+
+          surface = allocation->buffer->surface;
+
+          D_MAGIC_ASSERT( surface, CoreSurface );
+
+          /* Surfaces in use are skipped, locking the allocation requires the surface lock. */
+          if (dfb_surface_trylock( surface ))
+               continue;
+
+          if (!dfb_surface_allocation_locks( allocation )) {
+               ret = funcs->Park( pool, pool->data, get_local(pool), allocation, allocation->data, &size );
+               if (ret == DFB_OK) {
+                    D_DEBUG_AT( Core_SurfacePool, "  -> parked %p %5dk in %5dk\n",
+                                allocation, allocation->size / 1024, size / 1024 );
+
+                    allocation->flags       |= CSALF_PARKED;
+                    allocation->packed_size  = size;
+
+                    pool->park_stats.parked++;
+                    pool->park_stats.parked_bytes += allocation->size;
+                    pool->park_stats.packed_bytes += size;
+                    pool->park_stats.parks++;
+               }
+               else {
+                    /* Don't retry to compress the buffer before it has been idle once more. */
+                    allocation->last_access = now;
+               }
+          }
+
+          dfb_surface_unlock( surface );
+     }
+
+     fusion_skirmish_dismiss( &pool->lock );
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_surface_pool_park_stats( CoreSurfacePool          *pool,
+                             CoreSurfacePoolParkStats *ret_stats )
+{
+     const SurfacePoolFuncs *funcs;
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_ASSERT( ret_stats != NULL );
+
+     funcs = get_funcs( pool );
+
+     if (!funcs->Park || !funcs->Unpark)
+          return DFB_UNSUPPORTED;
+
+     if (fusion_skirmish_prevail( &pool->lock ))
+          return DFB_FUSION;
+
+     *ret_stats = pool->park_stats;
+
+     fusion_skirmish_dismiss( &pool->lock );
+
+     return DFB_OK;
+}
+
+/*
+ * Each token is a 32 bit word, with the highest bit set it's followed by one word repeated by the count in the lower
+ * bits, otherwise it's followed by the count of literal words. Runs shorter than three words are kept literal.
+ */
+#define PACK_RUN 0x80000000
+
+int
+dfb_surface_pool_pack( const void *src,
+                       int         size,
+                       void       *dst,
+                       int         max )
+{
+     const u32 *s       = src;
+     const u32 *end     = s + size / 4;
+     u32       *d       = dst;
+     u32       *limit   = d + max / 4;
+     u32       *literal = NULL;
+
+     D_ASSERT( src != NULL );
+     D_ASSERT( dst != NULL );
+
+     if (size & 3)
+          return 0;
+
+     while (s < end) {
+          const u32 *r = s + 1;
+          int        n;
+
+          while (r < end && *r == *s)
+               r++;
+
+          n = r - s;
+
+          if (n >= 3) {
+               if (limit - d < 2)
+                    return 0;
+
+               d[0] = PACK_RUN | n;
+               d[1] = *s;
+
+               d += 2;
+               s  = r;
+
+               literal = NULL;
+          }
+          else {
+               if (!literal) {
+                    if (limit - d < 1)
+                         return 0;
+
+                    literal  = d++;
+                    *literal = 0;
+               }
+
+               if (limit - d < n)
+                    return 0;
+
+               *literal += n;
+
+               while (n--)
+                    *d++ = *s++;
+          }
+     }
+
+     return (d - (u32*) dst) * 4;
+}
+
+void
+dfb_surface_pool_unpack( const void *src,
+                         int         length,
+                         void       *dst,
+                         int         size )
+{
+     const u32 *s   = src;
+     const u32 *end = s + length / 4;
+     u32       *d   = dst;
+
+     D_ASSERT( src != NULL );
+     D_ASSERT( dst != NULL );
+
+     D_UNUSED_P( size );
+
+     while (s < end) {
+          u32 token = *s++;
+          u32 n     = token & ~PACK_RUN;
+
+          D_ASSERT( d + n <= (u32*) dst + size / 4 );
+
+          if (token & PACK_RUN) {
+               u32 value = *s++;
+
+               while (n--)
+                    *d++ = value;
+          }
+          else {
+               direct_memcpy( d, s, n * 4 );
+
+               d += n;
+               s += n;
+          }
+     }
+}
+
+/**********************************************************************************************************************/
+
+static DFBResult
+init_pool( CoreDFB                *core,
+           CoreSurfacePool        *pool,
+           const SurfacePoolFuncs *funcs,
+           void                   *ctx )
+{
+     DFBResult ret;
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_ASSERT( funcs != NULL );
+     D_ASSERT( funcs->InitPool != NULL );
+
+     D_DEBUG_AT( Core_SurfacePool, "%s( %p, %p )\n", __FUNCTION__, pool, funcs );
+
+     if (funcs->PoolDataSize)
+          pool->pool_data_size = funcs->PoolDataSize();
+
+     if (funcs->PoolLocalDataSize)
+          pool->pool_local_data_size = funcs->PoolLocalDataSize();
+
+     if (funcs->AllocationDataSize)
+          pool->alloc_data_size = funcs->AllocationDataSize();
+
+     /* Allocate shared pool data. */
+     if (pool->pool_data_size) {
+          pool->data = SHCALLOC( pool->shmpool, 1, pool->pool_data_size );
+          if (!pool->data)
+               return D_OOSHM();
+     }
+
+     /* Allocate local pool data. */
+     if (pool->pool_local_data_size && !(pool_locals[pool->pool_id] = D_CALLOC( 1, pool->pool_local_data_size ))) {
+          SHFREE( pool->shmpool, pool->data );
+          return D_OOM();
+     }
+
+     fusion_vector_init( &pool->allocs, 4, pool->shmpool );
+     fusion_vector_init( &pool->usages, 2, pool->shmpool );
+
+     ret = funcs->InitPool( core, pool, pool->data, get_local(pool), ctx, &pool->desc );
+     if (ret) {
+          D_DERROR( ret, "Core/SurfacePool: Initializing '%s' failed!\n", pool->desc.name );
+
+          if (pool_locals[pool->pool_id]) {
+               D_FREE( pool_locals[pool->pool_id] );
+               pool_locals[pool->pool_id] = NULL;
+          }
+          if (pool->data) {
+               SHFREE( pool->shmpool, pool->data );
+               pool->data = NULL;
+          }
+          return ret;
+     }
+
+     pool->desc.caps &= ~(CSPCAPS_READ | CSPCAPS_WRITE);
+
+     if (funcs->Read)
+          pool->desc.caps |= CSPCAPS_READ;
+
+     if (funcs->Write)
+          pool->desc.caps |= CSPCAPS_WRITE;
+
+     fusion_skirmish_init2( &pool->lock, pool->desc.name, dfb_core_world( core ), fusion_config->secure_fusion );
+
+     return DFB_OK;
+}
+
+static void
+insert_pool_local( CoreSurfacePool *pool )
+{
+     int i, n;
+
+     /* Invalidate negotiation results. */
+     direct_mutex_lock( &negotiation_lock );
+     negotiation_generation++;
+     direct_mutex_unlock( &negotiation_lock );
+
+     for (i = 0; i < pool_count - 1; i++) {
+          D_ASSERT( pool_order[i] >= 0 );
+          D_ASSERT( pool_order[i] < pool_count - 1 );
+
+          D_MAGIC_ASSERT( pool_array[pool_order[i]], CoreSurfacePool );
+
+          if (pool_array[pool_order[i]]->desc.priority < pool->desc.priority)
+               break;
+     }
+
+     for (n = pool_count - 1; n > i; n--) {
+          D_ASSERT( pool_order[n-1] >= 0 );
+          D_ASSERT( pool_order[n-1] < pool_count - 1 );
+
+          D_MAGIC_ASSERT( pool_array[pool_order[n-1]], CoreSurfacePool );
+
+          pool_order[n] = pool_order[n-1];
+     }
+
+     pool_order[n] = pool_count - 1;
+
+     for (i = 0; i < pool_count; i++) {
+          D_DEBUG_AT( Core_SurfacePool, "  %c> [%d] %p - '%s' [%u] (%u), %p\n",
+                      (i == n) ? '=' : '-', i, pool_array[pool_order[i]], pool_array[pool_order[i]]->desc.name,
+                      pool_array[pool_order[i]]->pool_id, pool_array[pool_order[i]]->desc.priority,
+                      pool_funcs[pool_order[i]] );
+
+          D_ASSERT( pool_order[i] == pool_array[pool_order[i]]->pool_id );
+     }
+}
+
+static void
+remove_pool_local( CoreSurfacePoolID pool_id )
+{
+     int i;
+
+     /* Invalidate negotiation results. */
+     direct_mutex_lock( &negotiation_lock );
+     negotiation_generation++;
+     direct_mutex_unlock( &negotiation_lock );
+
+     /* Free local pool data. */
+     if (pool_locals[pool_id]) {
+          D_FREE( pool_locals[pool_id] );
+          pool_locals[pool_id] = NULL;
+     }
+
+     /* Erase entries of the pool. */
+     pool_array[pool_id] = NULL;
+     pool_funcs[pool_id] = NULL;
+
+     while (pool_count > 0 && !pool_array[pool_count-1]) {
+          pool_count--;
+
+          for (i = 0; i < pool_count; i++) {
+               if (pool_order[i] == pool_count) {
+                    direct_memmove( &pool_order[i], &pool_order[i+1], sizeof(pool_order[0]) * (pool_count - i) );
+                    break;
+               }
           }
      }
 }
@@ -1452,3 +1892,492 @@ backup_allocation( CoreSurfaceAllocation *allocation_in )
 
      return ret;
 }
+
+/*
+ * Back up and deallocate the allocations flagged for muck out, the pool lock must be held.
+ */
+static DFBResult
+muck_out_flagged( CoreSurfacePool *pool )
+{
+     DFBResult              ret, ret_lock = DFB_OK;
+     int                    i, retries = 3;
+     CoreSurfaceAllocation *allocation;
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+
+     FUSION_SKIRMISH_ASSERT( &pool->lock );
+
+retry:
+     fusion_vector_foreach (allocation, i, pool->allocs) {
+          CORE_SURFACE_ALLOCATION_ASSERT( allocation );
+
+          if (allocation->flags & CSALF_MUCKOUT) {
+               CoreSurface       *alloc_surface;
+               CoreSurfaceBuffer *alloc_buffer;
+
+               alloc_buffer = allocation->buffer;
+
+               D_MAGIC_ASSERT( alloc_buffer, CoreSurfaceBuffer );
+
+               alloc_surface = alloc_buffer->surface;
+
+               D_MAGIC_ASSERT( alloc_surface, CoreSurface );
+
+               D_DEBUG_AT( Core_SurfacePool, "  <= %p %5dk, %lu\n",
+                           allocation, allocation->size / 1024, allocation->offset );
+
+               ret = dfb_surface_trylock( alloc_surface );
+               if (ret) {
+                    D_WARN( "could not lock surface (%s)", DirectFBErrorString( ret ) );
+                    ret_lock = ret;
+                    continue;
+               }
+
+               /* Ensure mucked out allocation is backed up to another pool. */
+               ret = backup_allocation( allocation );
+               if (ret) {
+                    D_WARN( "could not backup allocation (%s)", DirectFBErrorString( ret ) );
+                    dfb_surface_unlock( alloc_surface );
+                    goto error;
+               }
+
+               /* Deallocate mucked out allocation. */
+               dfb_surface_allocation_decouple( allocation );
+               i--;
+
+               dfb_surface_unlock( alloc_surface );
+          }
+     }
+
+     if (ret_lock) {
+          if (retries--)
+               goto retry;
+
+          ret = DFB_LOCKED;
+
+          goto error;
+     }
+
+     return DFB_OK;
+
+error:
+     fusion_vector_foreach (allocation, i, pool->allocs) {
+          CORE_SURFACE_ALLOCATION_ASSERT( allocation );
+
+          if (allocation->flags & CSALF_MUCKOUT)
+               allocation->flags &= ~CSALF_MUCKOUT;
+     }
+
+     return ret;
+}
+
+/*
+ * Flag the least recently used allocations for muck out until they cover the size of the new buffer, for pools
+ * without an integrated method. Locked allocations and those of buffers with a stronger policy are not touched.
+ */
+static DFBResult
+flag_lru_victims( CoreSurfacePool   *pool,
+                  CoreSurfaceBuffer *buffer )
+{
+     int                    i;
+     int                    size;
+     int                    flagged = 0;
+     CoreSurfaceAllocation *allocation;
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+     D_MAGIC_ASSERT( buffer->surface, CoreSurface );
+
+     dfb_surface_calc_buffer_size( buffer->surface, 8, 0, NULL, &size );
+
+     D_DEBUG_AT( Core_SurfacePool, "%s( %p ) <- %d required\n", __FUNCTION__, buffer, size );
+
+     while (flagged < size) {
+          CoreSurfaceAllocation *lru = NULL;
+
+          fusion_vector_foreach (allocation, i, pool->allocs) {
+               CORE_SURFACE_ALLOCATION_ASSERT( allocation );
+               D_MAGIC_ASSERT( allocation->buffer, CoreSurfaceBuffer );
+
+               if (allocation->flags & CSALF_MUCKOUT)
+                    continue;
+
+               if (allocation->buffer->policy > buffer->policy || allocation->buffer->policy == CSP_VIDEOONLY)
+                    continue;
+
+               if (dfb_surface_allocation_locks( allocation ))
+                    continue;
+
+               if (!lru || lru->last_access > allocation->last_access)
+                    lru = allocation;
+          }
+
+          if (!lru)
+               break;
+
+          D_DEBUG_AT( Core_SurfacePool, "  -> %p %5dk, accessed %lld ms ago\n",
+                      lru, lru->size / 1024, direct_clock_get_millis() - lru->last_access );
+
+          lru->flags |= CSALF_MUCKOUT;
+
+          flagged += lru->size;
+     }
+
+     if (flagged < size) {
+          fusion_vector_foreach (allocation, i, pool->allocs) {
+               if (allocation->flags & CSALF_MUCKOUT)
+                    allocation->flags &= ~CSALF_MUCKOUT;
+          }
+
+          return DFB_NOVIDEOMEMORY;
+     }
+
+     return DFB_OK;
+}
+
+static DFBResult
+unpark_allocation( CoreSurfacePool       *pool,
+                   CoreSurfaceAllocation *allocation )
+{
+     DFBResult               ret = DFB_OK;
+     long long               micros;
+     const SurfacePoolFuncs *funcs;
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     CORE_SURFACE_ALLOCATION_ASSERT( allocation );
+
+     funcs = get_funcs( pool );
+
+     D_ASSERT( funcs->Unpark != NULL );
+
+     if (fusion_skirmish_prevail( &pool->lock ))
+          return DFB_FUSION;
+
+     if (allocation->flags & CSALF_PARKED) {
+          micros = direct_clock_get_micros();
+
+          ret = funcs->Unpark( pool, pool->data, get_local(pool), allocation, allocation->data );
+          if (ret) {
+               D_DERROR( ret, "Core/SurfacePool: Could not unpark allocation!\n" );
+          }
+          else {
+               micros = direct_clock_get_micros() - micros;
+
+               D_DEBUG_AT( Core_SurfacePool, "%s( %p ) <- restored %5dk in %lld us\n", __FUNCTION__,
+                           allocation, allocation->size / 1024, micros );
+
+               allocation->flags &= ~CSALF_PARKED;
+
+               pool->park_stats.parked--;
+               pool->park_stats.parked_bytes -= allocation->size;
+               pool->park_stats.packed_bytes -= allocation->packed_size;
+               pool->park_stats.unparks++;
+               pool->park_stats.unpark_micros += micros;
+
+               if (pool->park_stats.unpark_max_micros < micros)
+                    pool->park_stats.unpark_max_micros = micros;
+
+               allocation->packed_size = 0;
+          }
+     }
+
+     fusion_skirmish_dismiss( &pool->lock );
+
+     return ret;
+}
+
+DFBResult
+dfb_surface_pool_get_usage( CoreSurfacePool      *pool,
+                            FusionID              identity,
+                            CoreSurfacePoolUsage *ret_usage )
+{
+     int                   i;
+     CoreSurfacePoolUsage *usage;
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_ASSERT( ret_usage != NULL );
+
+     if (fusion_skirmish_prevail( &pool->lock ))
+          return DFB_FUSION;
+
+     if (identity) {
+          memset( ret_usage, 0, sizeof(CoreSurfacePoolUsage) );
+
+          ret_usage->identity = identity;
+
+          fusion_vector_foreach (usage, i, pool->usages) {
+               if (usage->identity == identity) {
+                    *ret_usage = *usage;
+                    break;
+               }
+          }
+     }
+     else
+          *ret_usage = pool->usage;
+
+     fusion_skirmish_dismiss( &pool->lock );
+
+     return DFB_OK;
+}
+
+static __inline__ DFBSurfaceMemoryType
+usage_type( CoreSurfaceTypeFlags type )
+{
+     if (type & CSTF_LAYER)
+          return DSMT_LAYER;
+
+     if (type & CSTF_WINDOW)
+          return DSMT_WINDOW;
+
+     if (type & CSTF_CURSOR)
+          return DSMT_CURSOR;
+
+     if (type & CSTF_FONT)
+          return DSMT_FONT;
+
+     return DSMT_OTHER;
+}
+
+static __inline__ unsigned int
+usage_count( const CoreSurfacePoolUsage *usage,
+             DFBSurfaceMemoryAmount     *ret_total )
+{
+     int n;
+
+     ret_total->allocations = 0;
+     ret_total->bytes       = 0;
+
+     for (n = 0; n < DSMT_NUM; n++) {
+          ret_total->allocations += usage->amounts[n].allocations;
+          ret_total->bytes       += usage->amounts[n].bytes;
+     }
+
+     return ret_total->allocations;
+}
+
+static void
+account_usage( CoreSurfacePool       *pool,
+               CoreSurfaceAllocation *allocation,
+               bool                   add )
+{
+     int                   i;
+     CoreSurfacePoolUsage *usage;
+     CoreSurfacePoolUsage *found = NULL;
+     DFBSurfaceMemoryType  type  = usage_type( allocation->type );
+     int                   sign  = add ? 1 : -1;
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     CORE_SURFACE_ALLOCATION_ASSERT( allocation );
+
+     FUSION_SKIRMISH_ASSERT( &pool->lock );
+
+     if (add)
+          allocation->identity = allocation->surface ? allocation->surface->object.identity : 0;
+
+     pool->usage.amounts[type].allocations += sign;
+     pool->usage.amounts[type].bytes       += sign * (long long) allocation->size;
+
+     if (!allocation->identity)
+          return;
+
+     fusion_vector_foreach (usage, i, pool->usages) {
+          if (usage->identity == allocation->identity) {
+               found = usage;
+               break;
+          }
+     }
+
+     if (!found) {
+          if (!add)
+               return;
+
+          found = SHCALLOC( pool->shmpool, 1, sizeof(CoreSurfacePoolUsage) );
+          if (!found) {
+               D_OOSHM();
+               return;
+          }
+
+          found->identity = allocation->identity;
+
+          if (fusion_vector_add( &pool->usages, found )) {
+               SHFREE( pool->shmpool, found );
+               return;
+          }
+     }
+
+     found->amounts[type].allocations += sign;
+     found->amounts[type].bytes       += sign * (long long) allocation->size;
+
+     /* Forget processes without surfaces in this pool. */
+     if (!add) {
+          DFBSurfaceMemoryAmount total;
+
+          if (!usage_count( found, &total )) {
+               fusion_vector_remove( &pool->usages, fusion_vector_index_of( &pool->usages, found ) );
+
+               SHFREE( pool->shmpool, found );
+          }
+     }
+}
+
+static void
+log_pool_usage( const char                 *name,
+                const CoreSurfacePoolUsage *usage )
+{
+     DFBSurfaceMemoryAmount total;
+     char                   owner[40] = "";
+
+     usage_count( usage, &total );
+
+     if (usage->identity)
+          snprintf( owner, sizeof(owner), " [identity %lu]", usage->identity );
+
+     D_INFO( "Core/SurfacePool: Stats: '%s'%s %u allocations, %llu kB "
+             "(layer %llu, window %llu, cursor %llu, font %llu, other %llu kB)\n", name, owner,
+             total.allocations, (unsigned long long) total.bytes / 1024,
+             (unsigned long long) usage->amounts[DSMT_LAYER].bytes / 1024,
+             (unsigned long long) usage->amounts[DSMT_WINDOW].bytes / 1024,
+             (unsigned long long) usage->amounts[DSMT_CURSOR].bytes / 1024,
+             (unsigned long long) usage->amounts[DSMT_FONT].bytes / 1024,
+             (unsigned long long) usage->amounts[DSMT_OTHER].bytes / 1024 );
+}
+
+void
+dfb_surface_pools_log_usage( void )
+{
+     int i, n;
+
+     for (i = 0; i < pool_count; i++) {
+          CoreSurfacePool      *pool = pool_array[i];
+          CoreSurfacePoolUsage *usage;
+
+          D_MAGIC_ASSERT( pool, CoreSurfacePool );
+
+          if (fusion_skirmish_prevail( &pool->lock ))
+               continue;
+
+          if (pool->allocs.count) {
+               log_pool_usage( pool->desc.name, &pool->usage );
+
+               fusion_vector_foreach (usage, n, pool->usages)
+                    log_pool_usage( pool->desc.name, usage );
+          }
+
+          fusion_skirmish_dismiss( &pool->lock );
+     }
+}
+
+/*
+ * Build the key of a negotiation, returns false if the result must not be cached.
+ */
+static bool
+negotiation_key( CoreSurfaceBuffer      *buffer,
+                 CoreSurfaceAccessorID   accessor,
+                 CoreSurfaceAccessFlags  access,
+                 NegotiationKey         *ret_key )
+{
+     CoreSurface *surface;
+
+     D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+     D_MAGIC_ASSERT( buffer->surface, CoreSurface );
+     D_ASSERT( ret_key != NULL );
+
+     surface = buffer->surface;
+
+     /* The tests of pools for preallocated and layer surfaces depend on more than the configuration. */
+     if ((surface->type & (CSTF_LAYER | CSTF_PREALLOCATED)) || (surface->config.flags & CSCONF_PREALLOCATED))
+          return false;
+
+     /* Clear padding for the comparison. */
+     memset( ret_key, 0, sizeof(NegotiationKey) );
+
+     ret_key->config   = surface->config;
+     ret_key->type     = required_type( buffer );
+     ret_key->accessor = accessor;
+     ret_key->access   = access;
+     ret_key->master   = Core_GetIdentity() == FUSION_ID_MASTER;
+
+     return true;
+}
+
+static __inline__ NegotiationEntry *
+negotiation_entry( const NegotiationKey *key )
+{
+     unsigned int hash;
+
+     hash = key->config.size.w * 31 + key->config.size.h;
+     hash = hash * 31 + key->config.format;
+     hash = hash * 31 + key->type;
+     hash = hash * 31 + key->accessor * 8 + key->access + key->master;
+
+     return &negotiation_cache[(hash ^ (hash >> 16)) % NEGOTIATION_CACHE_SIZE];
+}
+
+static bool
+lookup_negotiated( const NegotiationKey  *key,
+                   CoreSurfacePool      **ret_pools,
+                   unsigned int           max_pools,
+                   unsigned int          *ret_num,
+                   DFBResult             *ret_result )
+{
+     int               i;
+     NegotiationEntry *entry = negotiation_entry( key );
+
+     direct_mutex_lock( &negotiation_lock );
+
+     if (entry->generation != negotiation_generation || memcmp( &entry->key, key, sizeof(NegotiationKey) )) {
+          direct_mutex_unlock( &negotiation_lock );
+          return false;
+     }
+
+     for (i = 0; i < entry->num && i < max_pools; i++) {
+          ret_pools[i] = pool_array[entry->pools[i]];
+
+          D_MAGIC_ASSERT( ret_pools[i], CoreSurfacePool );
+     }
+
+     *ret_num    = i;
+     *ret_result = entry->result;
+
+     direct_mutex_unlock( &negotiation_lock );
+
+     return true;
+}
+
+static void
+store_negotiated( const NegotiationKey  *key,
+                  CoreSurfacePool      **pools,
+                  unsigned int           num,
+                  DFBResult              result )
+{
+     int               i;
+     NegotiationEntry *entry = negotiation_entry( key );
+
+     D_ASSERT( num <= MAX_SURFACE_POOLS );
+
+     direct_mutex_lock( &negotiation_lock );
+
+     direct_memcpy( &entry->key, key, sizeof(NegotiationKey) );
+
+     entry->generation = negotiation_generation;
+     entry->result     = result;
+     entry->num        = num;
+
+     for (i = 0; i < num; i++)
+          entry->pools[i] = pools[i]->pool_id;
+
+     direct_mutex_unlock( &negotiation_lock );
+}
+
+static void
+forget_negotiated( const NegotiationKey *key )
+{
+     NegotiationEntry *entry = negotiation_entry( key );
+
+     direct_mutex_lock( &negotiation_lock );
+
+     if (!memcmp( &entry->key, key, sizeof(NegotiationKey) ))
+          entry->generation = 0;
+
+     direct_mutex_unlock( &negotiation_lock );
+}
@@ -152,6 +152,29 @@ typedef struct {
                                       void                        *pool_local,
                                       CoreSurfaceBuffer           *buffer );
 
+     /*
+      * Flag idle allocations for muck out to defragment the pool, returns DFB_NOSUCHINSTANCE if there's nothing to do.
+      */
+     DFBResult (*Compact)           ( CoreSurfacePool             *pool,
+                                      void                        *pool_data,
+                                      void                        *pool_local );
+
+     /*
+      * Compress the buffer of an idle allocation into a smaller one and free the original, or restore it.
+      */
+     DFBResult (*Park)              ( CoreSurfacePool             *pool,
+                                      void                        *pool_data,
+                                      void                        *pool_local,
+                                      CoreSurfaceAllocation       *allocation,
+                                      void                        *alloc_data,
+                                      int                         *ret_size );
+
+     DFBResult (*Unpark)            ( CoreSurfacePool             *pool,
+                                      void                        *pool_data,
+                                      void                        *pool_local,
+                                      CoreSurfaceAllocation       *allocation,
+                                      void                        *alloc_data );
+
      /*
       * Manage interlocks.
       */
@@ -195,6 +218,28 @@ typedef struct {
                                       void                        *alloc_data );
 } SurfacePoolFuncs;
 
+/*
+ * Statistics of the allocations parked in compressed form, see 'surface-park-idle' option.
+ */
+typedef struct {
+     unsigned int                parked;            /* number of allocations being parked */
+     unsigned long long          parked_bytes;      /* their uncompressed size */
+     unsigned long long          packed_bytes;      /* their compressed size */
+
+     unsigned int                parks;             /* total number of allocations parked */
+     unsigned int                unparks;           /* total number of allocations restored */
+     long long                   unpark_micros;     /* total time spent restoring allocations */
+     long long                   unpark_max_micros; /* longest time spent restoring one allocation */
+} CoreSurfacePoolParkStats;
+
+/*
+ * Memory used by the allocations of a pool per kind of surface, in total or for the surfaces of one process.
+ */
+typedef struct {
+     FusionID                    identity;          /* creator of the surfaces, 0 for all */
+     DFBSurfaceMemoryAmount      amounts[DSMT_NUM];
+} CoreSurfacePoolUsage;
+
 struct __DFB_CoreSurfacePool {
      int                         magic;
 
@@ -215,8 +260,39 @@ struct __DFB_CoreSurfacePool {
      FusionSHMPoolShared        *shmpool;
 
      CoreSurfacePool            *backup;
+
+     CoreSurfacePoolParkStats    park_stats;
+
+     CoreSurfacePoolUsage        usage;
+     FusionVector                usages;            /* usage per creator of the surfaces */
 };
 
+/*
+ * Buffers released by a system memory pool, kept to serve allocations of the same size and alignment.
+ *
+ * The recycler is part of the pool data and used with the pool being locked.
+ */
+
+#define CORE_SURFACE_POOL_RECYCLE_SLOTS 32
+
+typedef struct {
+     void                       *addr;
+     int                         size;
+     unsigned int                align;    /* base alignment the buffer has been allocated with */
+     long long                   stamp;    /* time of release in milliseconds */
+} CoreSurfacePoolRecycleSlot;
+
+typedef struct {
+     CoreSurfacePoolRecycleSlot  slots[CORE_SURFACE_POOL_RECYCLE_SLOTS]; /* least recently released first */
+     int                         num;
+     unsigned long long          bytes;    /* total size of the buffers kept */
+
+     unsigned int                hits;
+     unsigned int                misses;
+} CoreSurfacePoolRecycler;
+
+typedef void (*CoreSurfacePoolRecycleFree)( void *addr, unsigned int align, void *ctx );
+
 /**********************************************************************************************************************/
 
 typedef DFBEnumerationResult (*CoreSurfacePoolCallback) ( CoreSurfacePool *pool, void *ctx );
@@ -263,6 +339,17 @@ DFBResult dfb_surface_pools_enumerate   ( CoreSurfacePoolCallback       callback
 DFBResult dfb_surface_pools_lookup      ( CoreSurfacePoolID             pool_id,
                                           CoreSurfacePool             **ret_pool );
 
+/*
+ * Sum up the memory used in all pools by the surfaces created by the given Fusion identity, or by all if it is 0.
+ */
+DFBResult dfb_surface_pools_get_usage   ( FusionID                      identity,
+                                          DFBSurfaceMemoryUsage        *ret_usage );
+
+/*
+ * Log the memory used in each pool, in total and per creator of the surfaces.
+ */
+void      dfb_surface_pools_log_usage   ( void );
+
 DFBResult dfb_surface_pools_allocate    ( CoreSurfaceBuffer            *buffer,
                                           CoreSurfaceAccessorID         accessor,
                                           CoreSurfaceAccessFlags        access,
@@ -291,6 +378,8 @@ DFBResult dfb_surface_pool_displace     ( CoreSurfacePool              *pool,
                                           CoreSurfaceBuffer            *buffer,
                                           CoreSurfaceAllocation       **ret_allocation );
 
+DFBResult dfb_surface_pool_compact      ( CoreSurfacePool              *pool );
+
 DFBResult dfb_surface_pool_prelock      ( CoreSurfacePool              *pool,
                                           CoreSurfaceAllocation        *allocation,
                                           CoreSurfaceAccessorID         accessor,
@@ -320,4 +409,60 @@ DFBResult dfb_surface_pool_enumerate    ( CoreSurfacePool              *pool,
                                           CoreSurfaceAllocCallback      callback,
                                           void                         *ctx );
 
+/*
+ * Park the allocations not locked within the given time in milliseconds.
+ */
+DFBResult dfb_surface_pool_park_idle    ( CoreSurfacePool              *pool,
+                                          long long                     idle );
+
+DFBResult dfb_surface_pool_park_stats   ( CoreSurfacePool              *pool,
+                                          CoreSurfacePoolParkStats     *ret_stats );
+
+/*
+ * Get the memory used by the surfaces created by the given Fusion identity, or by all surfaces if it is 0.
+ */
+DFBResult dfb_surface_pool_get_usage    ( CoreSurfacePool              *pool,
+                                          FusionID                      identity,
+                                          CoreSurfacePoolUsage         *ret_usage );
+
+/*
+ * Compress a buffer with a run length encoding of 32 bit words, returns the compressed size or 0 if it exceeds 'max'.
+ */
+int       dfb_surface_pool_pack         ( const void                   *src,
+                                          int                           size,
+                                          void                         *dst,
+                                          int                           max );
+
+void      dfb_surface_pool_unpack       ( const void                   *src,
+                                          int                           length,
+                                          void                         *dst,
+                                          int                           size );
+
+/*
+ * Take a kept buffer of the given size and base alignment, returns NULL if there's none.
+ */
+void     *dfb_surface_pool_recycle_get  ( CoreSurfacePoolRecycler      *recycler,
+                                          int                           size,
+                                          unsigned int                  align,
+                                          CoreSurfacePoolRecycleFree    free_func,
+                                          void                         *ctx );
+
+/*
+ * Keep a released buffer, returns false if the buffer has to be freed by the caller.
+ */
+bool      dfb_surface_pool_recycle_put  ( CoreSurfacePoolRecycler      *recycler,
+                                          void                         *addr,
+                                          int                           size,
+                                          unsigned int                  align,
+                                          CoreSurfacePoolRecycleFree    free_func,
+                                          void                         *ctx );
+
+/*
+ * Free the buffers kept longer than the configured idle time, or all of them.
+ */
+void      dfb_surface_pool_recycle_trim ( CoreSurfacePoolRecycler      *recycler,
+                                          bool                          all,
+                                          CoreSurfacePoolRecycleFree    free_func,
+                                          void                         *ctx );
+
 #endif
@@ -23,6 +23,7 @@
 #include <core/input.h>
 #include <core/layers.h>
 #include <core/layer_context.h>
+#include <core/screen.h>
 #include <core/windows.h>
 #include <core/windowstack.h>
 #include <core/wm.h>
@@ -49,6 +50,14 @@ typedef struct {
 static DirectLink  *stack_containers      = NULL;
 static DirectMutex  stack_containers_lock = DIRECT_MUTEX_INITIALIZER();
 
+/* Time between a frame and the resampled position, to have samples around it in most cases. */
+#define RESAMPLE_LATENCY        5000
+
+/* Maximum time to predict a position beyond the last sample. */
+#define RESAMPLE_MAX_PREDICTION 8000
+
+static void *WindowStack_Resample_Thread( DirectThread *thread, void *arg );
+
 static void
 stack_containers_add( CoreWindowStack *stack )
 {
@@ -250,6 +259,23 @@ dfb_windowstack_create( CoreLayerContext *context )
 
      stack_containers_add( stack );
 
+     /* Start the frame clock for resampling of absolute pointer motion. */
+     if (dfb_config->input_resample) {
+          dfb_screen_get_frame_interval( layer->screen, &stack->resample.interval );
+
+          if (stack->resample.interval > 0) {
+               direct_mutex_init( &stack->resample.lock );
+               direct_waitqueue_init( &stack->resample.cond );
+
+               stack->resample.thread = direct_thread_create( DTT_INPUT, WindowStack_Resample_Thread, stack,
+                                                              "Input Resample" );
+               if (!stack->resample.thread) {
+                    direct_waitqueue_deinit( &stack->resample.cond );
+                    direct_mutex_deinit( &stack->resample.lock );
+               }
+          }
+     }
+
      CoreWindowStack_Init_Dispatch( layer->core, stack, &stack->call );
 
      D_DEBUG_AT( Core_WindowStack, "  -> %p\n", stack );
@@ -280,6 +306,25 @@ dfb_windowstack_detach_devices( CoreWindowStack *stack )
 
           link = next;
      }
+
+     /* Stop the frame clock, no more input events will arrive. */
+     if (stack->resample.thread) {
+          direct_mutex_lock( &stack->resample.lock );
+
+          stack->resample.quit = true;
+
+          direct_waitqueue_broadcast( &stack->resample.cond );
+
+          direct_mutex_unlock( &stack->resample.lock );
+
+          direct_thread_join( stack->resample.thread );
+          direct_thread_destroy( stack->resample.thread );
+
+          stack->resample.thread = NULL;
+
+          direct_waitqueue_deinit( &stack->resample.cond );
+          direct_mutex_deinit( &stack->resample.lock );
+     }
 }
 
 void
@@ -1027,6 +1072,238 @@ WindowStack_Input_Add( CoreWindowStack     *stack,
      }
 }
 
+/*
+ * Resampling of absolute pointer motion: positions are collected per axis and delivered once per frame by the frame
+ * clock thread, interpolated between the samples around the frame time or lightly predicted beyond the last sample.
+ */
+
+static int
+WindowStack_Resample_Value( const CoreWindowStackResampleAxis *axis,
+                            long long                          time )
+{
+     long long delta;
+     long long limit;
+     int       value;
+
+     if (axis->num < 2)
+          return axis->value[1];
+
+     delta = axis->ts[1] - axis->ts[0];
+     limit = axis->ts[1] + MIN( delta / 2, RESAMPLE_MAX_PREDICTION );
+
+     if (time > limit)
+          time = limit;
+     else if (time < axis->ts[0])
+          time = axis->ts[0];
+
+     value = axis->value[0] + (axis->value[1] - axis->value[0]) * (time - axis->ts[0]) / delta;
+
+     if (axis->event.flags & DIEF_MIN && value < axis->event.min)
+          value = axis->event.min;
+
+     if (axis->event.flags & DIEF_MAX && value > axis->event.max)
+          value = axis->event.max;
+
+     return value;
+}
+
+static void
+WindowStack_Resample_Deliver( CoreWindowStack *stack,
+                              bool             deliver_x,
+                              bool             deliver_y )
+{
+     int num = 0;
+
+     if (!deliver_x && !deliver_y)
+          return;
+
+     /* Don't deliver to a layer context being destroyed, and keep it while delivering from the frame clock thread. */
+     if (dfb_layer_context_ref_stat( stack->context, &num ) || num == 0)
+          return;
+
+     /* Increase the layer context's reference count. */
+     if (dfb_layer_context_ref( stack->context ))
+          return;
+
+     /* Lock the window stack. */
+     if (dfb_windowstack_lock( stack )) {
+          dfb_layer_context_unref( stack->context );
+          return;
+     }
+
+     /* Call the window manager to dispatch the events. */
+     if (dfb_layer_context_active( stack->context )) {
+          stack->resample.x.event.flags &= ~DIEF_FOLLOW;
+
+          if (deliver_x && deliver_y)
+               stack->resample.x.event.flags |= DIEF_FOLLOW;
+
+          if (deliver_x)
+               dfb_wm_process_input( stack, &stack->resample.x.event );
+
+          if (deliver_y)
+               dfb_wm_process_input( stack, &stack->resample.y.event );
+     }
+
+     /* Unlock the window stack. */
+     dfb_windowstack_unlock( stack );
+
+     /* Decrease the layer context's reference count. */
+     dfb_layer_context_unref( stack->context );
+}
+
+static bool
+WindowStack_Resample_Settle( CoreWindowStackResampleAxis *axis )
+{
+     bool deliver = axis->pending || axis->settle;
+
+     axis->event.axisabs = axis->value[1];
+
+     axis->pending = false;
+     axis->settle  = false;
+
+     return deliver;
+}
+
+static bool
+WindowStack_Resample_Frame( CoreWindowStackResampleAxis *axis,
+                            long long                    time )
+{
+     if (axis->pending) {
+          axis->event.axisabs = WindowStack_Resample_Value( axis, time );
+
+          axis->pending = false;
+          axis->settle  = axis->event.axisabs != axis->value[1];
+
+          return true;
+     }
+
+     /* Deliver the last position once motion has stopped. */
+     if (axis->settle)
+          return WindowStack_Resample_Settle( axis );
+
+     return false;
+}
+
+static bool
+WindowStack_Resample_Idle( const CoreWindowStack *stack )
+{
+     return !stack->resample.x.pending && !stack->resample.x.settle &&
+            !stack->resample.y.pending && !stack->resample.y.settle;
+}
+
+static void *
+WindowStack_Resample_Thread( DirectThread *thread,
+                             void         *arg )
+{
+     CoreWindowStack *stack    = arg;
+     long long        interval = stack->resample.interval;
+
+     D_DEBUG_AT( Core_WindowStack, "%s( %p ) <- interval %lld\n", __FUNCTION__, stack, interval );
+
+     direct_mutex_lock( &stack->resample.lock );
+
+     while (!stack->resample.quit) {
+          long long now, frame;
+          bool      deliver_x, deliver_y;
+
+          /* Sleep until a position is stored, the frame clock only ticks while motion is pending. */
+          while (!stack->resample.quit && WindowStack_Resample_Idle( stack ))
+               direct_waitqueue_wait( &stack->resample.cond, &stack->resample.lock );
+
+          now   = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC );
+          frame = (now / interval + 1) * interval;
+
+          while (!stack->resample.quit && now < frame) {
+               direct_waitqueue_wait_timeout( &stack->resample.cond, &stack->resample.lock, frame - now );
+
+               now = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC );
+          }
+
+          if (stack->resample.quit)
+               break;
+
+          deliver_x = WindowStack_Resample_Frame( &stack->resample.x, frame - RESAMPLE_LATENCY );
+          deliver_y = WindowStack_Resample_Frame( &stack->resample.y, frame - RESAMPLE_LATENCY );
+
+          WindowStack_Resample_Deliver( stack, deliver_x, deliver_y );
+     }
+
+     direct_mutex_unlock( &stack->resample.lock );
+
+     return NULL;
+}
+
+/*
+ * Deliver pending positions without resampling to keep the order with other events.
+ */
+static void
+WindowStack_Resample_Flush( CoreWindowStack *stack )
+{
+     bool deliver_x, deliver_y;
+
+     if (!stack->resample.thread)
+          return;
+
+     direct_mutex_lock( &stack->resample.lock );
+
+     deliver_x = WindowStack_Resample_Settle( &stack->resample.x );
+     deliver_y = WindowStack_Resample_Settle( &stack->resample.y );
+
+     WindowStack_Resample_Deliver( stack, deliver_x, deliver_y );
+
+     direct_mutex_unlock( &stack->resample.lock );
+}
+
+static void
+WindowStack_Resample_Add( CoreWindowStack     *stack,
+                          const DFBInputEvent *event )
+{
+     CoreWindowStackResampleAxis *axis = (event->axis == DIAI_X) ? &stack->resample.x : &stack->resample.y;
+     long long                    ts   = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC );
+     bool                         idle;
+
+     direct_mutex_lock( &stack->resample.lock );
+
+     idle = WindowStack_Resample_Idle( stack );
+
+     /* Start over with a different device. */
+     if (axis->num && axis->event.device_id != event->device_id) {
+          bool deliver_x = WindowStack_Resample_Settle( &stack->resample.x );
+          bool deliver_y = WindowStack_Resample_Settle( &stack->resample.y );
+
+          WindowStack_Resample_Deliver( stack, deliver_x, deliver_y );
+
+          axis->num = 0;
+     }
+
+     if (axis->num && ts <= axis->ts[1]) {
+          axis->value[1] = event->axisabs;
+     }
+     else if (axis->num && ts - axis->ts[1] <= 2 * stack->resample.interval) {
+          axis->value[0] = axis->value[1];
+          axis->ts[0]    = axis->ts[1];
+          axis->value[1] = event->axisabs;
+          axis->ts[1]    = ts;
+          axis->num      = 2;
+     }
+     else {
+          /* No interpolation with a position from before a pause in motion. */
+          axis->value[1] = event->axisabs;
+          axis->ts[1]    = ts;
+          axis->num      = 1;
+     }
+
+     axis->event   = *event;
+     axis->pending = true;
+
+     /* Wake up the frame clock thread. */
+     if (idle)
+          direct_waitqueue_signal( &stack->resample.cond );
+
+     direct_mutex_unlock( &stack->resample.lock );
+}
+
 static void
 WindowStack_Input_DispatchCleanup( void *ctx )
 {
@@ -1070,6 +1347,17 @@ _dfb_windowstack_inputdevice_listener( const void *msg_data,
                switch (event->axis) {
                     case DIAI_X:
                     case DIAI_Y:
+                         if (stack->resample.thread && event->flags & DIEF_AXISABS) {
+                              WindowStack_Input_Flush( stack );
+
+                              WindowStack_Resample_Add( stack, event );
+
+                              dfb_layer_context_unref( stack->context );
+                              return RS_OK;
+                         }
+
+                         WindowStack_Resample_Flush( stack );
+
                          WindowStack_Input_Add( stack, event );
 
                          if (!stack->motion_cleanup) {
@@ -1097,6 +1385,8 @@ _dfb_windowstack_inputdevice_listener( const void *msg_data,
 
      WindowStack_Input_Flush( stack );
 
+     WindowStack_Resample_Flush( stack );
+
      /* Lock the window stack. */
      if (dfb_windowstack_lock( stack )) {
           dfb_layer_context_unref( stack->context );
@@ -20,6 +20,7 @@
 #define __CORE__WINDOWSTACK_H__
 
 #include <core/coretypes.h>
+#include <direct/thread.h>
 #include <fusion/call.h>
 #include <fusion/fusion.h>
 #include <fusion/reactor.h>
@@ -36,6 +37,16 @@ typedef enum {
      CWSF_ALL         = 0x00000003
 } CoreWindowStackFlags;
 
+typedef struct {
+     DFBInputEvent                       event;           /* last absolute motion event received */
+     bool                                pending;         /* new positions since the last frame */
+     bool                                settle;          /* last position not delivered yet */
+
+     int                                 num;             /* number of valid samples */
+     int                                 value[2];        /* last two positions, oldest first */
+     long long                           ts[2];           /* arrival time of the positions */
+} CoreWindowStackResampleAxis;
+
 struct __DFB_CoreWindowStack {
      DirectLink                          link;
 
@@ -97,6 +108,18 @@ struct __DFB_CoreWindowStack {
      DFBInputEvent                       motion_y;        /* y motion */
      long long                           motion_ts;       /* micros */
 
+     struct {
+          DirectThread                  *thread;          /* frame clock thread, if resampling is enabled */
+          DirectMutex                    lock;            /* protects the axes and serializes their delivery */
+          DirectWaitQueue                cond;
+          bool                           quit;
+
+          long long                      interval;        /* frame interval in micros */
+
+          CoreWindowStackResampleAxis    x;               /* x axis */
+          CoreWindowStackResampleAxis    y;               /* y axis */
+     } resample;
+
      FusionVector                        visible_windows; /* list of visible windows */
 };
 
@@ -2220,6 +2220,88 @@ IDirectFBSurface_GetFont( IDirectFBSurface  *thiz,
      return DFB_OK;
 }
 
+/*
+ * Move the position of a string from the point specified by the text flags to its origin.
+ */
+static DFBResult
+drawstring_position( IDirectFBSurface_data *data,
+                     CoreFont              *font,
+                     const char            *text,
+                     int                    bytes,
+                     DFBSurfaceTextFlags    flags,
+                     int                   *x,
+                     int                   *y )
+{
+     if (!(flags & DSTF_TOP)) {
+          *x += font->ascender * font->up_unit_x;
+          *y += font->ascender * font->up_unit_y;
+
+          if (flags & DSTF_BOTTOM) {
+               *x -= font->descender * font->up_unit_x;
+               *y -= font->descender * font->up_unit_y;
+          }
+     }
+
+     if (flags & (DSTF_RIGHT | DSTF_CENTER)) {
+          DFBResult    ret;
+          int          i, num, kx, ky;
+          int          xsize = 0;
+          int          ysize = 0;
+          unsigned int prev  = 0;
+          unsigned int indices[bytes];
+          CoreFontRun *run;
+
+          dfb_font_lock( font );
+
+          /* Use the cached layout of the string, also replayed by the drawing below. */
+          if (dfb_font_get_run( font, data->encoding, text, bytes, &run ) == DFB_OK) {
+               xsize = run->xadvance;
+               ysize = run->yadvance;
+               num   = 0;
+          }
+          else {
+               /* Decode string to character indices. */
+               ret = dfb_font_decode_text( font, data->encoding, text, bytes, indices, &num );
+               if (ret) {
+                    dfb_font_unlock( font );
+                    return ret;
+               }
+          }
+
+          /* Calculate string width. */
+          for (i = 0; i < num; i++) {
+               unsigned int   current = indices[i];
+               CoreGlyphData *glyph;
+
+               if (dfb_font_get_glyph_data( font, current, 0, &glyph ) == DFB_OK) {
+                    xsize += glyph->xadvance;
+                    ysize += glyph->yadvance;
+
+                    if (prev && font->GetKerning && font->GetKerning( font, prev, current, &kx, &ky ) == DFB_OK) {
+                         xsize += kx << 8;
+                         ysize += ky << 8;
+                    }
+               }
+
+               prev = current;
+          }
+
+          dfb_font_unlock( font );
+
+          /* Justify. */
+          if (flags & DSTF_RIGHT) {
+               *x -= xsize >> 8;
+               *y -= ysize >> 8;
+          }
+          else if (flags & DSTF_CENTER) {
+               *x -= xsize >> 9;
+               *y -= ysize >> 9;
+          }
+     }
+
+     return DFB_OK;
+}
+
 static DFBResult
 IDirectFBSurface_DrawString( IDirectFBSurface    *thiz,
                              const char          *text,
@@ -2228,6 +2310,7 @@ IDirectFBSurface_DrawString( IDirectFBSurface    *thiz,
                              int                  y,
                              DFBSurfaceTextFlags  flags )
 {
+     DFBResult           ret;
      IDirectFBFont_data *font_data;
      unsigned int        layers = 1;
 
@@ -2273,64 +2356,9 @@ IDirectFBSurface_DrawString( IDirectFBSurface    *thiz,
           layers = 2;
      }
 
-     if (!(flags & DSTF_TOP)) {
-          x += font_data->font->ascender * font_data->font->up_unit_x;
-          y += font_data->font->ascender * font_data->font->up_unit_y;
-
-          if (flags & DSTF_BOTTOM) {
-               x -= font_data->font->descender * font_data->font->up_unit_x;
-               y -= font_data->font->descender * font_data->font->up_unit_y;
-          }
-     }
-
-     if (flags & (DSTF_RIGHT | DSTF_CENTER)) {
-          DFBResult    ret;
-          int          i, num, kx, ky;
-          int          xsize = 0;
-          int          ysize = 0;
-          unsigned int prev  = 0;
-          unsigned int indices[bytes];
-
-          dfb_font_lock( font_data->font );
-
-          /* Decode string to character indices. */
-          ret = dfb_font_decode_text( font_data->font, data->encoding, text, bytes, indices, &num );
-          if (ret) {
-               dfb_font_unlock( font_data->font );
-               return ret;
-          }
-
-          /* Calculate string width. */
-          for (i = 0; i < num; i++) {
-               unsigned int   current = indices[i];
-               CoreGlyphData *glyph;
-
-               if (dfb_font_get_glyph_data( font_data->font, current, 0, &glyph ) == DFB_OK) {
-                    xsize += glyph->xadvance;
-                    ysize += glyph->yadvance;
-
-                    if (prev && font_data->font->GetKerning &&
-                        font_data->font->GetKerning( font_data->font, prev, current, &kx, &ky ) == DFB_OK) {
-                         xsize += kx << 8;
-                         ysize += ky << 8;
-                    }
-               }
-
-               prev = current;
-          }
-
-          dfb_font_unlock( font_data->font );
-
-          /* Justify. */
-          if (flags & DSTF_RIGHT) {
-               x -= xsize >> 8;
-               y -= ysize >> 8;
-          }
-          else if (flags & DSTF_CENTER) {
-               x -= xsize >> 9;
-               y -= ysize >> 9;
-          }
-     }
+     ret = drawstring_position( data, font_data->font, text, bytes, flags, &x, &y );
+     if (ret)
+          return ret;
 
      dfb_gfxcard_drawstring( (const unsigned char*) text, bytes, data->encoding,
                              data->area.wanted.x + x, data->area.wanted.y + y,
@@ -3716,6 +3744,107 @@ IDirectFBSurface_Flush( IDirectFBSurface     *thiz )
      return DFB_OK;
 }
 
+static DFBResult
+IDirectFBSurface_DrawStrings( IDirectFBSurface         *thiz,
+                              const DFBSurfaceTextItem *items,
+                              unsigned int              num )
+{
+     DFBResult           ret = DFB_OK;
+     IDirectFBFont_data *font_data;
+     CoreFont           *font;
+     CardString         *strings;
+     unsigned int        i, n;
+     unsigned int        group_layers = 0;
+     DFBSurfaceTextFlags group_flags  = DSTF_NONE;
+
+     DIRECT_INTERFACE_GET_DATA( IDirectFBSurface )
+
+     D_DEBUG_AT( Surface, "%s( %p, %p [%u] )\n", __FUNCTION__, thiz, items, num );
+
+     if (!data->surface)
+          return DFB_DESTROYED;
+
+     if (!data->area.current.w || !data->area.current.h)
+          return DFB_INVAREA;
+
+     if (data->locked)
+          return DFB_LOCKED;
+
+     if (!data->font)
+          return DFB_MISSINGFONT;
+
+     if (!items)
+          return DFB_INVARG;
+
+     if (!num)
+          return DFB_OK;
+
+     font_data = data->font->priv;
+     if (!font_data)
+          return DFB_DEAD;
+
+     if (core_dfb->shutdown_running)
+          return DFB_OK;
+
+     font = font_data->font;
+
+     for (i = 0; i < num; i++) {
+          if (!items[i].text)
+               return DFB_INVARG;
+
+          if ((items[i].flags & DSTF_OUTLINE) && !(font->attributes & DFFA_OUTLINED))
+               return DFB_UNSUPPORTED;
+     }
+
+     strings = D_MALLOC( num * sizeof(CardString) );
+     if (!strings)
+          return D_OOM();
+
+     /* Keep the font locked, so that the layouts computed for justification are still cached when drawing. */
+     dfb_font_lock( font );
+
+     for (i = 0, n = 0; i < num; i++) {
+          const DFBSurfaceTextItem *item   = &items[i];
+          int                       bytes  = item->bytes < 0 ? strlen( item->text ) : item->bytes;
+          int                       x      = item->x;
+          int                       y      = item->y;
+          unsigned int              layers = (item->flags & DSTF_OUTLINE) ? 2 : 1;
+
+          if (!bytes)
+               continue;
+
+          ret = drawstring_position( data, font, item->text, bytes, item->flags, &x, &y );
+          if (ret)
+               break;
+
+          /* Strings sharing the layers and blend functions are drawn with one state setup. */
+          if (n && (layers != group_layers || (item->flags & DSTF_BLEND_FUNCS) != group_flags)) {
+               dfb_gfxcard_drawstrings( strings, n, data->encoding, font, group_layers, &data->state_client,
+                                        group_flags );
+               n = 0;
+          }
+
+          group_layers = layers;
+          group_flags  = item->flags & DSTF_BLEND_FUNCS;
+
+          strings[n].text  = (const u8*) item->text;
+          strings[n].bytes = bytes;
+          strings[n].x     = data->area.wanted.x + x;
+          strings[n].y     = data->area.wanted.y + y;
+
+          n++;
+     }
+
+     if (n)
+          dfb_gfxcard_drawstrings( strings, n, data->encoding, font, group_layers, &data->state_client, group_flags );
+
+     dfb_font_unlock( font );
+
+     D_FREE( strings );
+
+     return ret;
+}
+
 static ReactionResult
 IDirectFBSurface_React( const void *msg_data,
                         void       *ctx )
@@ -4026,6 +4155,7 @@ IDirectFBSurface_Construct( IDirectFBSurface       *thiz,
      thiz->GetAllocation          = IDirectFBSurface_GetAllocation;
      thiz->GetAllocations         = IDirectFBSurface_GetAllocations;
      thiz->Flush                  = IDirectFBSurface_Flush;
+     thiz->DrawStrings            = IDirectFBSurface_DrawStrings;
 
      return DFB_OK;
 }
@@ -7664,6 +7664,112 @@ static GenefxFunc Bop_a8_set_alphapixel_Aop_PFI[DFB_NUM_PIXELFORMATS] = {
      [DFB_PIXELFORMAT_INDEX(DSPF_BGR24)]      = Bop_a8_set_alphapixel_Aop_bgr24,
 };
 
+/**********************************************************************************************************************
+ ********************************* Bop_a8_set_alphapixel_coloralpha_Aop_PFI *******************************************
+ **********************************************************************************************************************/
+
+/*
+ * Same as Bop_a8_set_alphapixel_Aop_PFI, but with the glyph coverage scaled by the color alpha first,
+ * for text drawn with a translucent color (DSBLIT_BLEND_COLORALPHA).
+ */
+
+/* change the last value to adjust the size of the device (1-4) */
+#define SET_PIXEL_DUFFS_DEVICE(D,S,w) \
+     SET_PIXEL_DUFFS_DEVICE_N( D, S, w, 3 )
+
+static void
+Bop_a8_set_alphapixel_coloralpha_Aop_rgb16( GenefxState *gfxs )
+{
+     int  w   = gfxs->length;
+     u8  *S   = gfxs->Bop[0];
+     u16 *D   = gfxs->Aop[0];
+     u32  Cop = gfxs->Cop;
+     u32  ca  = gfxs->color.a + 1;
+     u32  rb  = Cop & 0xf81f;
+     u32  g   = Cop & 0x07e0;
+
+#define SET_PIXEL(d,s)                                                                                            \
+     if (s) {                                                                                                     \
+          u32 x = (s * ca) >> 8;                                                                                  \
+          if (x) {                                                                                                \
+               u32 a  = (x >> 2) + 1;                                                                             \
+               u32 t1 = d & 0xf81f;                                                                               \
+               u32 t2 = d & 0x07e0;                                                                               \
+               d = ((((rb - t1) * a + (t1 << 6)) & 0x003e07c0) + (((g - t2) * a + (t2 << 6)) & 0x0001f800)) >> 6; \
+          }                                                                                                       \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_coloralpha_Aop_rgb32( GenefxState *gfxs )
+{
+     int  w   = gfxs->length;
+     u8  *S   = gfxs->Bop[0];
+     u32 *D   = gfxs->Aop[0];
+     u32  Cop = gfxs->Cop;
+     u32  ca  = gfxs->color.a + 1;
+     u32  rb  = Cop & 0xff00ff;
+     u32  g   = Cop & 0x00ff00;
+
+#define SET_PIXEL(d,s)                                                                                            \
+     if (s) {                                                                                                     \
+          u32 x = (s * ca) >> 8;                                                                                  \
+          if (x) {                                                                                                \
+               u32 a  = x + 1;                                                                                    \
+               u32 t1 = d & 0x00ff00ff;                                                                           \
+               u32 t2 = d & 0x0000ff00;                                                                           \
+               d = ((((rb - t1) * a + (t1 << 8)) & 0xff00ff00) + (((g - t2) * a + (t2 << 8)) & 0x00ff0000)) >> 8; \
+          }                                                                                                       \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_coloralpha_Aop_argb( GenefxState *gfxs )
+{
+     int  w   = gfxs->length;
+     u8  *S   = gfxs->Bop[0];
+     u32 *D   = gfxs->Aop[0];
+     u32  ca  = gfxs->color.a + 1;
+     u32  rb  = gfxs->Cop & 0x00ff00ff;
+     u32  g   = gfxs->color.g;
+
+#define SET_PIXEL(d,s)                                                                      \
+     if (s) {                                                                               \
+          u32 x = (s * ca) >> 8;                                                            \
+          if (x) {                                                                          \
+               u32 a  = x + 1;                                                              \
+               u32 a1 = 256 - x;                                                            \
+               u32 sa = (((d >> 24) * a1) >> 8) + x;                                        \
+               d = (sa << 24)                                                             + \
+                    (((((d & 0x00ff00ff)       * a1) + (rb * a)) >> 8) & 0x00ff00ff)      + \
+                    (((((d & 0x0000ff00) >> 8) * a1) + ( g * a))       & 0x0000ff00);       \
+          }                                                                                 \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+#undef SET_PIXEL_DUFFS_DEVICE
+
+static GenefxFunc Bop_a8_set_alphapixel_coloralpha_Aop_PFI[DFB_NUM_PIXELFORMATS] = {
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = Bop_a8_set_alphapixel_coloralpha_Aop_rgb16,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = Bop_a8_set_alphapixel_coloralpha_Aop_rgb32,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = Bop_a8_set_alphapixel_coloralpha_Aop_argb,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = Bop_a8_set_alphapixel_coloralpha_Aop_argb,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]       = Bop_a8_set_alphapixel_coloralpha_Aop_argb,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = Bop_a8_set_alphapixel_coloralpha_Aop_argb,
+};
+
 /**********************************************************************************************************************
  ********************************* Bop_a1_set_alphapixel_Aop_PFI ******************************************************
  **********************************************************************************************************************/
@@ -9736,6 +9842,40 @@ gInit_MMX( void )
 
 #endif
 
+#ifdef USE_SSE2
+
+#include "generic_sse2.h"
+
+/*
+ * patches function pointers to SSE2 functions
+ */
+static void
+gInit_SSE2( void )
+{
+/********************************* Bop_a8_set_alphapixel_Aop_PFI ******************/
+     Bop_a8_set_alphapixel_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)] = Bop_a8_set_alphapixel_Aop_rgb16_SSE2;
+     Bop_a8_set_alphapixel_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] = Bop_a8_set_alphapixel_Aop_rgb32_SSE2;
+     Bop_a8_set_alphapixel_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  = Bop_a8_set_alphapixel_Aop_argb_SSE2;
+     Bop_a8_set_alphapixel_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]  = Bop_a8_set_alphapixel_Aop_argb_SSE2;
+     Bop_a8_set_alphapixel_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]  = Bop_a8_set_alphapixel_Aop_argb_SSE2;
+     Bop_a8_set_alphapixel_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]  = Bop_a8_set_alphapixel_Aop_argb_SSE2;
+/********************************* Bop_a8_set_alphapixel_coloralpha_Aop_PFI *******/
+     Bop_a8_set_alphapixel_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)] =
+          Bop_a8_set_alphapixel_coloralpha_Aop_rgb16_SSE2;
+     Bop_a8_set_alphapixel_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] =
+          Bop_a8_set_alphapixel_coloralpha_Aop_rgb32_SSE2;
+     Bop_a8_set_alphapixel_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  =
+          Bop_a8_set_alphapixel_coloralpha_Aop_argb_SSE2;
+     Bop_a8_set_alphapixel_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]  =
+          Bop_a8_set_alphapixel_coloralpha_Aop_argb_SSE2;
+     Bop_a8_set_alphapixel_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]  =
+          Bop_a8_set_alphapixel_coloralpha_Aop_argb_SSE2;
+     Bop_a8_set_alphapixel_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]  =
+          Bop_a8_set_alphapixel_coloralpha_Aop_argb_SSE2;
+}
+
+#endif
+
 #ifdef USE_NEON
 
 #include "generic_neon.h"
@@ -9875,6 +10015,19 @@ gGetDriverInfo( GraphicsDriverInfo *driver_info )
      }
 #endif
 
+#ifdef USE_SSE2
+     if (!dfb_config->sse2) {
+          D_INFO( "DirectFB/Genefx: SSE2 disabled by option 'no-sse2'\n" );
+     }
+     else {
+          gInit_SSE2();
+
+          snprintf( driver_info->name, DFB_GRAPHICS_DRIVER_INFO_NAME_LENGTH, "SSE2 Software Driver" );
+
+          D_INFO( "DirectFB/Genefx: SSE2 enabled\n" );
+     }
+#endif
+
 #ifdef USE_NEON
      if (!dfb_config->neon) {
           D_INFO( "DirectFB/Genefx: NEON disabled by option 'no-neon'\n" );
@@ -10750,6 +10903,17 @@ gAcquireSetup( CardState           *state,
                          break;
                     }
                }
+               if (((simpld_blittingflags == (DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA |
+                                               DSBLIT_SRC_PREMULTIPLY) &&
+                     state->src_blend == DSBF_ONE) ||
+                    (simpld_blittingflags == (DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA) &&
+                     state->src_blend == DSBF_SRCALPHA)) &&
+                   state->dst_blend   == DSBF_INVSRCALPHA) {
+                    if (gfxs->src_format == DSPF_A8 && Bop_a8_set_alphapixel_coloralpha_Aop_PFI[dst_pfi]) {
+                         *funcs++ = Bop_a8_set_alphapixel_coloralpha_Aop_PFI[dst_pfi];
+                         break;
+                    }
+               }
 #ifndef WORDS_BIGENDIAN
                if (simpld_blittingflags       == DSBLIT_NOFX &&
                    source->config.format      == DSPF_RGB24 &&
@@ -0,0 +1,264 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <emmintrin.h>
+
+/*
+ * A8 glyph blending, results are identical to the Bop_a8_set_alphapixel_(coloralpha_)Aop_PFI functions.
+ *
+ * The coverage is scaled by 'ca' (color alpha + 1), or used as is if 'ca' is 256. Groups of pixels without coverage
+ * are skipped, fully covered groups are filled with the color unless the color alpha is applied. Like the C functions,
+ * the ARGB functions blend the green channel of the color instead of the middle byte of the pixel value. The remaining
+ * pixels of a span are processed in a temporary group.
+ */
+
+static __inline__ __m128i
+a8_coverage_SSE2( __m128i s8,
+                  u32     ca )
+{
+     __m128i s16 = _mm_unpacklo_epi8( s8, _mm_setzero_si128() );
+
+     if (ca != 256)
+          s16 = _mm_srli_epi16( _mm_mullo_epi16( s16, _mm_set1_epi16( ca ) ), 8 );
+
+     return s16;
+}
+
+/*
+ * Blends four pixels, 's16' holds their coverage in the four lower 16 bit lanes. Fully covered pixels are set to
+ * 'cop' if 'fill' is set, otherwise they are blended like the others.
+ */
+static __inline__ __m128i
+a8_blend_32_SSE2( __m128i d,
+                  __m128i s16,
+                  __m128i c16,
+                  __m128i cop,
+                  bool    argb,
+                  bool    fill )
+{
+     const __m128i zero = _mm_setzero_si128();
+     __m128i       s    = _mm_unpacklo_epi16( s16, s16 );
+     __m128i       slo  = _mm_unpacklo_epi32( s, s );
+     __m128i       shi  = _mm_unpackhi_epi32( s, s );
+     __m128i       dlo  = _mm_unpacklo_epi8( d, zero );
+     __m128i       dhi  = _mm_unpackhi_epi8( d, zero );
+     __m128i       one  = _mm_set1_epi16( 1 );
+     __m128i       s32  = _mm_unpacklo_epi16( s16, zero );
+     __m128i       full = _mm_cmpeq_epi32( s32, _mm_set1_epi32( 255 ) );
+     __m128i       r;
+
+     if (argb) {
+          /* color: (d * (256 - s) + c * (s + 1)) >> 8, alpha: (d * (256 - s) + (s << 8)) >> 8 */
+          const __m128i k256  = _mm_set1_epi16( 256 );
+          const __m128i amask = _mm_set_epi16( -1, 0, 0, 0, -1, 0, 0, 0 );
+
+          dlo = _mm_mullo_epi16( dlo, _mm_sub_epi16( k256, slo ) );
+          dhi = _mm_mullo_epi16( dhi, _mm_sub_epi16( k256, shi ) );
+
+          dlo = _mm_add_epi16( dlo, _mm_mullo_epi16( c16, _mm_add_epi16( slo, one ) ) );
+          dhi = _mm_add_epi16( dhi, _mm_mullo_epi16( c16, _mm_add_epi16( shi, one ) ) );
+
+          dlo = _mm_add_epi16( dlo, _mm_and_si128( _mm_slli_epi16( slo, 8 ), amask ) );
+          dhi = _mm_add_epi16( dhi, _mm_and_si128( _mm_slli_epi16( shi, 8 ), amask ) );
+
+          r = _mm_packus_epi16( _mm_srli_epi16( dlo, 8 ), _mm_srli_epi16( dhi, 8 ) );
+     }
+     else {
+          /* color: (d * (255 - s) + c * (s + 1)) >> 8, alpha cleared */
+          const __m128i k255 = _mm_set1_epi16( 255 );
+          __m128i       none = _mm_cmpeq_epi32( s32, zero );
+
+          dlo = _mm_mullo_epi16( dlo, _mm_sub_epi16( k255, slo ) );
+          dhi = _mm_mullo_epi16( dhi, _mm_sub_epi16( k255, shi ) );
+
+          dlo = _mm_add_epi16( dlo, _mm_mullo_epi16( c16, _mm_add_epi16( slo, one ) ) );
+          dhi = _mm_add_epi16( dhi, _mm_mullo_epi16( c16, _mm_add_epi16( shi, one ) ) );
+
+          r = _mm_packus_epi16( _mm_srli_epi16( dlo, 8 ), _mm_srli_epi16( dhi, 8 ) );
+          r = _mm_and_si128( r, _mm_set1_epi32( 0x00ffffff ) );
+
+          r = _mm_or_si128( _mm_andnot_si128( none, r ), _mm_and_si128( none, d ) );
+     }
+
+     if (fill)
+          r = _mm_or_si128( _mm_andnot_si128( full, r ), _mm_and_si128( full, cop ) );
+
+     return r;
+}
+
+static __inline__ void
+Bop_a8_set_alphapixel_Aop_32_SSE2( GenefxState *gfxs,
+                                   u32          ca,
+                                   bool         argb,
+                                   bool         coloralpha )
+{
+     int     w   = gfxs->length;
+     u8     *S   = gfxs->Bop[0];
+     u32    *D   = gfxs->Aop[0];
+     u32     Cop = argb ? gfxs->Cop | 0xff000000 : gfxs->Cop;
+     u32     C   = argb ? (Cop & 0x00ff00ff) | (gfxs->color.g << 8) : Cop;
+     __m128i cop = _mm_set1_epi32( Cop );
+     __m128i c16 = _mm_unpacklo_epi8( _mm_set1_epi32( C ), _mm_setzero_si128() );
+
+     for (; w >= 4; w -= 4, S += 4, D += 4) {
+          u32 cov;
+
+          memcpy( &cov, S, 4 );
+
+          if (!cov)
+               continue;
+
+          if (cov == 0xffffffff && !coloralpha) {
+               _mm_storeu_si128( (__m128i*) D, cop );
+               continue;
+          }
+
+          _mm_storeu_si128( (__m128i*) D,
+                            a8_blend_32_SSE2( _mm_loadu_si128( (__m128i*) D ),
+                                              a8_coverage_SSE2( _mm_cvtsi32_si128( cov ), ca ), c16, cop, argb,
+                                              !coloralpha ) );
+     }
+
+     if (w) {
+          u32 cov = 0;
+          u32 d[4];
+
+          memcpy( &cov, S, w );
+          memcpy( d, D, w * 4 );
+
+          _mm_storeu_si128( (__m128i*) d,
+                            a8_blend_32_SSE2( _mm_loadu_si128( (__m128i*) d ),
+                                              a8_coverage_SSE2( _mm_cvtsi32_si128( cov ), ca ), c16, cop, argb,
+                                              !coloralpha ) );
+
+          memcpy( D, d, w * 4 );
+     }
+}
+
+/*
+ * Blends eight pixels, 's16' holds their coverage.
+ */
+static __inline__ __m128i
+a8_blend_16_SSE2( __m128i d,
+                  __m128i s16,
+                  __m128i cr,
+                  __m128i cg,
+                  __m128i cb )
+{
+     const __m128i m5   = _mm_set1_epi16( 0x1f );
+     const __m128i m6   = _mm_set1_epi16( 0x3f );
+     __m128i       a    = _mm_add_epi16( _mm_srli_epi16( s16, 2 ), _mm_set1_epi16( 1 ) );
+     __m128i       ia   = _mm_sub_epi16( _mm_set1_epi16( 64 ), a );
+     __m128i       none = _mm_cmpeq_epi16( s16, _mm_setzero_si128() );
+     __m128i       r, g, b;
+
+     /* (d * (64 - a) + c * a) >> 6 for each channel */
+     r = _mm_srli_epi16( d, 11 );
+     g = _mm_and_si128( _mm_srli_epi16( d, 5 ), m6 );
+     b = _mm_and_si128( d, m5 );
+
+     r = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( r, ia ), _mm_mullo_epi16( cr, a ) ), 6 );
+     g = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( g, ia ), _mm_mullo_epi16( cg, a ) ), 6 );
+     b = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( b, ia ), _mm_mullo_epi16( cb, a ) ), 6 );
+
+     r = _mm_or_si128( _mm_or_si128( _mm_slli_epi16( r, 11 ), _mm_slli_epi16( g, 5 ) ), b );
+
+     return _mm_or_si128( _mm_andnot_si128( none, r ), _mm_and_si128( none, d ) );
+}
+
+static __inline__ void
+Bop_a8_set_alphapixel_Aop_16_SSE2( GenefxState *gfxs,
+                                   u32          ca )
+{
+     int     w   = gfxs->length;
+     u8     *S   = gfxs->Bop[0];
+     u16    *D   = gfxs->Aop[0];
+     u32     Cop = gfxs->Cop;
+     __m128i cop = _mm_set1_epi16( Cop );
+     __m128i cr  = _mm_set1_epi16( (Cop >> 11) & 0x1f );
+     __m128i cg  = _mm_set1_epi16( (Cop >>  5) & 0x3f );
+     __m128i cb  = _mm_set1_epi16(  Cop        & 0x1f );
+
+     for (; w >= 8; w -= 8, S += 8, D += 8) {
+          u64 cov;
+
+          memcpy( &cov, S, 8 );
+
+          if (!cov)
+               continue;
+
+          if (cov == 0xffffffffffffffffULL && ca == 256) {
+               _mm_storeu_si128( (__m128i*) D, cop );
+               continue;
+          }
+
+          _mm_storeu_si128( (__m128i*) D,
+                            a8_blend_16_SSE2( _mm_loadu_si128( (__m128i*) D ),
+                                              a8_coverage_SSE2( _mm_loadl_epi64( (__m128i*) S ), ca ), cr, cg, cb ) );
+     }
+
+     if (w) {
+          u8  s[8] = { 0 };
+          u16 d[8];
+
+          memcpy( s, S, w );
+          memcpy( d, D, w * 2 );
+
+          _mm_storeu_si128( (__m128i*) d,
+                            a8_blend_16_SSE2( _mm_loadu_si128( (__m128i*) d ),
+                                              a8_coverage_SSE2( _mm_loadl_epi64( (__m128i*) s ), ca ), cr, cg, cb ) );
+
+          memcpy( D, d, w * 2 );
+     }
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_rgb16_SSE2( GenefxState *gfxs )
+{
+     Bop_a8_set_alphapixel_Aop_16_SSE2( gfxs, 256 );
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_rgb32_SSE2( GenefxState *gfxs )
+{
+     Bop_a8_set_alphapixel_Aop_32_SSE2( gfxs, 256, false, false );
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_argb_SSE2( GenefxState *gfxs )
+{
+     Bop_a8_set_alphapixel_Aop_32_SSE2( gfxs, 256, true, false );
+}
+
+static void
+Bop_a8_set_alphapixel_coloralpha_Aop_rgb16_SSE2( GenefxState *gfxs )
+{
+     Bop_a8_set_alphapixel_Aop_16_SSE2( gfxs, gfxs->color.a + 1 );
+}
+
+static void
+Bop_a8_set_alphapixel_coloralpha_Aop_rgb32_SSE2( GenefxState *gfxs )
+{
+     Bop_a8_set_alphapixel_Aop_32_SSE2( gfxs, gfxs->color.a + 1, false, true );
+}
+
+static void
+Bop_a8_set_alphapixel_coloralpha_Aop_argb_SSE2( GenefxState *gfxs )
+{
+     Bop_a8_set_alphapixel_Aop_32_SSE2( gfxs, gfxs->color.a + 1, true, true );
+}
@@ -1775,6 +1775,21 @@ IDirectFB_GetFontSurfaceFormat( IDirectFB             *thiz,
      return DFB_OK;
 }
 
+static DFBResult
+IDirectFB_GetSurfaceMemoryUsage( IDirectFB             *thiz,
+                                 DFBBoolean             process,
+                                 DFBSurfaceMemoryUsage *ret_usage )
+{
+     DIRECT_INTERFACE_GET_DATA( IDirectFB )
+
+     D_DEBUG_AT( DirectFB, "%s( %p, %s )\n", __FUNCTION__, thiz, process ? "process" : "all" );
+
+     if (!ret_usage)
+          return DFB_INVARG;
+
+     return dfb_surface_pools_get_usage( process ? Core_GetIdentity() : 0, ret_usage );
+}
+
 static void
 LoadBackgroundImage( IDirectFB       *dfb,
                      CoreWindowStack *stack,
@@ -2114,6 +2129,7 @@ IDirectFB_Construct( IDirectFB *thiz )
      thiz->GetInterface           = IDirectFB_GetInterface;
      thiz->GetSurface             = IDirectFB_GetSurface;
      thiz->GetFontSurfaceFormat   = IDirectFB_GetFontSurfaceFormat;
+     thiz->GetSurfaceMemoryUsage  = IDirectFB_GetSurfaceMemoryUsage;
 
      direct_mutex_init( &data->init_lock );
      direct_waitqueue_init( &data->init_wq );
@@ -32,12 +32,7 @@ typedef struct {
 
      CoreInputDevice            *device;                         /* the input device object */
 
-     int                         axis[DIAI_LAST+1];              /* position of all axes */
-     DFBInputDeviceKeyState      keystates[DIKI_NUMBER_OF_KEYS]; /* state of all keys */
-
      DFBInputDeviceDescription   desc;                           /* device description */
-
-     Reaction                    reaction;
 } IDirectFBInputDevice_data;
 
 /**********************************************************************************************************************/
@@ -45,12 +40,8 @@ typedef struct {
 static void
 IDirectFBInputDevice_Destruct( IDirectFBInputDevice *thiz )
 {
-     IDirectFBInputDevice_data *data = thiz->priv;
-
      D_DEBUG_AT( InputDevice, "%s( %p )\n", __FUNCTION__, thiz );
 
-     dfb_input_detach( data->device, &data->reaction );
-
      DIRECT_DEALLOCATE_INTERFACE( thiz );
 }
 
@@ -215,7 +206,8 @@ IDirectFBInputDevice_GetKeyState( IDirectFBInputDevice        *thiz,
                                   DFBInputDeviceKeyIdentifier  key_id,
                                   DFBInputDeviceKeyState      *ret_state )
 {
-     unsigned int index = key_id - DFB_KEY( IDENTIFIER, 0 );
+     unsigned int        index = key_id - DFB_KEY( IDENTIFIER, 0 );
+     InputDeviceSnapshot snapshot;
 
      DIRECT_INTERFACE_GET_DATA( IDirectFBInputDevice )
 
@@ -224,7 +216,9 @@ IDirectFBInputDevice_GetKeyState( IDirectFBInputDevice        *thiz,
      if (!ret_state || index >= DIKI_NUMBER_OF_KEYS)
           return DFB_INVARG;
 
-     *ret_state = data->keystates[index];
+     dfb_input_device_get_snapshot( data->device, &snapshot );
+
+     *ret_state = snapshot.keystates[index];
 
      return DFB_OK;
 }
@@ -327,6 +321,8 @@ IDirectFBInputDevice_GetAxis( IDirectFBInputDevice         *thiz,
                               DFBInputDeviceAxisIdentifier  axis,
                               int                          *ret_pos )
 {
+     InputDeviceSnapshot snapshot;
+
      DIRECT_INTERFACE_GET_DATA( IDirectFBInputDevice )
 
      D_DEBUG_AT( InputDevice, "%s( %p )\n", __FUNCTION__, thiz );
@@ -334,7 +330,9 @@ IDirectFBInputDevice_GetAxis( IDirectFBInputDevice         *thiz,
      if (!ret_pos || axis < DIAI_FIRST || axis > DIAI_LAST)
           return DFB_INVARG;
 
-     *ret_pos = data->axis[axis];
+     dfb_input_device_get_snapshot( data->device, &snapshot );
+
+     *ret_pos = snapshot.axis[axis];
 
      return DFB_OK;
 }
@@ -344,6 +342,8 @@ IDirectFBInputDevice_GetXY( IDirectFBInputDevice *thiz,
                             int                  *ret_x,
                             int                  *ret_y )
 {
+     InputDeviceSnapshot snapshot;
+
      DIRECT_INTERFACE_GET_DATA( IDirectFBInputDevice )
 
      D_DEBUG_AT( InputDevice, "%s( %p )\n", __FUNCTION__, thiz );
@@ -351,11 +351,13 @@ IDirectFBInputDevice_GetXY( IDirectFBInputDevice *thiz,
      if (!ret_x && !ret_y)
           return DFB_INVARG;
 
+     dfb_input_device_get_snapshot( data->device, &snapshot );
+
      if (ret_x)
-          *ret_x = data->axis[DIAI_X];
+          *ret_x = snapshot.axis[DIAI_X];
 
      if (ret_y)
-          *ret_y = data->axis[DIAI_Y];
+          *ret_y = snapshot.axis[DIAI_Y];
 
      return DFB_OK;
 }
@@ -369,48 +371,10 @@ IDirectFBInputDevice_SetConfiguration( IDirectFBInputDevice       *thiz,
      return CoreInputDevice_SetConfiguration( data->device, config );
 }
 
-static ReactionResult
-IDirectFBInputDevice_React( const void *msg_data,
-                            void       *ctx )
-{
-     const DFBInputEvent       *evt  = msg_data;
-     IDirectFBInputDevice_data *data = ctx;
-     unsigned int               index;
-
-     D_DEBUG_AT( InputDevice, "%s( %p, %p ) <- type %06x\n", __FUNCTION__, evt, data, evt->type );
-
-     switch (evt->type) {
-          case DIET_KEYPRESS:
-               index = evt->key_id - DFB_KEY( IDENTIFIER, 0 );
-               if (index < DIKI_NUMBER_OF_KEYS)
-                    data->keystates[index] = DIKS_DOWN;
-             break;
-
-          case DIET_KEYRELEASE:
-               index = evt->key_id - DFB_KEY( IDENTIFIER, 0 );
-               if (index < DIKI_NUMBER_OF_KEYS)
-                    data->keystates[index] = DIKS_UP;
-               break;
-
-          case DIET_AXISMOTION:
-               if (evt->flags & DIEF_AXISREL)
-                    data->axis[evt->axis] += evt->axisrel;
-               if (evt->flags & DIEF_AXISABS)
-                    data->axis[evt->axis] = evt->axisabs;
-               break;
-
-          default:
-               D_DEBUG_AT( InputDevice, "  -> unknown event type, skipping!\n" );
-     }
-
-     return RS_OK;
-}
-
 DFBResult
 IDirectFBInputDevice_Construct( IDirectFBInputDevice *thiz,
                                 CoreInputDevice      *device )
 {
-     DFBResult ret;
 
      DIRECT_ALLOCATE_INTERFACE_DATA( thiz, IDirectFBInputDevice )
 
@@ -421,13 +385,6 @@ IDirectFBInputDevice_Construct( IDirectFBInputDevice *thiz,
 
      dfb_input_device_description( device, &data->desc );
 
-     ret = dfb_input_attach( data->device, IDirectFBInputDevice_React, data, &data->reaction );
-     if (ret) {
-          D_DERROR( ret, "IDirectFBInputDevice: Could not attach to reactor!\n" );
-          DIRECT_DEALLOCATE_INTERFACE( thiz );
-          return ret;
-     }
-
      thiz->AddRef            = IDirectFBInputDevice_AddRef;
      thiz->Release           = IDirectFBInputDevice_Release;
      thiz->GetID             = IDirectFBInputDevice_GetID;
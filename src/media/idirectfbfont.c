@@ -23,6 +23,7 @@
 #include <directfb_util.h>
 #include <media/idirectfbdatabuffer.h>
 #include <media/idirectfbfont.h>
+#include <misc/conf.h>
 
 D_DEBUG_DOMAIN( Font, "IDirectFBFont", "IDirectFBFont Interface" );
 
@@ -246,9 +247,20 @@ IDirectFBFont_GetStringWidth( IDirectFBFont *thiz,
           int          i, num;
           unsigned int prev = 0;
           unsigned int indices[bytes];
+          CoreFontRun *run;
 
           dfb_font_lock( data->font );
 
+          /* Use the cached layout of the string. */
+          if (dfb_font_get_run( data->font, data->encoding, text, bytes, &run ) == DFB_OK) {
+               xsize = run->xadvance;
+               ysize = run->yadvance;
+
+               dfb_font_unlock( data->font );
+
+               goto out;
+          }
+
           /* Decode string to character indices. */
           ret = dfb_font_decode_text( data->font, data->encoding, text, bytes, indices, &num );
           if (ret) {
@@ -280,6 +292,7 @@ IDirectFBFont_GetStringWidth( IDirectFBFont *thiz,
           dfb_font_unlock( data->font );
      }
 
+out:
      if (!ysize) {
           *ret_width = xsize >> 8;
      }
@@ -326,6 +339,18 @@ IDirectFBFont_GetStringExtents( IDirectFBFont *thiz,
           int          i, num;
           unsigned int prev  = 0;
           unsigned int indices[bytes];
+          CoreFontRun *run;
+
+          /* Use the cached layout of the string. */
+          if (dfb_font_get_run( data->font, data->encoding, text, bytes, &run ) == DFB_OK) {
+               xbaseline = run->xadvance;
+               ybaseline = run->yadvance;
+
+               if (ret_ink_rect)
+                    *ret_ink_rect = run->ink;
+
+               goto logical;
+          }
 
           /* Decode string to character indices. */
           ret = dfb_font_decode_text( data->font, data->encoding, text, bytes, indices, &num );
@@ -362,6 +387,7 @@ IDirectFBFont_GetStringExtents( IDirectFBFont *thiz,
           }
      }
 
+logical:
      if (ret_logical_rect) {
           /* We already have the text baseline vector in (xbaseline,ybaseline).
              Find the ascender and descender vectors. */
@@ -774,6 +800,79 @@ IDirectFBFont_GetDescription( IDirectFBFont      *thiz,
      return DFB_OK;
 }
 
+static DFBResult
+IDirectFBFont_PrefetchString( IDirectFBFont *thiz,
+                              const char    *text,
+                              int            bytes )
+{
+     DFBResult ret;
+
+     DIRECT_INTERFACE_GET_DATA( IDirectFBFont )
+
+     D_DEBUG_AT( Font, "%s( %p )\n", __FUNCTION__, thiz );
+
+     if (!text)
+          return DFB_INVARG;
+
+     if (bytes < 0)
+          bytes = strlen( text );
+
+     if (bytes > 0) {
+          int          num;
+          unsigned int indices[bytes];
+
+          dfb_font_lock( data->font );
+
+          ret = dfb_font_decode_text( data->font, data->encoding, text, bytes, indices, &num );
+
+          dfb_font_unlock( data->font );
+
+          if (ret)
+               return ret;
+
+          return dfb_font_prefetch( data->font, indices, num );
+     }
+
+     return DFB_OK;
+}
+
+static DFBResult
+IDirectFBFont_PrefetchRange( IDirectFBFont *thiz,
+                             unsigned int   first,
+                             unsigned int   last )
+{
+     DFBResult     ret;
+     int           num = 0;
+     unsigned int  character;
+     unsigned int *indices;
+
+     DIRECT_INTERFACE_GET_DATA( IDirectFBFont )
+
+     D_DEBUG_AT( Font, "%s( %p, 0x%x-0x%x )\n", __FUNCTION__, thiz, first, last );
+
+     if (first > last || last > 0x10ffff)
+          return DFB_INVARG;
+
+     indices = D_MALLOC( (last - first + 1) * sizeof(unsigned int) );
+     if (!indices)
+          return D_OOM();
+
+     dfb_font_lock( data->font );
+
+     for (character = first; character <= last; character++) {
+          if (dfb_font_decode_character( data->font, DTEID_UTF8, character, &indices[num] ) == DFB_OK)
+               num++;
+     }
+
+     dfb_font_unlock( data->font );
+
+     ret = dfb_font_prefetch( data->font, indices, num );
+
+     D_FREE( indices );
+
+     return ret;
+}
+
 DFBResult
 IDirectFBFont_Construct( IDirectFBFont *thiz, CoreFont *font )
 {
@@ -803,6 +902,8 @@ IDirectFBFont_Construct( IDirectFBFont *thiz, CoreFont *font )
      thiz->GetGlyphExtentsXY    = IDirectFBFont_GetGlyphExtentsXY;
      thiz->GetUnderline         = IDirectFBFont_GetUnderline;
      thiz->GetDescription       = IDirectFBFont_GetDescription;
+     thiz->PrefetchString       = IDirectFBFont_PrefetchString;
+     thiz->PrefetchRange        = IDirectFBFont_PrefetchRange;
 
      return DFB_OK;
 }
@@ -831,6 +932,66 @@ unmap_or_free( IDirectFBFont_ProbeContext *ctx )
      }
 }
 
+/*
+ * Render the character ranges of the 'font-prefetch' option in the background, e.g. "0x20-0x7e,0xa0-0xff".
+ */
+static void
+prefetch_config_ranges( IDirectFBFont *thiz )
+{
+     const char *p = dfb_config->font_prefetch;
+
+     while (*p) {
+          char          *end;
+          unsigned long  first, last;
+
+          first = strtoul( p, &end, 0 );
+          if (end == p)
+               break;
+
+          last = first;
+          p    = end;
+
+          if (*p == '-') {
+               last = strtoul( p + 1, &end, 0 );
+               if (end == p + 1)
+                    break;
+
+               p = end;
+          }
+
+          if (thiz->PrefetchRange( thiz, first, last ))
+               D_WARN( "could not prefetch characters 0x%lx-0x%lx", first, last );
+
+          if (*p != ',')
+               break;
+
+          p++;
+     }
+
+     if (*p)
+          D_ERROR( "IDirectFBFont: Invalid character ranges '%s' in 'font-prefetch' option!\n",
+                   dfb_config->font_prefetch );
+}
+
+/*
+ * FNV-1a hash of font data not coming from a file.
+ */
+static unsigned long long
+content_hash( const void *content,
+              size_t      size )
+{
+     size_t              i;
+     const u8           *bytes = content;
+     unsigned long long  hash  = 0xcbf29ce484222325ULL;
+
+     for (i = 0; i < size; i++) {
+          hash ^= bytes[i];
+          hash *= 0x100000001b3ULL;
+     }
+
+     return hash;
+}
+
 DFBResult
 IDirectFBFont_CreateFromBuffer( IDirectFBDataBuffer       *buffer,
                                 CoreDFB                   *core,
@@ -843,6 +1004,7 @@ IDirectFBFont_CreateFromBuffer( IDirectFBDataBuffer       *buffer,
      IDirectFBFont              *iface;
      IDirectFBFont_ProbeContext  ctx = { NULL, NULL, 0, IDFBFONT_CONTEXT_CONTENT_TYPE_UNKNOWN };
      IDirectFBFont_data         *data;
+     char                        identity[80] = "";
 
      D_DEBUG_AT( Font, "%s( %p )\n", __FUNCTION__, buffer );
 
@@ -891,6 +1053,11 @@ IDirectFBFont_CreateFromBuffer( IDirectFBDataBuffer       *buffer,
           ctx.content_size = info.size;
           ctx.content_type = IDFBFONT_CONTEXT_CONTENT_TYPE_MAPPED;
 
+          /* Identify the file independently of the path, and changes of it. */
+          if ((info.flags & (DFIF_ID | DFIF_MTIME)) == (DFIF_ID | DFIF_MTIME))
+               snprintf( identity, sizeof(identity), "file:%llx:%llx:%zu:%lld",
+                         (unsigned long long) info.device, (unsigned long long) info.inode, info.size, info.mtime );
+
           direct_file_close( &fd );
      }
      else {
@@ -939,6 +1106,19 @@ IDirectFBFont_CreateFromBuffer( IDirectFBDataBuffer       *buffer,
      data->content_size = ctx.content_size;
      data->content_type = ctx.content_type;
 
+     /* Share the glyphs with fonts created from the same file or content in other applications. */
+     if (dfb_config->font_share && data->font->RenderGlyph) {
+          if (!identity[0])
+               snprintf( identity, sizeof(identity), "data:%u:%016llx",
+                         ctx.content_size, content_hash( ctx.content, ctx.content_size ) );
+
+          dfb_font_share( data->font, identity );
+     }
+
+     /* Warm up the glyph cache. */
+     if (dfb_config->font_prefetch && data->font->RenderGlyph)
+          prefetch_config_ranges( iface );
+
      *ret_interface = iface;
 
      return DFB_OK;
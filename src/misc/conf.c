@@ -95,11 +95,27 @@ const char *dfb_config_usage =
      "                                 Setting -1 never frees accumulators until the state is destroyed\n"
      "  [no-]mmx                       Enable MMX assembly support (enabled by default if available)\n"
      "  [no-]neon                      Enable NEON assembly support (enabled by default if available)\n"
+     "  [no-]sse2                      Enable SSE2 support (enabled by default if available)\n"
      "  warn=<type[:<width>x<height>]> Print warnings on surface/window creations or surface buffer allocations\n"
      "                                 [ create-surface | create-window | allocate-buffer ]\n"
      "  [no-]surface-clear             Clear all surface buffers after creation\n"
      "  [no-]thrifty-surface-buffers   Release system instance while video instance is alive\n"
      "  surface-shmpool-size=<kb>      Set the size of the shared memory pool used for shared system memory surfaces\n"
+     "  surface-recycle-size=<kb>      Keep released system memory surface buffers up to this size for reuse by\n"
+     "                                 allocations of the same size (default = 0, disabled)\n"
+     "  surface-recycle-idle=<ms>      Free kept surface buffers not reused within this time (default = 2000)\n"
+     "  [no-]surface-memfd             Allocate each shared system memory surface buffer as a memfd instead of in the\n"
+     "                                 shared memory pool (multi application core without secure fusion only)\n"
+     "  [no-]surface-memfd-hugetlb     Back memfd surface buffers with huge pages if available\n"
+     "  surface-hugepages=<kb>         Align local system memory surface buffers of at least this size to huge pages and\n"
+     "                                 advise transparent huge pages for them (default = 0, disabled)\n"
+     "  surface-transfer-threads=<n>   Split copies of large surface buffers between pools across up to this number of\n"
+     "                                 threads (default = 1, copy on the calling thread only)\n"
+     "  surface-park-idle=<ms>         Compress system memory surface buffers not locked within this time, they are\n"
+     "                                 restored on the next lock (default = 0, disabled)\n"
+     "  [no-]surface-memory-stats=[<ms>]\n"
+     "                                 Print surface memory usage per pool, kind of surface and process periodically\n"
+     "                                 (1000 ms if no period is specified)\n"
      "  system-surface-base-alignment=<byte alignment>\n"
      "                                 If GPU supports system memory, set the byte alignment for system memory based\n"
      "                                 surface's base address (value must be a positive power of two that is four or\n"
@@ -133,11 +149,19 @@ const char *dfb_config_usage =
      "  [no-]capslock-meta             Map the CapsLock key to Meta\n"
      "  [no-]lefty                     Swap left and right mouse buttons\n"
      "  screenshot-dir=<directory>     Dump screen content on <Print> key presses\n"
+     "  input-record=<filename>        Record input events to a file (to be replayed with the input_replay driver)\n"
+     "  [no-]input-resample            Deliver absolute pointer motion once per screen frame, resampled to the frame time\n"
      "  font-format=<pixelformat>      Set the preferred font format (default is 8 bit alpha)\n"
      "  [no-]font-premult              Enable premultiplied glyph images in ARGB format (default enabled)\n"
      "  font-resource-id=<id>          Resource ID to use for font cache row surfaces\n"
-     "  max-font-rows=<number>         Maximum number of glyph cache rows (default = 99)\n"
+     "  max-font-rows=<number>         Maximum number of glyph cache rows, at least 2 (default = 99)\n"
      "  max-font-row-width=<pixels>    Maximum width of glyph cache row surface (default = 2048)\n"
+     "  [no-]font-atlas                Pack glyphs into 2D atlas surfaces, each accounting for several cache rows\n"
+     "  max-font-runs=<number>         Maximum number of cached text layouts per font, 0 to disable (default = 64)\n"
+     "  [no-]font-share                Share glyphs of fonts from the same file or data with other applications\n"
+     "  font-subpixel-phases=<number>  Number of horizontal subpixel positions to cache glyphs for, 1 to 4 (default = 1)\n"
+     "  font-prefetch=<ranges>         Character ranges to render in the background when a font is loaded,\n"
+     "                                 e.g. 0x20-0x7e,0xa0-0xff\n"
      "\n";
 
 /**********************************************************************************************************************/
@@ -272,8 +296,11 @@ config_allocate( void )
 
      dfb_config->mmx                                   = true;
      dfb_config->neon                                  = true;
+     dfb_config->sse2                                  = true;
 
      dfb_config->surface_shmpool_size                  = 64 * 1024 * 1024;
+     dfb_config->surface_recycle_idle                  = 2000;
+     dfb_config->surface_transfer_threads              = 1;
 
      dfb_config->max_frame_advance                     = 100000;
 
@@ -285,6 +312,8 @@ config_allocate( void )
      dfb_config->font_premult                          = true;
      dfb_config->max_font_rows                         = 99;
      dfb_config->max_font_row_width                    = 2048;
+     dfb_config->max_font_runs                         = 64;
+     dfb_config->font_subpixel_phases                  = 1;
 }
 
 static DFBResult
@@ -1052,6 +1081,12 @@ dfb_config_set( const char *name,
      if (strcmp( name, "no-neon" ) == 0) {
           dfb_config->neon = false;
      } else
+     if (strcmp( name, "sse2" ) == 0) {
+          dfb_config->sse2 = true;
+     } else
+     if (strcmp( name, "no-sse2" ) == 0) {
+          dfb_config->sse2 = false;
+     } else
      if (strcmp( name, "warn" ) == 0 || strcmp( name, "no-warn" ) == 0) {
           DFBConfigWarnFlags flags = DCWF_ALL;
 
@@ -1103,6 +1138,34 @@ dfb_config_set( const char *name,
      if (strcmp( name, "no-thrifty-surface-buffers" ) == 0) {
           dfb_config->thrifty_surface_buffers = false;
      } else
+     if (strcmp( name, "surface-memfd" ) == 0) {
+          dfb_config->surface_memfd = true;
+     } else
+     if (strcmp( name, "no-surface-memfd" ) == 0) {
+          dfb_config->surface_memfd = false;
+     } else
+     if (strcmp( name, "surface-memfd-hugetlb" ) == 0) {
+          dfb_config->surface_memfd_hugetlb = true;
+     } else
+     if (strcmp( name, "no-surface-memfd-hugetlb" ) == 0) {
+          dfb_config->surface_memfd_hugetlb = false;
+     } else
+     if (strcmp( name, "surface-hugepages" ) == 0) {
+          if (value) {
+               int size_kb;
+
+               if (sscanf( value, "%d", &size_kb ) < 1 || size_kb < 0) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->surface_hugepages = size_kb;
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
      if (!strcmp( name, "surface-shmpool-size" )) {
           if (value) {
                int size_kb;
@@ -1119,6 +1182,87 @@ dfb_config_set( const char *name,
                return DFB_INVARG;
           }
      } else
+     if (strcmp( name, "surface-recycle-size" ) == 0) {
+          if (value) {
+               int size_kb;
+
+               if (sscanf( value, "%d", &size_kb ) < 1 || size_kb < 0) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->surface_recycle_size = size_kb;
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
+     if (strcmp( name, "surface-recycle-idle" ) == 0) {
+          if (value) {
+               int idle;
+
+               if (sscanf( value, "%d", &idle ) < 1 || idle < 0) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->surface_recycle_idle = idle;
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
+     if (strcmp( name, "surface-park-idle" ) == 0) {
+          if (value) {
+               int idle;
+
+               if (sscanf( value, "%d", &idle ) < 1 || idle < 0) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->surface_park_idle = idle;
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
+     if (strcmp( name, "surface-memory-stats" ) == 0) {
+          if (value) {
+               unsigned int interval;
+
+               if (sscanf( value, "%u", &interval ) < 1) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->surface_memory_stats = interval;
+          }
+          else
+               dfb_config->surface_memory_stats = 1000;
+     } else
+     if (strcmp( name, "no-surface-memory-stats" ) == 0) {
+          dfb_config->surface_memory_stats = 0;
+     } else
+     if (strcmp( name, "surface-transfer-threads" ) == 0) {
+          if (value) {
+               int threads;
+
+               if (sscanf( value, "%d", &threads ) < 1 || threads < 1) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->surface_transfer_threads = threads;
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
      if (strcmp( name, "system-surface-base-alignment" ) == 0) {
           if (value) {
                unsigned int base_align;
@@ -1312,6 +1456,24 @@ dfb_config_set( const char *name,
                return DFB_INVARG;
           }
      } else
+     if (strcmp( name, "input-record" ) == 0) {
+          if (value) {
+               if (dfb_config->input_record)
+                    D_FREE( dfb_config->input_record );
+
+               dfb_config->input_record = D_STRDUP( value );
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No file name specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
+     if (strcmp( name, "input-resample" ) == 0) {
+          dfb_config->input_resample = true;
+     } else
+     if (strcmp( name, "no-input-resample" ) == 0) {
+          dfb_config->input_resample = false;
+     } else
      if (strcmp( name, "font-format" ) == 0) {
           if (value) {
                DFBSurfacePixelFormat format;
@@ -1360,6 +1522,11 @@ dfb_config_set( const char *name,
                     return DFB_INVARG;
                }
 
+               if (rows < 2) {
+                    D_ERROR( "DirectFB/Config: '%s': Value must be at least 2!\n", name );
+                    return DFB_INVARG;
+               }
+
                dfb_config->max_font_rows = rows;
           }
           else {
@@ -1383,6 +1550,62 @@ dfb_config_set( const char *name,
                D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
                return DFB_INVARG;
           }
+     } else
+     if (strcmp( name, "max-font-runs" ) == 0) {
+          if (value) {
+               int runs;
+
+               if (sscanf( value, "%d", &runs ) < 1 || runs < 0) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->max_font_runs = runs;
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
+     if (strcmp( name, "font-share" ) == 0) {
+          dfb_config->font_share = true;
+     } else
+     if (strcmp( name, "no-font-share" ) == 0) {
+          dfb_config->font_share = false;
+     } else
+     if (strcmp( name, "font-subpixel-phases" ) == 0) {
+          if (value) {
+               int phases;
+
+               if (sscanf( value, "%d", &phases ) < 1 || phases < 1 || phases > 4) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value (1-4)!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->font_subpixel_phases = phases;
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
+     if (strcmp( name, "font-prefetch" ) == 0) {
+          if (value) {
+               if (dfb_config->font_prefetch)
+                    D_FREE( dfb_config->font_prefetch );
+
+               dfb_config->font_prefetch = D_STRDUP( value );
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No character ranges specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
+     if (strcmp( name, "font-atlas" ) == 0) {
+          dfb_config->font_atlas = true;
+     } else
+     if (strcmp( name, "no-font-atlas" ) == 0) {
+          dfb_config->font_atlas = false;
      }
      else {
           dfboption = false;
@@ -1581,6 +1804,9 @@ dfb_config_deinit()
      if (dfb_config->screenshot_dir)
           D_FREE( dfb_config->screenshot_dir );
 
+     if (dfb_config->input_record)
+          D_FREE( dfb_config->input_record );
+
      DFBConfigLayer *conf = dfb_config->config_layer;
      if (conf->palette)
           D_FREE( conf->palette );
@@ -98,6 +98,7 @@ typedef struct
      int                         keep_accumulators;
      bool                        mmx;
      bool                        neon;
+     bool                        sse2;
      struct {
           DFBConfigWarnFlags     flags;
           struct {
@@ -112,6 +113,14 @@ typedef struct
      int                         surface_shmpool_size;
      unsigned int                system_surface_align_base;
      unsigned int                system_surface_align_pitch;
+     int                         surface_recycle_size;
+     int                         surface_recycle_idle;
+     bool                        surface_memfd;
+     bool                        surface_memfd_hugetlb;
+     int                         surface_hugepages;
+     int                         surface_transfer_threads;
+     int                         surface_park_idle;
+     unsigned int                surface_memory_stats;
      long long                   max_frame_advance;
      bool                        force_frametime;
      bool                        subsurface_caching;
@@ -132,11 +141,18 @@ typedef struct
      bool                        lefty;
      bool                        capslock_meta;
      char                       *screenshot_dir;
+     char                       *input_record;
+     bool                        input_resample;
      DFBSurfacePixelFormat       font_format;
      bool                        font_premult;
      unsigned long               font_resource_id;
      int                         max_font_rows;
      int                         max_font_row_width;
+     bool                        font_atlas;
+     int                         max_font_runs;
+     bool                        font_share;
+     int                         font_subpixel_phases;
+     char                       *font_prefetch;
 } DFBConfig;
 
 /**********************************************************************************************************************/
@@ -19,6 +19,7 @@
 #include <core/surface_allocation.h>
 #include <core/surface_buffer.h>
 #include <core/surface_pool.h>
+#include <direct/thread.h>
 
 #include "fbdev_system.h"
 
@@ -34,11 +35,19 @@ typedef struct {
 } FBDevPoolData;
 
 typedef struct {
-     int        magic;
+     int              magic;
 
-     FBDevData *fbdev;
+     FBDevData       *fbdev;
 
-     CoreDFB   *core;
+     CoreDFB         *core;
+
+     /* Background compaction, master only. */
+     CoreSurfacePool *pool;
+     unsigned int     compact_interval; /* in milliseconds */
+     DirectThread    *compact_thread;
+     DirectMutex      compact_lock;
+     DirectWaitQueue  compact_cond;
+     bool             compact_quit;
 } FBDevPoolLocalData;
 
 typedef struct {
@@ -49,6 +58,38 @@ typedef struct {
 
 /**********************************************************************************************************************/
 
+static void *
+compact_thread_main( DirectThread *thread,
+                     void         *arg )
+{
+     FBDevPoolLocalData *local = arg;
+
+     D_MAGIC_ASSERT( local, FBDevPoolLocalData );
+
+     direct_mutex_lock( &local->compact_lock );
+
+     while (!local->compact_quit) {
+          direct_waitqueue_wait_timeout( &local->compact_cond, &local->compact_lock,
+                                         local->compact_interval * 1000LL );
+
+          if (local->compact_quit)
+               break;
+
+          direct_mutex_unlock( &local->compact_lock );
+
+          /* Move one idle allocation per interval out of fragmented video memory. */
+          dfb_surface_pool_compact( local->pool );
+
+          direct_mutex_lock( &local->compact_lock );
+     }
+
+     direct_mutex_unlock( &local->compact_lock );
+
+     return NULL;
+}
+
+/**********************************************************************************************************************/
+
 static int
 fbdevPoolDataSize( void )
 {
@@ -76,6 +117,7 @@ fbdevInitPool( CoreDFB                    *core,
                CoreSurfacePoolDescription *ret_desc )
 {
      DFBResult           ret;
+     const char         *value;
      FBDevPoolData      *data  = pool_data;
      FBDevPoolLocalData *local = pool_local;
      FBDevData          *fbdev = system_data;
@@ -124,10 +166,25 @@ fbdevInitPool( CoreDFB                    *core,
 
      local->fbdev = fbdev;
      local->core  = core;
+     local->pool  = pool;
 
      D_MAGIC_SET( data, FBDevPoolData );
      D_MAGIC_SET( local, FBDevPoolLocalData );
 
+     if ((value = direct_config_get_value( "fbdev-compact-interval" ))) {
+          if (sscanf( value, "%u", &local->compact_interval ) < 1) {
+               D_ERROR( "FBDev/Surfaces: Could not parse 'fbdev-compact-interval' value!\n" );
+               local->compact_interval = 0;
+          }
+     }
+
+     if (local->compact_interval) {
+          direct_mutex_init( &local->compact_lock );
+          direct_waitqueue_init( &local->compact_cond );
+
+          local->compact_thread = direct_thread_create( DTT_CLEANUP, compact_thread_main, local, "FBDev Compact" );
+     }
+
      return DFB_OK;
 }
 
@@ -177,6 +234,22 @@ fbdevDestroyPool( CoreSurfacePool *pool,
      D_MAGIC_ASSERT( data, FBDevPoolData );
      D_MAGIC_ASSERT( local, FBDevPoolLocalData );
 
+     if (local->compact_thread) {
+          direct_mutex_lock( &local->compact_lock );
+
+          local->compact_quit = true;
+
+          direct_waitqueue_broadcast( &local->compact_cond );
+
+          direct_mutex_unlock( &local->compact_lock );
+
+          direct_thread_join( local->compact_thread );
+          direct_thread_destroy( local->compact_thread );
+
+          direct_waitqueue_deinit( &local->compact_cond );
+          direct_mutex_deinit( &local->compact_lock );
+     }
+
      surfacemanager_destroy( data->manager );
 
      D_MAGIC_CLEAR( data );
@@ -395,6 +468,25 @@ fbdevMuckOut( CoreSurfacePool   *pool,
      return surfacemanager_displace( local->core, data->manager, buffer );
 }
 
+static DFBResult
+fbdevCompact( CoreSurfacePool *pool,
+              void            *pool_data,
+              void            *pool_local )
+{
+     FBDevPoolData      *data  = pool_data;
+     FBDevPoolLocalData *local = pool_local;
+
+     D_UNUSED_P( local );
+
+     D_DEBUG_AT( FBDev_Surfaces, "%s()\n", __FUNCTION__ );
+
+     D_MAGIC_ASSERT( pool, CoreSurfacePool );
+     D_MAGIC_ASSERT( data, FBDevPoolData );
+     D_MAGIC_ASSERT( local, FBDevPoolLocalData );
+
+     return surfacemanager_compact( data->manager );
+}
+
 const SurfacePoolFuncs fbdevSurfacePoolFuncs = {
      .PoolDataSize       = fbdevPoolDataSize,
      .PoolLocalDataSize  = fbdevPoolLocalDataSize,
@@ -408,5 +500,6 @@ const SurfacePoolFuncs fbdevSurfacePoolFuncs = {
      .DeallocateBuffer   = fbdevDeallocateBuffer,
      .Lock               = fbdevLock,
      .Unlock             = fbdevUnlock,
-     .MuckOut            = fbdevMuckOut
+     .MuckOut            = fbdevMuckOut,
+     .Compact            = fbdevCompact
 };
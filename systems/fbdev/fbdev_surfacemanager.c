@@ -44,8 +44,14 @@ struct _Chunk {
 
      Chunk                 *prev;
      Chunk                 *next;
+
+     Chunk                 *free_prev;   /* free chunks of the same size class */
+     Chunk                 *free_next;
 };
 
+/* Free chunks are kept in bins of power of two size classes, bin n holds chunks of 2^n up to 2^(n+1)-1 bytes. */
+#define SURFMAN_NUM_BINS 31
+
 struct _SurfaceManager {
      int                  magic;
 
@@ -58,16 +64,37 @@ struct _SurfaceManager {
      int                  avail;          /* amount of available memory */
 
      int                  min_toleration;
+
+     Chunk               *bins[SURFMAN_NUM_BINS];
+     unsigned int         bin_mask;       /* bit n is set if bin n is not empty */
+     int                  free;           /* total length of free chunks */
 };
 
-static Chunk *free_chunk  ( SurfaceManager        *manager,
-                            Chunk                 *chunk );
+static void   free_list_insert( SurfaceManager        *manager,
+                                Chunk                 *chunk );
 
-static Chunk *occupy_chunk( SurfaceManager        *manager,
-                            Chunk                 *chunk,
-                            CoreSurfaceAllocation *allocation,
-                            int                    length,
-                            int                    pitch );
+static void   free_list_remove( SurfaceManager        *manager,
+                                Chunk                 *chunk );
+
+static Chunk *free_chunk      ( SurfaceManager        *manager,
+                                Chunk                 *chunk );
+
+static Chunk *occupy_chunk    ( SurfaceManager        *manager,
+                                Chunk                 *chunk,
+                                CoreSurfaceAllocation *allocation,
+                                int                    length,
+                                int                    pitch );
+
+static __inline__ int
+bin_index( int length )
+{
+     int index = 0;
+
+     while (length >>= 1)
+          index++;
+
+     return MIN( index, SURFMAN_NUM_BINS - 1 );
+}
 
 /**********************************************************************************************************************/
 
@@ -111,6 +138,8 @@ surfacemanager_create( CoreDFB         *core,
      manager->length  = length;
      manager->avail   = manager->length;
 
+     free_list_insert( manager, chunk );
+
      D_MAGIC_SET( manager, SurfaceManager );
 
      D_DEBUG_AT( SurfMan, "  -> %p\n", manager );
@@ -161,9 +190,13 @@ surfacemanager_adjust_heap_offset( SurfaceManager *manager,
      if (manager->chunks->buffer == NULL) {
           /* First chunk is free. */
           if (offset <= manager->chunks->offset + manager->chunks->length) {
+               free_list_remove( manager, manager->chunks );
+
                /* Recalculate offset and length. */
                manager->chunks->length = manager->chunks->offset + manager->chunks->length - offset;
                manager->chunks->offset = offset;
+
+               free_list_insert( manager, manager->chunks );
           }
           else {
                D_WARN( "unable to adjust heap offset" );
@@ -184,6 +217,7 @@ surfacemanager_allocate( CoreDFB                *core,
                          CoreSurfaceAllocation  *allocation,
                          Chunk                 **ret_chunk )
 {
+     int    i;
      int    pitch;
      int    length;
      Chunk *chunk;
@@ -219,20 +253,31 @@ surfacemanager_allocate( CoreDFB                *core,
           if (chunk->length != memory_length - manager->offset) {
                D_WARN( "workaround creation happening before graphics driver initialization" );
 
+               if (!chunk->buffer)
+                    free_list_remove( manager, chunk );
+
                manager->length = memory_length;
                manager->avail  = memory_length - manager->offset;
 
                chunk->length = manager->avail;
+
+               if (!chunk->buffer)
+                    free_list_insert( manager, chunk );
           }
      }
 
-     while (chunk) {
-          D_MAGIC_ASSERT( chunk, Chunk );
+     /* Look for the best fit in the first bin providing a chunk that is large enough, all chunks in the following bins
+        are larger than any chunk in this bin. */
+     for (i = bin_index( length ); i < SURFMAN_NUM_BINS && !best_free; i++) {
+          if (!(manager->bin_mask & (1 << i)))
+               continue;
+
+          for (chunk = manager->bins[i]; chunk; chunk = chunk->free_next) {
+               D_MAGIC_ASSERT( chunk, Chunk );
+               D_ASSERT( chunk->buffer == NULL );
 
-          if (!chunk->buffer && chunk->length >= length) {
-               /* NULL means check only. */
-               if (!ret_chunk)
-                    return DFB_OK;
+               if (chunk->length < length)
+                    continue;
 
                if (!best_free || best_free->length > chunk->length)
                     best_free = chunk;
@@ -240,16 +285,17 @@ surfacemanager_allocate( CoreDFB                *core,
                if (chunk->length == length)
                     break;
           }
-
-          chunk = chunk->next;
      }
 
      if (best_free) {
           D_DEBUG_AT( SurfMan, "  -> found free (%d)\n", best_free->length );
 
           /* NULL means check only. */
-          if (ret_chunk)
+          if (ret_chunk) {
                *ret_chunk = occupy_chunk( manager, best_free, allocation, length, pitch );
+               if (!*ret_chunk)
+                    return DFB_NOSHAREDMEMORY;
+          }
 
           return DFB_OK;
      }
@@ -285,7 +331,7 @@ surfacemanager_displace( CoreDFB           *core,
      int                    length;
      int                    min_toleration;
      Chunk                 *chunk;
-     CoreSurfaceAllocation *smallest    = NULL;
+     CoreSurfaceAllocation *victim      = NULL;
      Chunk                 *multi_start = NULL;
      int                    multi_tsize = 0;
      int                    multi_size  = 0;
@@ -360,15 +406,18 @@ surfacemanager_displace( CoreDFB           *core,
                if (chunk->next && !chunk->next->allocation)
                     size += chunk->next->length;
 
+               /* Prefer the least recently used allocation, then the smallest one. */
                if (size >= length) {
-                    if (!smallest || smallest->size > allocation->size) {
-                         D_DEBUG_AT( SurfMan, "  -> %7d [%d] < %d, tolerations %d\n",
-                                     allocation->size, size, smallest ? smallest->size : 0, chunk->tolerations );
+                    if (!victim || victim->last_access > allocation->last_access ||
+                        (victim->last_access == allocation->last_access && victim->size > allocation->size)) {
+                         D_DEBUG_AT( SurfMan, "  -> %7d [%d] < %d, tolerations %d, accessed %lld\n",
+                                     allocation->size, size, victim ? victim->size : 0, chunk->tolerations,
+                                     allocation->last_access );
 
-                         smallest = allocation;
+                         victim = allocation;
                     }
                     else
-                         D_DEBUG_AT( SurfMan, "  -> %7d [%d] > %d\n", allocation->size, size, smallest->size );
+                         D_DEBUG_AT( SurfMan, "  -> %7d [%d] > %d\n", allocation->size, size, victim->size );
                }
                else
                     D_DEBUG_AT( SurfMan, "  -> %7d [%d]\n", allocation->size, size );
@@ -377,7 +426,7 @@ surfacemanager_displace( CoreDFB           *core,
                D_DEBUG_AT( SurfMan, "  -> %7d free\n", chunk->length );
 
 
-          if (!smallest) {
+          if (!victim) {
                if (!multi_start) {
                     multi_start = chunk;
                     multi_tsize = chunk->length;
@@ -427,13 +476,13 @@ next_reset:
           chunk = chunk->next;
      }
 
-     if (smallest) {
-          D_MAGIC_ASSERT( smallest, CoreSurfaceAllocation );
-          D_MAGIC_ASSERT( smallest->buffer, CoreSurfaceBuffer );
+     if (victim) {
+          D_MAGIC_ASSERT( victim, CoreSurfaceAllocation );
+          D_MAGIC_ASSERT( victim->buffer, CoreSurfaceBuffer );
 
-          smallest->flags |= CSALF_MUCKOUT;
+          victim->flags |= CSALF_MUCKOUT;
 
-          D_DEBUG_AT( SurfMan, "  -> offset %lu, size %d\n", smallest->offset, smallest->size );
+          D_DEBUG_AT( SurfMan, "  -> offset %lu, size %d\n", victim->offset, victim->size );
 
           return DFB_OK;
      }
@@ -464,6 +513,77 @@ next_reset:
      return DFB_NOVIDEOMEMORY;
 }
 
+DFBResult
+surfacemanager_compact( SurfaceManager *manager )
+{
+     int                    i;
+     int                    largest = 0;
+     Chunk                 *chunk;
+     CoreSurfaceAllocation *victim  = NULL;
+
+     D_MAGIC_ASSERT( manager, SurfaceManager );
+
+     /* Find the largest free chunk in the highest non-empty bin. */
+     for (i = SURFMAN_NUM_BINS - 1; i >= 0; i--) {
+          if (manager->bin_mask & (1 << i)) {
+               for (chunk = manager->bins[i]; chunk; chunk = chunk->free_next)
+                    largest = MAX( largest, chunk->length );
+
+               break;
+          }
+     }
+
+     D_DEBUG_AT( SurfMan, "%s( %p ) <- free %d, largest %d\n", __FUNCTION__, manager, manager->free, largest );
+
+     /* Nothing to do as long as at least half of the free memory is available in one piece. */
+     if (largest >= manager->free / 2)
+          return DFB_NOSUCHINSTANCE;
+
+     /* Look for the least recently used allocation that joins free chunks to one larger than the largest free chunk. */
+     for (chunk = manager->chunks; chunk; chunk = chunk->next) {
+          CoreSurfaceAllocation *allocation;
+          int                    size;
+
+          D_MAGIC_ASSERT( chunk, Chunk );
+
+          allocation = chunk->allocation;
+          if (!allocation)
+               continue;
+
+          D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+          D_MAGIC_ASSERT( allocation->buffer, CoreSurfaceBuffer );
+
+          if (allocation->buffer->policy == CSP_VIDEOONLY || (allocation->type & CSTF_LAYER))
+               continue;
+
+          if (dfb_surface_allocation_locks( allocation ))
+               continue;
+
+          size = chunk->length;
+
+          if (chunk->prev && !chunk->prev->buffer)
+               size += chunk->prev->length;
+
+          if (chunk->next && !chunk->next->buffer)
+               size += chunk->next->length;
+
+          if (size <= largest || size == chunk->length)
+               continue;
+
+          if (!victim || victim->last_access > allocation->last_access)
+               victim = allocation;
+     }
+
+     if (!victim)
+          return DFB_NOSUCHINSTANCE;
+
+     victim->flags |= CSALF_MUCKOUT;
+
+     D_DEBUG_AT( SurfMan, "  -> offset %lu, size %d\n", victim->offset, victim->size );
+
+     return DFB_OK;
+}
+
 void
 surfacemanager_deallocate( SurfaceManager *manager,
                            Chunk          *chunk )
@@ -482,6 +602,48 @@ surfacemanager_deallocate( SurfaceManager *manager,
 
 /**********************************************************************************************************************/
 
+static void
+free_list_insert( SurfaceManager *manager,
+                  Chunk          *chunk )
+{
+     int index = bin_index( chunk->length );
+
+     D_ASSERT( chunk->buffer == NULL );
+
+     chunk->free_prev = NULL;
+     chunk->free_next = manager->bins[index];
+
+     if (chunk->free_next)
+          chunk->free_next->free_prev = chunk;
+
+     manager->bins[index]  = chunk;
+     manager->bin_mask    |= 1 << index;
+     manager->free        += chunk->length;
+}
+
+static void
+free_list_remove( SurfaceManager *manager,
+                  Chunk          *chunk )
+{
+     int index = bin_index( chunk->length );
+
+     if (chunk->free_prev)
+          chunk->free_prev->free_next = chunk->free_next;
+     else
+          manager->bins[index] = chunk->free_next;
+
+     if (chunk->free_next)
+          chunk->free_next->free_prev = chunk->free_prev;
+
+     if (!manager->bins[index])
+          manager->bin_mask &= ~(1 << index);
+
+     manager->free -= chunk->length;
+
+     chunk->free_prev = NULL;
+     chunk->free_next = NULL;
+}
+
 static Chunk *
 split_chunk( SurfaceManager *manager,
              Chunk          *chunk,
@@ -547,6 +709,8 @@ free_chunk( SurfaceManager *manager,
 
           D_DEBUG_AT( SurfMan, "  -> merging with previous chunk at %d\n", prev->offset );
 
+          free_list_remove( manager, prev );
+
           prev->length += chunk->length;
 
           prev->next = chunk->next;
@@ -566,6 +730,8 @@ free_chunk( SurfaceManager *manager,
 
           D_DEBUG_AT( SurfMan, "  -> merging with next chunk at %d\n", next->offset );
 
+          free_list_remove( manager, next );
+
           chunk->length += next->length;
 
           chunk->next = next->next;
@@ -577,6 +743,8 @@ free_chunk( SurfaceManager *manager,
           SHFREE( manager->shmpool, next );
      }
 
+     free_list_insert( manager, chunk );
+
      return chunk;
 }
 
@@ -587,17 +755,29 @@ occupy_chunk( SurfaceManager        *manager,
               int                    length,
               int                    pitch )
 {
+     Chunk *occupied;
+
      D_MAGIC_ASSERT( manager, SurfaceManager );
      D_MAGIC_ASSERT( chunk, Chunk );
      D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
      D_MAGIC_ASSERT( allocation->buffer, CoreSurfaceBuffer );
 
-     if (allocation->buffer->policy == CSP_VIDEOONLY)
-          manager->avail -= length;
+     /* The remaining part of a splitted chunk is put back into the bin of its new size. */
+     free_list_remove( manager, chunk );
 
-     chunk = split_chunk( manager, chunk, length );
-     if (!chunk)
+     occupied = split_chunk( manager, chunk, length );
+     if (!occupied) {
+          free_list_insert( manager, chunk );
           return NULL;
+     }
+
+     if (occupied != chunk)
+          free_list_insert( manager, chunk );
+
+     chunk = occupied;
+
+     if (allocation->buffer->policy == CSP_VIDEOONLY)
+          manager->avail -= length;
 
      D_DEBUG_AT( SurfMan, "%s( %d bytes at offset %d )\n", __FUNCTION__, chunk->length, chunk->offset );
 
@@ -53,6 +53,8 @@ DFBResult surfacemanager_displace          ( CoreDFB                *core,
                                              SurfaceManager         *manager,
                                              CoreSurfaceBuffer      *buffer );
 
+DFBResult surfacemanager_compact           ( SurfaceManager         *manager );
+
 void      surfacemanager_deallocate        ( SurfaceManager         *manager,
                                              Chunk                  *chunk );
 
@@ -0,0 +1,122 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+/*
+ * Compares the results of the SSE2 glyph blending functions with the C functions for random spans, colors and
+ * alignments. The functions are static, so the software driver is built into the test.
+ */
+
+#include <gfx/generic/generic.c>
+
+static u32
+random_u32( u32 *seed )
+{
+     *seed ^= *seed << 13;
+     *seed ^= *seed >> 17;
+     *seed ^= *seed << 5;
+
+     return *seed;
+}
+
+int
+main( int argc, char *argv[] )
+{
+     static const struct {
+          const char *name;
+          GenefxFunc  c;
+          GenefxFunc  sse2;
+          int         bpp;
+     } checks[] = {
+          { "Bop_a8_set_alphapixel_Aop_rgb16",
+            Bop_a8_set_alphapixel_Aop_rgb16,            Bop_a8_set_alphapixel_Aop_rgb16_SSE2,            2 },
+          { "Bop_a8_set_alphapixel_Aop_rgb32",
+            Bop_a8_set_alphapixel_Aop_rgb32,            Bop_a8_set_alphapixel_Aop_rgb32_SSE2,            4 },
+          { "Bop_a8_set_alphapixel_Aop_argb",
+            Bop_a8_set_alphapixel_Aop_argb,             Bop_a8_set_alphapixel_Aop_argb_SSE2,             4 },
+          { "Bop_a8_set_alphapixel_coloralpha_Aop_rgb16",
+            Bop_a8_set_alphapixel_coloralpha_Aop_rgb16, Bop_a8_set_alphapixel_coloralpha_Aop_rgb16_SSE2, 2 },
+          { "Bop_a8_set_alphapixel_coloralpha_Aop_rgb32",
+            Bop_a8_set_alphapixel_coloralpha_Aop_rgb32, Bop_a8_set_alphapixel_coloralpha_Aop_rgb32_SSE2, 4 },
+          { "Bop_a8_set_alphapixel_coloralpha_Aop_argb",
+            Bop_a8_set_alphapixel_coloralpha_Aop_argb,  Bop_a8_set_alphapixel_coloralpha_Aop_argb_SSE2,  4 }
+     };
+
+     unsigned int i;
+     int          n, x;
+     int          failed = 0;
+     u32          seed   = 0x2545f491;
+     u8           src[80 + 16];
+     u8           dst_c[80 * 4 + 16];
+     u8           dst_sse2[80 * 4 + 16];
+     GenefxState  gfxs;
+
+     memset( &gfxs, 0, sizeof(gfxs) );
+
+     for (i = 0; i < D_ARRAY_SIZE(checks); i++) {
+          for (n = 0; n < 100000; n++) {
+               int src_offset = random_u32( &seed ) & 15;
+               int dst_offset = random_u32( &seed ) & 15 & ~(checks[i].bpp - 1);
+               u32 color      = random_u32( &seed );
+
+               /* Mix empty, fully covered and partially covered pixels. */
+               for (x = 0; x < sizeof(src); x++) {
+                    u32 r = random_u32( &seed );
+
+                    switch (r & 3) {
+                         case 0:  src[x] = 0;       break;
+                         case 1:  src[x] = 0xff;    break;
+                         default: src[x] = r >> 24; break;
+                    }
+               }
+
+               for (x = 0; x < sizeof(dst_c); x++)
+                    dst_c[x] = random_u32( &seed ) >> 24;
+
+               memcpy( dst_sse2, dst_c, sizeof(dst_c) );
+
+               gfxs.length  = random_u32( &seed ) % 81;
+               gfxs.Cop     = random_u32( &seed );
+               gfxs.color.a = color >> 24;
+               gfxs.color.r = color >> 16;
+               gfxs.color.g = color >> 8;
+               gfxs.color.b = color;
+
+               if (checks[i].bpp == 2)
+                    gfxs.Cop &= 0xffff;
+
+               gfxs.Aop[0] = dst_c + dst_offset;
+               gfxs.Bop[0] = src + src_offset;
+
+               checks[i].c( &gfxs );
+
+               gfxs.Aop[0] = dst_sse2 + dst_offset;
+               gfxs.Bop[0] = src + src_offset;
+
+               checks[i].sse2( &gfxs );
+
+               if (memcmp( dst_c, dst_sse2, sizeof(dst_c) )) {
+                    printf( "%s: results differ (length %d, color 0x%08x, offsets %d/%d)\n",
+                            checks[i].name, gfxs.length, color, src_offset, dst_offset );
+                    failed = 1;
+                    break;
+               }
+          }
+     }
+
+     return failed;
+}